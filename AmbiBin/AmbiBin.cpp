@@ -3,8 +3,9 @@
 // Very simple virtual loudspeaker dome; not the most accurate / effective but can be useful for testing / keeping everything in chuck
 
 #include "chugin.h"
+#include "AmbiCore.h"
 #include <cmath>
-
+#include <cstring>
 
 // precomputed matrix calculations for a basic virtual dome
 static const float dec_L[7][64] = {
@@ -42,11 +43,33 @@ static const float dec_R[7][64] = {
 };
 
 
+// process id of AmbiBin in Chrome traces (see AmbiTrace.h)
+static const int AMBIBIN_TRACE_PID = 3;
+
+
 // declaration of chugin functions
-#define DECLARE_ORDER_FUNCS(N)           \
-    CK_DLL_CTOR(ambibin##N##_ctor);      \
-    CK_DLL_DTOR(ambibin##N##_dtor);      \
-    CK_DLL_TICKF(ambibin##N##_tickf);    \
+#define DECLARE_ORDER_FUNCS(N)                     \
+    CK_DLL_CTOR(ambibin##N##_ctor);                \
+    CK_DLL_DTOR(ambibin##N##_dtor);                \
+    CK_DLL_TICKF(ambibin##N##_tickf);              \
+    CK_DLL_MFUN(ambibin##N##_setBlockSize);        \
+    CK_DLL_MFUN(ambibin##N##_getBlockSize);        \
+    CK_DLL_MFUN(ambibin##N##_getLatency);          \
+    CK_DLL_MFUN(ambibin##N##_setSilenceDetection); \
+    CK_DLL_MFUN(ambibin##N##_getSilenceDetection); \
+    CK_DLL_MFUN(ambibin##N##_getSilent);           \
+    CK_DLL_MFUN(ambibin##N##_getOverruns);         \
+    CK_DLL_MFUN(ambibin##N##_getWorstTick);        \
+    CK_DLL_MFUN(ambibin##N##_getInstanceId);       \
+    CK_DLL_SFUN(ambibin##N##_instances);           \
+    CK_DLL_SFUN(ambibin##N##_samplesProcessed);    \
+    CK_DLL_SFUN(ambibin##N##_silentBlocks);        \
+    CK_DLL_SFUN(ambibin##N##_tickTime);            \
+    CK_DLL_SFUN(ambibin##N##_resetStats);          \
+    CK_DLL_SFUN(ambibin##N##_tickP50);             \
+    CK_DLL_SFUN(ambibin##N##_tickP99);             \
+    CK_DLL_SFUN(ambibin##N##_tickMax);             \
+    CK_DLL_SFUN(ambibin##N##_tickOverruns);        \
     t_CKINT ambibin##N##_data_offset = 0;
 
 DECLARE_ORDER_FUNCS(1)
@@ -56,6 +79,13 @@ DECLARE_ORDER_FUNCS(4)
 DECLARE_ORDER_FUNCS(5)
 DECLARE_ORDER_FUNCS(6)
 DECLARE_ORDER_FUNCS(7)
+CK_DLL_SFUN(ambibin_isa);
+CK_DLL_SFUN(ambibin_statsTiming);
+CK_DLL_SFUN(ambibin_traceStart);
+CK_DLL_SFUN(ambibin_traceStop);
+CK_DLL_SFUN(ambibin_deadlineMonitor);
+CK_DLL_SFUN(ambibin_deadlineBudget);
+CK_DLL_SFUN(ambibin_deadlineDump);
 
 
 // class definition for internal chugin data
@@ -63,47 +93,317 @@ class AmbiBin
 {
 public:
     AmbiBin( t_CKINT order )
-        : m_order(order), m_order_idx(order - 1) {}
+        : m_order(order), m_order_idx(order - 1), m_in_channels((order + 1) * (order + 1)),
+          m_block_size(1), m_block_pos(0), m_block_in(NULL), m_block_out(NULL),
+          m_silence_detect(false), m_silent_frames(0)
+    {
+        m_stats = ambi_stats_block();
+        ambi_stats_count(m_stats, m_order, AMBI_STAT_INSTANCES, 1);
+    }
+
+    ~AmbiBin()
+    {
+        delete [] m_block_in;
+        delete [] m_block_out;
+        ambi_stats_count(m_stats, m_order, AMBI_STAT_INSTANCES, -1);
+    }
+
+    t_CKINT setBlockSize( t_CKINT b )
+    {
+        b = (b < 1 ? 1 : (b > MAX_BLOCK_SIZE ? MAX_BLOCK_SIZE : b));
+        if (b == m_block_size) return m_block_size;
+
+        delete [] m_block_in;
+        delete [] m_block_out;
+        m_block_in = NULL;
+        m_block_out = NULL;
+
+        // a block size of 1 decodes every frame directly, without latency
+        if (b > 1) {
+            m_block_in = new SAMPLE[b * m_in_channels];
+            m_block_out = new SAMPLE[b * 2];
+            memset(m_block_in, 0, sizeof(SAMPLE) * b * m_in_channels);
+            memset(m_block_out, 0, sizeof(SAMPLE) * b * 2);
+        }
+
+        m_block_size = b;
+        m_block_pos = 0;
+        return m_block_size;
+    }
+
+    t_CKINT setSilenceDetection( t_CKINT d )
+    {
+        m_silence_detect = (d != 0);
+        m_silent_frames = 0;
+        return m_silence_detect;
+    }
+
+    t_CKINT getBlockSize()
+    {
+        return m_block_size;
+    }
+
+    t_CKDUR getLatency()
+    {
+        return m_block_size > 1 ? m_block_size : 0;
+    }
+
+    t_CKINT getSilenceDetection()
+    {
+        return m_silence_detect;
+    }
+
+    t_CKINT getSilent()
+    {
+        return m_silence_detect && m_silent_frames >= SILENCE_HOLD;
+    }
+
+    t_CKINT getOverruns()
+    {
+        return m_monitor.overruns;
+    }
+
+    t_CKFLOAT getWorstTick()
+    {
+        return ambi_clock_to_ns(m_monitor.worst);
+    }
+
+    t_CKINT getInstanceId()
+    {
+        return m_monitor.id;
+    }
 
     template<int N_CH>
     void tick( SAMPLE * in, SAMPLE * out, int nframes )
     {
-        const float * dL = dec_L[m_order_idx];
-        const float * dR = dec_R[m_order_idx];
-        for (int f = 0; f < nframes; f++) {
-            float L = 0.f, R = 0.f;
-            for (int c = 0; c < N_CH; c++) {
-                float s = in[f * N_CH + c];
-                L += dL[c] * s;
-                R += dR[c] * s;
+        AMBI_TRACE_SCOPE("tick", "frames", nframes);
+        t_CKINT start = ambi_stats_tick_start();
+
+        if (m_block_size <= 1) {
+            process<N_CH>(in, out, nframes);
+        } else {
+            // buffer input and play back the block decoded m_block_size frames ago
+            for (int f = 0; f < nframes; f++) {
+                memcpy(m_block_in + m_block_pos * N_CH, in + f * N_CH, sizeof(SAMPLE) * N_CH);
+                out[f * 2 + 0] = m_block_out[m_block_pos * 2 + 0];
+                out[f * 2 + 1] = m_block_out[m_block_pos * 2 + 1];
+
+                if (++m_block_pos == m_block_size) {
+                    m_monitor.reasons |= AMBI_REASON_BLOCK;
+                    process<N_CH>(m_block_in, m_block_out, m_block_size);
+                    m_block_pos = 0;
+                }
             }
-            out[f * 2 + 0] = L;
-            out[f * 2 + 1] = R;
         }
+
+        m_monitor.end(m_stats, m_order, this, nframes, start);
     }
 
 private:
+    template<int N_CH>
+    void process( SAMPLE * in, SAMPLE * out, int nframes )
+    {
+        // silent input: write zeros once, then skip decoding until the input comes back
+        if (detect_silence(in, nframes * N_CH)) {
+            ambi_stats_count(m_stats, m_order, AMBI_STAT_SILENT_BLOCKS, 1);
+            AMBI_TRACE_INSTANT("silent", "frames", nframes);
+            clear_output(out, nframes * 2);
+            return;
+        }
+
+        AMBI_TRACE_SCOPE("decode", "frames", nframes);
+        AMBI_CALL_KERNEL(decode, <N_CH>, (in, out, nframes, dec_L[m_order_idx], dec_R[m_order_idx]));
+    }
+
+    // hysteresis: only report silence after SILENCE_HOLD consecutive silent frames
+    bool detect_silence( const SAMPLE * in, int nsamples )
+    {
+        return m_silence_detect && hold_silence(in, nsamples, nsamples / m_in_channels, &m_silent_frames);
+    }
+
+    AmbiStatsBlock * m_stats;
+    AmbiTickMonitor m_monitor;
     t_CKINT m_order;
     t_CKINT m_order_idx;
+    t_CKINT m_in_channels;
+
+    t_CKINT m_block_size;
+    t_CKINT m_block_pos;
+    SAMPLE * m_block_in;
+    SAMPLE * m_block_out;
+
+    t_CKINT m_silence_detect;
+    t_CKINT m_silent_frames;
 };
 
 
+// functions that are the same for each order
+static void ambibin_setBlockSize( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setBlockSize(GET_NEXT_INT(ARGS));
+}
+
+static void ambibin_getBlockSize( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getBlockSize();
+}
+
+static void ambibin_getLatency( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_dur = obj->getLatency();
+}
+
+static void ambibin_setSilenceDetection( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setSilenceDetection(GET_NEXT_INT(ARGS));
+}
+
+static void ambibin_getSilenceDetection( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getSilenceDetection();
+}
+
+static void ambibin_getSilent( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getSilent();
+}
+
+static void ambibin_getOverruns( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getOverruns();
+}
+
+static void ambibin_getWorstTick( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->getWorstTick();
+}
+
+static void ambibin_getInstanceId( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getInstanceId();
+}
+
+// shared by every order
+CK_DLL_SFUN(ambibin_isa)
+{
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ambi_isa_name(), FALSE);
+}
+
+CK_DLL_SFUN(ambibin_statsTiming)
+{
+    ambi_stats_timing = GET_NEXT_INT(ARGS) != 0;
+    RETURN->v_int = ambi_stats_timing;
+}
+
+CK_DLL_SFUN(ambibin_traceStart)
+{
+    const char * file = API->object->str(GET_NEXT_STRING(ARGS));
+    RETURN->v_int = ambi_trace_start(file, AMBIBIN_TRACE_PID, "AmbiBin");
+}
+
+CK_DLL_SFUN(ambibin_traceStop)
+{
+    RETURN->v_int = ambi_trace_stop();
+}
+
+CK_DLL_SFUN(ambibin_deadlineMonitor)
+{
+    ambi_deadline_monitor(GET_NEXT_INT(ARGS) != 0);
+    RETURN->v_int = ambi_deadline_on;
+}
+
+CK_DLL_SFUN(ambibin_deadlineBudget)
+{
+    ambi_deadline_budget(GET_NEXT_FLOAT(ARGS));
+    RETURN->v_float = ambi_deadline_us;
+}
+
+CK_DLL_SFUN(ambibin_deadlineDump)
+{
+    const char * file = API->object->str(GET_NEXT_STRING(ARGS));
+    RETURN->v_int = ambi_deadline_dump(file, "AmbiBin");
+}
+
+
 // constructors and functions for each order
-#define DEFINE_ORDER_CALLBACKS(N)                                                \
-CK_DLL_CTOR(ambibin##N##_ctor) {                                                 \
-    OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset) = 0;                          \
-    AmbiBin * obj = new AmbiBin(N);                                              \
-    OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset) = (t_CKINT)obj;               \
-}                                                                                \
-CK_DLL_DTOR(ambibin##N##_dtor) {                                                 \
-    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset);   \
-    CK_SAFE_DELETE(obj);                                                         \
-    OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset) = 0;                          \
-}                                                                                \
-CK_DLL_TICKF(ambibin##N##_tickf) {                                               \
-    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset);   \
-    if (obj) obj->tick<(N+1)*(N+1)>(in, out, nframes);                           \
-    return TRUE;                                                                 \
+#define DEFINE_ORDER_CALLBACKS(N)                                                   \
+CK_DLL_CTOR(ambibin##N##_ctor) {                                                    \
+    OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset) = 0;                             \
+    AmbiBin * obj = new AmbiBin(N);                                                 \
+    OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset) = (t_CKINT)obj;                  \
+}                                                                                   \
+CK_DLL_DTOR(ambibin##N##_dtor) {                                                    \
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset);      \
+    CK_SAFE_DELETE(obj);                                                            \
+    OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset) = 0;                             \
+}                                                                                   \
+CK_DLL_TICKF(ambibin##N##_tickf) {                                                  \
+    AmbiBin * obj = (AmbiBin *)OBJ_MEMBER_INT(SELF, ambibin##N##_data_offset);      \
+    if (obj) obj->tick<(N+1)*(N+1)>(in, out, nframes);                              \
+    return TRUE;                                                                    \
+}                                                                                   \
+CK_DLL_MFUN(ambibin##N##_setBlockSize) {                                            \
+    ambibin_setBlockSize(SELF, ambibin##N##_data_offset, ARGS, RETURN, API);        \
+}                                                                                   \
+CK_DLL_MFUN(ambibin##N##_getBlockSize) {                                            \
+    ambibin_getBlockSize(SELF, ambibin##N##_data_offset, RETURN, API);              \
+}                                                                                   \
+CK_DLL_MFUN(ambibin##N##_getLatency) {                                              \
+    ambibin_getLatency(SELF, ambibin##N##_data_offset, RETURN, API);                \
+}                                                                                   \
+CK_DLL_MFUN(ambibin##N##_setSilenceDetection) {                                     \
+    ambibin_setSilenceDetection(SELF, ambibin##N##_data_offset, ARGS, RETURN, API); \
+}                                                                                   \
+CK_DLL_MFUN(ambibin##N##_getSilenceDetection) {                                     \
+    ambibin_getSilenceDetection(SELF, ambibin##N##_data_offset, RETURN, API);       \
+}                                                                                   \
+CK_DLL_MFUN(ambibin##N##_getSilent) {                                               \
+    ambibin_getSilent(SELF, ambibin##N##_data_offset, RETURN, API);                 \
+}                                                                                   \
+CK_DLL_MFUN(ambibin##N##_getOverruns) {                                             \
+    ambibin_getOverruns(SELF, ambibin##N##_data_offset, RETURN, API);               \
+}                                                                                   \
+CK_DLL_MFUN(ambibin##N##_getWorstTick) {                                            \
+    ambibin_getWorstTick(SELF, ambibin##N##_data_offset, RETURN, API);              \
+}                                                                                   \
+CK_DLL_MFUN(ambibin##N##_getInstanceId) {                                           \
+    ambibin_getInstanceId(SELF, ambibin##N##_data_offset, RETURN, API);             \
+}                                                                                   \
+CK_DLL_SFUN(ambibin##N##_instances) {                                               \
+    RETURN->v_int = ambi_stats_read(N, AMBI_STAT_INSTANCES);                        \
+}                                                                                   \
+CK_DLL_SFUN(ambibin##N##_samplesProcessed) {                                        \
+    RETURN->v_int = ambi_stats_read(N, AMBI_STAT_SAMPLES);                          \
+}                                                                                   \
+CK_DLL_SFUN(ambibin##N##_silentBlocks) {                                            \
+    RETURN->v_int = ambi_stats_read(N, AMBI_STAT_SILENT_BLOCKS);                    \
+}                                                                                   \
+CK_DLL_SFUN(ambibin##N##_tickTime) {                                                \
+    RETURN->v_float = ambi_stats_tick_ns(N);                                        \
+}                                                                                   \
+CK_DLL_SFUN(ambibin##N##_resetStats) {                                              \
+    ambi_stats_reset(N);                                                            \
+}                                                                                   \
+CK_DLL_SFUN(ambibin##N##_tickP50) {                                                 \
+    RETURN->v_float = ambi_deadline_quantile_ns(N, 0.5);                            \
+}                                                                                   \
+CK_DLL_SFUN(ambibin##N##_tickP99) {                                                 \
+    RETURN->v_float = ambi_deadline_quantile_ns(N, 0.99);                           \
+}                                                                                   \
+CK_DLL_SFUN(ambibin##N##_tickMax) {                                                 \
+    RETURN->v_float = ambi_deadline_max_ns(N);                                      \
+}                                                                                   \
+CK_DLL_SFUN(ambibin##N##_tickOverruns) {                                            \
+    RETURN->v_int = ambi_stats_read(N, AMBI_STAT_OVERRUNS);                         \
 }
 
 DEFINE_ORDER_CALLBACKS(1)
@@ -125,22 +425,55 @@ CK_DLL_INFO( AmbiBin )
     QUERY->setinfo( QUERY, CHUGIN_INFO_EMAIL, "" );
 }
 
-#define REGISTER_ORDER_CLASS(N, N_CH)                                            \
-do {                                                                             \
-    QUERY->begin_class(QUERY, "AmbiBin" #N, "UGen");                             \
-    QUERY->doc_class(QUERY, "Order-" #N " ambisonics binaural decoder. "         \
-        #N_CH " inputs (ACN/SN3D), 2 outputs (L/R headphone).");                 \
-    QUERY->add_ctor(QUERY, ambibin##N##_ctor);                                   \
-    QUERY->add_dtor(QUERY, ambibin##N##_dtor);                                   \
-    QUERY->add_ugen_funcf(QUERY, ambibin##N##_tickf, NULL, N_CH, 2);             \
-    ambibin##N##_data_offset =                                                   \
-        QUERY->add_mvar(QUERY, "int", "@ab" #N "_data", false);                  \
-    QUERY->end_class(QUERY);                                                     \
+#define REGISTER_ORDER_CLASS(N, N_CH)                                                    \
+do {                                                                                     \
+    QUERY->begin_class(QUERY, "AmbiBin" #N, "UGen");                                     \
+    QUERY->doc_class(QUERY, "Order-" #N " ambisonics binaural decoder. "                 \
+        #N_CH " inputs (ACN/SN3D), 2 outputs (L/R headphone).");                         \
+    QUERY->add_ctor(QUERY, ambibin##N##_ctor);                                           \
+    QUERY->add_dtor(QUERY, ambibin##N##_dtor);                                           \
+    QUERY->add_ugen_funcf(QUERY, ambibin##N##_tickf, NULL, N_CH, 2);                     \
+    QUERY->add_mfun(QUERY, ambibin##N##_setBlockSize, "int", "blockSize");               \
+        QUERY->add_arg(QUERY, "int", "b");                                               \
+    QUERY->add_mfun(QUERY, ambibin##N##_getBlockSize, "int", "blockSize");               \
+    QUERY->add_mfun(QUERY, ambibin##N##_getLatency, "dur", "latency");                   \
+    QUERY->add_mfun(QUERY, ambibin##N##_setSilenceDetection, "int", "silenceDetection"); \
+        QUERY->add_arg(QUERY, "int", "d");                                               \
+    QUERY->add_mfun(QUERY, ambibin##N##_getSilenceDetection, "int", "silenceDetection"); \
+    QUERY->add_mfun(QUERY, ambibin##N##_getSilent, "int", "silent");                     \
+    QUERY->add_mfun(QUERY, ambibin##N##_getOverruns, "int", "overruns");                 \
+    QUERY->add_mfun(QUERY, ambibin##N##_getWorstTick, "float", "worstTick");             \
+    QUERY->add_mfun(QUERY, ambibin##N##_getInstanceId, "int", "instanceId");             \
+    QUERY->add_sfun(QUERY, ambibin_isa, "string", "isa");                                \
+    QUERY->add_sfun(QUERY, ambibin##N##_instances, "int", "instances");                  \
+    QUERY->add_sfun(QUERY, ambibin##N##_samplesProcessed, "int", "samplesProcessed");    \
+    QUERY->add_sfun(QUERY, ambibin##N##_silentBlocks, "int", "silentBlocks");            \
+    QUERY->add_sfun(QUERY, ambibin##N##_tickTime, "float", "tickTime");                  \
+    QUERY->add_sfun(QUERY, ambibin##N##_resetStats, "void", "resetStats");               \
+    QUERY->add_sfun(QUERY, ambibin_statsTiming, "int", "statsTiming");                   \
+        QUERY->add_arg(QUERY, "int", "timing");                                          \
+    QUERY->add_sfun(QUERY, ambibin_traceStart, "int", "traceStart");                     \
+        QUERY->add_arg(QUERY, "string", "file");                                         \
+    QUERY->add_sfun(QUERY, ambibin_traceStop, "int", "traceStop");                       \
+    QUERY->add_sfun(QUERY, ambibin_deadlineMonitor, "int", "deadlineMonitor");           \
+        QUERY->add_arg(QUERY, "int", "monitor");                                         \
+    QUERY->add_sfun(QUERY, ambibin_deadlineBudget, "float", "deadlineBudget");           \
+        QUERY->add_arg(QUERY, "float", "us");                                            \
+    QUERY->add_sfun(QUERY, ambibin##N##_tickP50, "float", "tickP50");                    \
+    QUERY->add_sfun(QUERY, ambibin##N##_tickP99, "float", "tickP99");                    \
+    QUERY->add_sfun(QUERY, ambibin##N##_tickMax, "float", "tickMax");                    \
+    QUERY->add_sfun(QUERY, ambibin##N##_tickOverruns, "int", "tickOverruns");            \
+    QUERY->add_sfun(QUERY, ambibin_deadlineDump, "int", "deadlineDump");                 \
+        QUERY->add_arg(QUERY, "string", "file");                                         \
+    ambibin##N##_data_offset =                                                           \
+        QUERY->add_mvar(QUERY, "int", "@ab" #N "_data", false);                          \
+    QUERY->end_class(QUERY);                                                             \
 } while(0)
 
 CK_DLL_QUERY( AmbiBin )
 {
     QUERY->setname(QUERY, "AmbiBin");
+    ambi_stats_init();
     REGISTER_ORDER_CLASS(1,  4);
     REGISTER_ORDER_CLASS(2,  9);
     REGISTER_ORDER_CLASS(3, 16);
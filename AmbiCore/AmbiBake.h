@@ -0,0 +1,131 @@
+// AmbiBake.h
+// Baked gains: a choreography source evaluated ahead of time into one SH gain
+// vector per update, stored as float16 in a file that is mapped, shared and
+// prefetched like a choreography (AmbiChoreo.h). Playing it back interpolates
+// between stored vectors, so the show does no trig or polynomial work at all.
+// float16 keeps about 11 bits, so every gain is within 2^-12 of its value,
+// roughly -72 dB below a unit source; the angles are stored as floats next to
+// the gains so the panners can still report where the source is
+
+#ifndef AMBI_BAKE_H
+#define AMBI_BAKE_H
+
+#include "AmbiChoreo.h"
+#include <vector>
+
+// float to float16, rounding to nearest even; too large becomes infinity
+static inline uint16_t ambi_half_from_float( float f )
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t mag = x & 0x7fffffff;
+
+    // 65536 and up, infinity and NaN
+    if (mag >= 0x47800000) return sign | (mag > 0x7f800000 ? 0x7e00 : 0x7c00);
+
+    // below 2^-14 the result is subnormal, a multiple of 2^-24
+    if (mag < 0x38800000) return sign | (uint16_t)lrintf(fabsf(f) * 16777216.0f);
+
+    // rebias the exponent and round away the low 13 mantissa bits; a carry
+    // moves on into the exponent
+    uint32_t h = (mag - 0x38000000) >> 13;
+    uint32_t rest = mag & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) h++;
+    return sign | h;
+}
+
+static AMBI_INLINE float ambi_half_to_float( uint16_t h )
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t man = h & 0x3ff;
+
+    uint32_t x;
+    if (exp == 0) {
+        float f = man * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    if (exp == 31) x = sign | 0x7f800000 | (man << 13);
+    else x = sign | ((exp + 112) << 23) | (man << 13);
+
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+// gains of frame f of a baked file
+static AMBI_INLINE const uint16_t * ambi_bake_frame( const AmbiChoreo * c, t_CKINT f )
+{
+    return (const uint16_t *)(c->frames + f * c->frame_bytes + 2 * sizeof(float));
+}
+
+// the first nch gains at time t frames, linear between frames; the last frame
+// holds. ACN channels of a lower order are a prefix of a higher one, so a file
+// baked at a higher order plays at any lower order too
+template<typename T>
+static AMBI_INLINE void ambi_bake_gains( const AmbiChoreo * c, t_CKFLOAT t, int nch, T * gains )
+{
+    t_CKINT f = (t_CKINT)t;
+    if (f >= c->nframes - 1) {
+        const uint16_t * g = ambi_bake_frame(c, c->nframes - 1);
+        for (int ch = 0; ch < nch; ch++) gains[ch] = ambi_half_to_float(g[ch]);
+        return;
+    }
+
+    const uint16_t * g0 = ambi_bake_frame(c, f);
+    const uint16_t * g1 = ambi_bake_frame(c, f + 1);
+    T u = (T)(t - f);
+    for (int ch = 0; ch < nch; ch++) {
+        T a = ambi_half_to_float(g0[ch]);
+        gains[ch] = a + (ambi_half_to_float(g1[ch]) - a) * u;
+    }
+}
+
+// bake source s of choreography c at the given order and rate (updates per
+// second) into a file: the source is sampled at every update from the first
+// frame to the last, and the last update lands on the last frame. Returns the
+// number of updates written, or 0 if the file can't be written
+static inline t_CKINT ambi_bake_write( const char * path, const AmbiChoreo * c, t_CKINT s, t_CKINT order, t_CKFLOAT rate )
+{
+    t_CKFLOAT length = (c->nframes - 1) / c->rate;
+    t_CKINT nframes = (t_CKINT)ceil(length * rate - 1e-9) + 1;
+    if (nframes < 1) nframes = 1;
+
+    FILE * fp = fopen(path, "wb");
+    if (!fp) return 0;
+
+    AmbiChoreoHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, AMBI_BAKE_MAGIC, 8);
+    h.version = 1;
+    h.nsources = 1;
+    h.nframes = (uint64_t)nframes;
+    h.rate = rate;
+    h.data_offset = sizeof(h);
+    h.order = (uint32_t)order;
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+
+    const int nch = (order + 1) * (order + 1);
+    const float * coeffs = sh_coeffs();
+    std::vector<char> frame(ambi_bake_frame_bytes(order), 0);
+    float * angles = (float *)&frame[0];
+    uint16_t * halves = (uint16_t *)&frame[2 * sizeof(float)];
+    float g[MAX_CHANNELS];
+
+    for (t_CKINT f = 0; ok && f < nframes; f++) {
+        t_CKFLOAT a, e;
+        ambi_choreo_at(c, std::min(f / rate * c->rate, (t_CKFLOAT)(c->nframes - 1)), s, &a, &e);
+        a = wrap_angle(a);
+        e = wrap_angle(e);
+        sh_gains((float)a, (float)e, (int)order, coeffs, g, 1);
+
+        angles[0] = (float)a;
+        angles[1] = (float)e;
+        for (int ch = 0; ch < nch; ch++) halves[ch] = ambi_half_from_float(g[ch]);
+        ok = fwrite(&frame[0], frame.size(), 1, fp) == 1;
+    }
+    return fclose(fp) == 0 && ok ? nframes : 0;
+}
+
+#endif
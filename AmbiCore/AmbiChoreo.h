@@ -0,0 +1,392 @@
+// AmbiChoreo.h
+// Precomputed choreographies: binary files of azimuth / elevation frames for many
+// sources, played back by the panners. A file is mapped (mmap, or
+// MapViewOfFile on Windows) when it is first opened, which is O(1) whatever its
+// length, and shared by every voice that plays it; frames are read straight
+// from the page cache. Each voice reports how far it has got through a cursor
+// of its own, and a background thread keeps the next AMBI_CHOREO_AHEAD_MS
+// after every cursor resident, so the audio thread does not wait on the disk.
+// Baked gain files (AmbiBake.h) are mapped and prefetched the same way.
+// Not part of AmbiCore.h: only the chugins that play files include it.
+//
+// File layout, little-endian:
+//     AmbiChoreoHeader (64 bytes)
+//     nframes frames, each nsources float azimuths then nsources float
+//     elevations, in radians
+// or, for baked gains (AMBI_BAKE_MAGIC, one source):
+//     AmbiChoreoHeader (64 bytes)
+//     nframes frames, each a float azimuth, a float elevation and the
+//     (order + 1)^2 gains as float16, padded to a whole number of floats
+
+#ifndef AMBI_CHOREO_H
+#define AMBI_CHOREO_H
+
+#include "AmbiSH.h"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const int AMBI_CHOREO_AHEAD_MS = 2000;      // how far ahead of playback pages are kept resident
+const int AMBI_CHOREO_POLL_MS = 50;         // how often the prefetch thread looks again
+static const char AMBI_CHOREO_MAGIC[8] = { 'A', 'M', 'B', 'I', 'C', 'H', 'O', '1' };
+static const char AMBI_BAKE_MAGIC[8] = { 'A', 'M', 'B', 'I', 'B', 'A', 'K', '1' };
+
+struct AmbiChoreoHeader
+{
+    char magic[8];              // AMBI_CHOREO_MAGIC or AMBI_BAKE_MAGIC
+    uint32_t version;           // 1
+    uint32_t nsources;          // 1 for baked gains
+    uint64_t nframes;
+    double rate;                // frames per second
+    uint64_t data_offset;       // bytes from the start of the file to frame 0
+    uint32_t order;             // order of baked gains, 0 in a choreography
+    char reserved[20];
+};
+static_assert(sizeof(AmbiChoreoHeader) == 64, "choreography header is 64 bytes");
+
+// where one voice has got to in a file; the voice owns it, and the prefetch
+// thread follows it while the voice plays
+struct AmbiChoreoCursor
+{
+    std::atomic<t_CKINT> frame;     // latest frame the voice reached, a hint for the prefetch
+    std::atomic<bool> ready;        // the AMBI_CHOREO_AHEAD_MS after frame 0 are resident
+    unsigned epoch;                 // counts the files followed, under ambi_choreo_mutex
+    size_t resident_from;           // byte range the prefetch thread has touched, by it only
+    size_t resident_to;
+
+    AmbiChoreoCursor() : frame(0), ready(false), epoch(0), resident_from(0), resident_to(0) {}
+};
+
+struct AmbiChoreo
+{
+    std::string path;
+    int refs;                       // voices holding it, under ambi_choreo_mutex
+    const char * map;
+    size_t map_size;
+    const char * frames;
+    t_CKINT nsources;
+    t_CKINT nframes;
+    t_CKFLOAT rate;
+    size_t frame_bytes;
+    t_CKINT order;                  // order of baked gains, or -1 for a choreography
+    std::vector<AmbiChoreoCursor *> cursors;    // voices playing it, under ambi_choreo_mutex
+    unsigned touched;               // sum of the bytes the prefetch thread read, by it only
+};
+
+static std::mutex ambi_choreo_mutex;
+static std::condition_variable ambi_choreo_wake;
+static std::map<std::string, AmbiChoreo *> ambi_choreo_open;
+static std::thread ambi_choreo_thread;
+static bool ambi_choreo_quit = false;
+
+// azimuth and elevation of source s at frame f
+static AMBI_INLINE void ambi_choreo_frame( const AmbiChoreo * c, t_CKINT f, t_CKINT s, t_CKFLOAT * azimuth, t_CKFLOAT * elevation )
+{
+    const float * frame = (const float *)(c->frames + f * c->frame_bytes);
+    *azimuth = frame[s];
+    *elevation = frame[c->nsources + s];
+}
+
+// position of source s at time t frames, linear between frames; azimuth and
+// elevation take the short way round between frames, and the last frame holds
+static AMBI_INLINE void ambi_choreo_at( const AmbiChoreo * c, t_CKFLOAT t, t_CKINT s, t_CKFLOAT * azimuth, t_CKFLOAT * elevation )
+{
+    t_CKINT f = (t_CKINT)t;
+    if (f >= c->nframes - 1) {
+        ambi_choreo_frame(c, c->nframes - 1, s, azimuth, elevation);
+        return;
+    }
+
+    t_CKFLOAT a0, e0, a1, e1;
+    ambi_choreo_frame(c, f, s, &a0, &e0);
+    ambi_choreo_frame(c, f + 1, s, &a1, &e1);
+    t_CKFLOAT u = t - f;
+    *azimuth = a0 + wrap_angle(a1 - a0) * u;
+    *elevation = e0 + wrap_angle(e1 - e0) * u;
+}
+
+// bytes per frame of a baked gain file: azimuth, elevation and the gains as
+// float16, padded so the next frame's floats are aligned
+static inline size_t ambi_bake_frame_bytes( t_CKINT order )
+{
+    return 2 * sizeof(float) + ((order + 1) * (order + 1) + 1) / 2 * sizeof(float);
+}
+
+// whether a voice can start playing without waiting for the disk
+static AMBI_INLINE bool ambi_choreo_ready( const AmbiChoreoCursor * k )
+{
+    return k->ready.load(std::memory_order_acquire);
+}
+
+// tell the prefetch thread where a voice has got to; relaxed, as it is only a hint
+static AMBI_INLINE void ambi_choreo_report( AmbiChoreoCursor * k, t_CKINT frame )
+{
+    k->frame.store(frame, std::memory_order_relaxed);
+}
+
+static inline size_t ambi_choreo_page_size()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// map a whole file read-only and return it and its size, or NULL if it can't be
+// opened or is too short for a header
+static inline const char * ambi_choreo_map_file( const char * path, size_t * size )
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER length;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &length) && (uint64_t)length.QuadPart >= sizeof(AmbiChoreoHeader))
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return NULL;
+
+    // the view keeps the mapping open
+    void * map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!map) return NULL;
+    *size = (size_t)length.QuadPart;
+    return (const char *)map;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void * map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(AmbiChoreoHeader))
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    *size = st.st_size;
+    return (const char *)map;
+#endif
+}
+
+static inline void ambi_choreo_unmap_file( const char * map, size_t size )
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(map);
+#else
+    munmap((void *)map, size);
+#endif
+}
+
+// read in the pages from the page-aligned from up to to, so that each is
+// resident and mapped; returns the sum of the first byte of every page, which
+// the caller keeps so the reads can't be optimized away. Windows has no
+// madvise, so there the reads alone bring the pages in
+static inline unsigned ambi_choreo_touch( const AmbiChoreo * c, size_t from, size_t to )
+{
+#ifndef _WIN32
+    madvise((void *)(c->map + from), to - from, MADV_WILLNEED);
+#endif
+    const size_t page = ambi_choreo_page_size();
+    unsigned sum = 0;
+    for (size_t b = from; b < to; b += page) sum += (unsigned char)c->map[b];
+    return sum;
+}
+
+// drop a reference with ambi_choreo_mutex held; the last one unmaps the file
+static inline void ambi_choreo_drop( AmbiChoreo * c )
+{
+    if (--c->refs > 0) return;
+    ambi_choreo_open.erase(c->path);
+    ambi_choreo_unmap_file(c->map, c->map_size);
+    delete c;
+}
+
+// keep the next AMBI_CHOREO_AHEAD_MS after every cursor of every open file
+// resident. Pages are read in without the lock held, so opening or releasing a
+// file never waits for the disk; each file is held by a reference meanwhile so
+// it stays mapped, and a cursor is only marked ready if its voice still follows
+// the same file afterwards
+static inline void ambi_choreo_prefetch_loop()
+{
+    struct Job { AmbiChoreo * c; AmbiChoreoCursor * k; unsigned epoch; size_t from, to; };
+    std::vector<Job> jobs;
+    const size_t page = ambi_choreo_page_size();
+
+    std::unique_lock<std::mutex> lock(ambi_choreo_mutex);
+    while (!ambi_choreo_quit) {
+        jobs.clear();
+        for (std::map<std::string, AmbiChoreo *>::iterator it = ambi_choreo_open.begin(); it != ambi_choreo_open.end(); ++it) {
+            AmbiChoreo * c = it->second;
+            size_t ahead = (size_t)(c->rate * AMBI_CHOREO_AHEAD_MS / 1000 + 2) * c->frame_bytes;
+            for (size_t i = 0; i < c->cursors.size(); i++) {
+                AmbiChoreoCursor * k = c->cursors[i];
+                size_t from = c->frames - c->map + k->frame.load(std::memory_order_relaxed) * c->frame_bytes;
+                size_t to = std::min(from + ahead, c->map_size);
+
+                // after a jump, start over from the new position
+                if (from < k->resident_from || from > k->resident_to) k->resident_to = from;
+                k->resident_from = from;
+                if (k->resident_to < to) {
+                    Job job = { c, k, k->epoch, k->resident_to - k->resident_to % page, to };
+                    jobs.push_back(job);
+                    k->resident_to = to;
+                    c->refs++;
+                }
+            }
+        }
+
+        lock.unlock();
+        for (size_t j = 0; j < jobs.size(); j++)
+            jobs[j].c->touched += ambi_choreo_touch(jobs[j].c, jobs[j].from, jobs[j].to);
+        lock.lock();
+
+        for (size_t j = 0; j < jobs.size(); j++) {
+            AmbiChoreo * c = jobs[j].c;
+            if (std::find(c->cursors.begin(), c->cursors.end(), jobs[j].k) != c->cursors.end() && jobs[j].k->epoch == jobs[j].epoch)
+                jobs[j].k->ready.store(true, std::memory_order_release);
+            ambi_choreo_drop(c);
+        }
+        ambi_choreo_wake.wait_for(lock, std::chrono::milliseconds(AMBI_CHOREO_POLL_MS));
+    }
+}
+
+// open a choreography or baked gain file, or take another reference to it if
+// it is open already; returns NULL if the file can't be mapped or is neither.
+// This blocks the calling thread while the file is opened and mapped and its
+// header page is read in, but never for the frames, which ambi_choreo_follow()
+// leaves to the prefetch thread
+static inline AmbiChoreo * ambi_choreo_acquire( const char * path )
+{
+    std::lock_guard<std::mutex> lock(ambi_choreo_mutex);
+    std::map<std::string, AmbiChoreo *>::iterator it = ambi_choreo_open.find(path);
+    AmbiChoreo * c = it != ambi_choreo_open.end() ? it->second : NULL;
+    if (c) {
+        c->refs++;
+    } else {
+        size_t size;
+        const char * map = ambi_choreo_map_file(path, &size);
+        if (!map) return NULL;
+
+        // the header has to describe whole frames that fit in the file; the order
+        // of baked gains is checked before it sizes a frame
+        const AmbiChoreoHeader * h = (const AmbiChoreoHeader *)map;
+        bool baked = memcmp(h->magic, AMBI_BAKE_MAGIC, 8) == 0;
+        bool valid = (baked || memcmp(h->magic, AMBI_CHOREO_MAGIC, 8) == 0) &&
+                     (!baked || (h->nsources == 1 && ((uint64_t)h->order + 1) * ((uint64_t)h->order + 1) <= MAX_CHANNELS)) &&
+                     h->version == 1 && h->nsources != 0 && h->nframes != 0 &&
+                     h->rate > 0 && h->data_offset % sizeof(float) == 0 && h->data_offset <= size;
+        size_t frame_bytes = !valid ? 0 : baked ? ambi_bake_frame_bytes(h->order) : (size_t)h->nsources * 2 * sizeof(float);
+        if (!valid || h->nframes > (size - h->data_offset) / frame_bytes) {
+            ambi_choreo_unmap_file(map, size);
+            return NULL;
+        }
+
+        c = new AmbiChoreo();
+        c->path = path;
+        c->refs = 1;
+        c->map = map;
+        c->map_size = size;
+        c->frames = c->map + h->data_offset;
+        c->nsources = h->nsources;
+        c->nframes = h->nframes;
+        c->rate = h->rate;
+        c->frame_bytes = frame_bytes;
+        c->order = baked ? (t_CKINT)h->order : -1;
+        c->touched = 0;
+        ambi_choreo_open[path] = c;
+    }
+    return c;
+}
+
+// start playing an acquired file from frame 0 with a voice's cursor, which must
+// not be following another file. The prefetch thread reads in the start of the
+// file on its own, so this never waits for the disk, and follows the cursor from
+// then on, marking it ready once playback won't wait either
+static inline void ambi_choreo_follow( AmbiChoreo * c, AmbiChoreoCursor * cursor )
+{
+    std::lock_guard<std::mutex> lock(ambi_choreo_mutex);
+    cursor->frame.store(0);
+    cursor->ready.store(false);
+    cursor->epoch++;
+    cursor->resident_from = c->frames - c->map;
+    cursor->resident_to = c->frames - c->map;
+    c->cursors.push_back(cursor);
+
+    if (!ambi_choreo_thread.joinable()) ambi_choreo_thread = std::thread(ambi_choreo_prefetch_loop);
+    ambi_choreo_wake.notify_one();
+}
+
+// drop a reference, and stop following the voice's cursor if it passes the one
+// it played the file with; the last reference unmaps the file
+static inline void ambi_choreo_release( AmbiChoreo * c, AmbiChoreoCursor * cursor = NULL )
+{
+    if (!c) return;
+    std::lock_guard<std::mutex> lock(ambi_choreo_mutex);
+    if (cursor) c->cursors.erase(std::remove(c->cursors.begin(), c->cursors.end(), cursor), c->cursors.end());
+    ambi_choreo_drop(c);
+}
+
+// write a choreography: az and el hold nframes frames of nsources values each,
+// frame by frame; returns false if the file can't be written
+static inline bool ambi_choreo_write( const char * path, t_CKINT nsources, t_CKINT nframes, t_CKFLOAT rate,
+                                      const float * az, const float * el )
+{
+    FILE * fp = fopen(path, "wb");
+    if (!fp) return false;
+
+    AmbiChoreoHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, AMBI_CHOREO_MAGIC, 8);
+    h.version = 1;
+    h.nsources = (uint32_t)nsources;
+    h.nframes = (uint64_t)nframes;
+    h.rate = rate;
+    h.data_offset = sizeof(h);
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+    for (t_CKINT f = 0; ok && f < nframes; f++)
+        ok = fwrite(az + f * nsources, sizeof(float), nsources, fp) == (size_t)nsources &&
+             fwrite(el + f * nsources, sizeof(float), nsources, fp) == (size_t)nsources;
+    return fclose(fp) == 0 && ok;
+}
+
+// the prefetch thread is stopped before the chugin unloads
+struct AmbiChoreoGuard
+{
+    ~AmbiChoreoGuard()
+    {
+        {
+            std::lock_guard<std::mutex> lock(ambi_choreo_mutex);
+            ambi_choreo_quit = true;
+        }
+        ambi_choreo_wake.notify_one();
+        if (ambi_choreo_thread.joinable()) ambi_choreo_thread.join();
+    }
+};
+static AmbiChoreoGuard ambi_choreo_guard;
+
+#endif
@@ -0,0 +1,31 @@
+// AmbiConfig.h
+// Constants, sample / gain types and small helpers shared by every chugin
+
+#ifndef AMBI_CONFIG_H
+#define AMBI_CONFIG_H
+
+#include "chugin.h"
+#include <cmath>
+#include <cstring>
+
+const int MAX_CHANNELS = 64;
+const int MAX_BLOCK_SIZE = 256;
+const int SILENCE_HOLD = 64;                // silent frames before bypassing
+const SAMPLE SILENCE_THRESHOLD = 1e-7f;     // largest magnitude still treated as silence
+const int ADAPTIVE_MAX_PERIOD = 4096;       // longest update period chosen in adaptive mode
+
+// precision of the gain state and kernels: samples are float, so float gains keep
+// every multiply single precision; build with AMBI_DOUBLE_GAINS for a double reference
+#ifdef AMBI_DOUBLE_GAINS
+typedef double ambi_gain_t;
+#else
+typedef float ambi_gain_t;
+#endif
+
+// map x from [in_min, in_max] to [out_min, out_max]
+static inline float scalef( float x, float in_min, float in_max, float out_min, float out_max )
+{
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+#endif
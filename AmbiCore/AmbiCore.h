@@ -0,0 +1,21 @@
+// AmbiCore.h
+// Chambisonics core: the SH evaluation, encoding / decoding kernels, SH rotations,
+// CPU dispatch, trajectories, runtime counters and trace points shared by AmbiEnc, AmbiPan and AmbiBin.
+// Header-only; each chugin includes this once, and its makefile adds this
+// directory to the include path. Choreography files and baked gains map files
+// with OS calls, so AmbiChoreo.h and AmbiBake.h are left out and included only
+// by the chugins that play them
+
+#ifndef AMBI_CORE_H
+#define AMBI_CORE_H
+
+#include "AmbiConfig.h"
+#include "AmbiDispatch.h"
+#include "AmbiSH.h"
+#include "AmbiKernels.h"
+#include "AmbiRotate.h"
+#include "AmbiTrajectory.h"
+#include "AmbiStats.h"
+#include "AmbiTrace.h"
+
+#endif
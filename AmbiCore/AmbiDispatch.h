@@ -0,0 +1,80 @@
+// AmbiDispatch.h
+// Runtime CPU dispatch for the kernels in AmbiSH.h and AmbiKernels.h
+
+#ifndef AMBI_DISPATCH_H
+#define AMBI_DISPATCH_H
+
+// runtime kernel dispatch: on x86 with gcc / clang every kernel is also compiled
+// for AVX2 + FMA and AVX-512, and the widest set this CPU supports is picked when
+// the chugin loads; the generic kernels are the baseline build (SSE2 on x86-64).
+// MSVC has no per-function target attribute and ARM has nothing to dispatch to,
+// so both always run the generic kernels
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define AMBI_DISPATCH 1
+#define AMBI_INLINE inline __attribute__((always_inline))
+#define AMBI_TARGET(isa) __attribute__((target(isa)))
+#define AMBI_ISA_AVX2_FLAGS "avx2,fma"
+#if defined(__clang__)
+#define AMBI_ISA_AVX512_FLAGS "avx512f,avx512dq,avx512vl,avx2,fma"
+#else
+#define AMBI_ISA_AVX512_FLAGS "avx512f,avx512dq,avx512vl,avx2,fma,prefer-vector-width=512"
+#endif
+#else
+#define AMBI_DISPATCH 0
+#define AMBI_INLINE inline
+#endif
+
+// passes template parameter lists with commas through the macros below
+#define AMBI_ARGS(...) __VA_ARGS__
+
+enum { AMBI_ISA_GENERIC, AMBI_ISA_AVX2, AMBI_ISA_AVX512 };
+
+static inline int ambi_detect_isa()
+{
+#if AMBI_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl"))
+        return AMBI_ISA_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return AMBI_ISA_AVX2;
+#endif
+    return AMBI_ISA_GENERIC;
+}
+
+// instruction set the kernels run on, picked once when the chugin loads
+static int ambi_isa = ambi_detect_isa();
+
+static inline const char * ambi_isa_name()
+{
+    switch (ambi_isa) {
+        case AMBI_ISA_AVX512: return "avx512";
+        case AMBI_ISA_AVX2: return "avx2";
+    }
+#if defined(__x86_64__) || defined(_M_X64)
+    return "sse2";
+#else
+    return "generic";
+#endif
+}
+
+// NAME##_avx2 and NAME##_avx512 wrap the always-inline generic kernel NAME, so its
+// body is compiled again for each instruction set
+#if AMBI_DISPATCH
+#define AMBI_KERNEL_CLONES(TPARAMS, NAME, TARGS, PARAMS, ARGS)                                   \
+    TPARAMS static AMBI_TARGET(AMBI_ISA_AVX2_FLAGS) void NAME##_avx2 PARAMS { NAME TARGS ARGS; } \
+    TPARAMS static AMBI_TARGET(AMBI_ISA_AVX512_FLAGS) void NAME##_avx512 PARAMS { NAME TARGS ARGS; }
+#define AMBI_CALL_KERNEL(NAME, TARGS, ARGS)                        \
+    do {                                                           \
+        switch (ambi_isa) {                                        \
+            case AMBI_ISA_AVX512: NAME##_avx512 TARGS ARGS; break; \
+            case AMBI_ISA_AVX2: NAME##_avx2 TARGS ARGS; break;     \
+            default: NAME TARGS ARGS; break;                       \
+        }                                                          \
+    } while (0)
+#else
+#define AMBI_KERNEL_CLONES(TPARAMS, NAME, TARGS, PARAMS, ARGS)
+#define AMBI_CALL_KERNEL(NAME, TARGS, ARGS) NAME TARGS ARGS
+#endif
+
+#endif
@@ -0,0 +1,220 @@
+// AmbiKernels.h
+// Encoding and decoding kernels; these run over whole segments between control events.
+// Encoders write N_CH channels per frame, STRIDE samples apart (N_CH by default)
+
+#ifndef AMBI_KERNELS_H
+#define AMBI_KERNELS_H
+
+#include "AmbiConfig.h"
+#include "AmbiDispatch.h"
+
+// out[f][c] = gain[c] * in[f]
+template<int N_CH, int STRIDE = N_CH, typename T>
+static AMBI_INLINE void encode_const( const SAMPLE * in, SAMPLE * out, int nframes, const T * gain )
+{
+    for (int f = 0; f < nframes; f++)
+        for (int c = 0; c < N_CH; c++)
+            out[f * STRIDE + c] = gain[c] * in[f];
+}
+
+// advance the forward differences of encode_ramp / encode_cubic by n frames without output
+template<typename T>
+static inline void advance_gains( int n, int nch, T * gain, T * step, T * accel, const T * jerk )
+{
+    T n1 = (T)n;
+    T n2 = n1 * (n - 1) / 2;
+    T n3 = n2 * (n - 2) / 3;
+    for (int c = 0; c < nch; c++) {
+        gain[c] += n1 * step[c] + n2 * accel[c] + n3 * jerk[c];
+        step[c] += n1 * accel[c] + n2 * jerk[c];
+        accel[c] += n1 * jerk[c];
+    }
+}
+
+// out[f][c] = gain[c] * in[f], advancing gain[c] by step[c] after every frame.
+// Gains are evaluated from the start of the segment instead of summed up frame by
+// frame, so float gains do not pick up a rounding error on every frame
+template<int N_CH, int STRIDE = N_CH, typename T>
+static AMBI_INLINE void encode_ramp( const SAMPLE * in, SAMPLE * out, int nframes, T * gain, const T * step )
+{
+    for (int f = 0; f < nframes; f++) {
+        T k = (T)f;
+        for (int c = 0; c < N_CH; c++)
+            out[f * STRIDE + c] = (gain[c] + k * step[c]) * in[f];
+    }
+
+    for (int c = 0; c < N_CH; c++) gain[c] += (T)nframes * step[c];
+}
+
+// out[f][c] = gain[c] * in[f], with gain[c] following a cubic by forward differences:
+// step[c] grows by accel[c] and accel[c] by jerk[c] after every frame. As in
+// encode_ramp, frame f is evaluated directly as
+// gain + f step + (f choose 2) accel + (f choose 3) jerk
+template<int N_CH, int STRIDE = N_CH, typename T>
+static AMBI_INLINE void encode_cubic( const SAMPLE * in, SAMPLE * out, int nframes, T * gain,
+                                      T * step, T * accel, const T * jerk )
+{
+    for (int f = 0; f < nframes; f++) {
+        T k1 = (T)f;
+        T k2 = k1 * (f - 1) / 2;
+        T k3 = k2 * (f - 2) / 3;
+        for (int c = 0; c < N_CH; c++)
+            out[f * STRIDE + c] = (gain[c] + k1 * step[c] + k2 * accel[c] + k3 * jerk[c]) * in[f];
+    }
+
+    advance_gains(nframes, N_CH, gain, step, accel, jerk);
+}
+
+// out[f][c] = sum of gain[k * N_CH + c] * in[f][k] over the first ninputs inputs,
+// which are INPUTS samples apart. Inputs are taken two at a time into one sum per
+// channel, which keeps the compiler vectorizing along the channels rather than
+// across the inputs
+template<int N_CH, int INPUTS, typename T>
+static AMBI_INLINE void encode_multi_const( const SAMPLE * in, SAMPLE * out, int nframes, int ninputs, const T * gain )
+{
+    for (int f = 0; f < nframes; f++) {
+        const SAMPLE * x = in + f * INPUTS;
+        T acc[N_CH];
+        for (int c = 0; c < N_CH; c++) acc[c] = gain[c] * x[0];
+
+        int k = 1;
+        for (; k + 1 < ninputs; k += 2) {
+            const T * g0 = gain + k * N_CH;
+            const T * g1 = g0 + N_CH;
+            T x0 = x[k], x1 = x[k + 1];
+            for (int c = 0; c < N_CH; c++) acc[c] += g0[c] * x0 + g1[c] * x1;
+        }
+        if (k < ninputs) {
+            const T * g0 = gain + k * N_CH;
+            T x0 = x[k];
+            for (int c = 0; c < N_CH; c++) acc[c] += g0[c] * x0;
+        }
+
+        for (int c = 0; c < N_CH; c++) out[f * N_CH + c] = acc[c];
+    }
+}
+
+// encode_multi_const, with every gain advancing by its step after every frame as
+// in encode_ramp
+template<int N_CH, int INPUTS, typename T>
+static AMBI_INLINE void encode_multi_ramp( const SAMPLE * in, SAMPLE * out, int nframes, int ninputs, T * gain, const T * step )
+{
+    for (int f = 0; f < nframes; f++) {
+        const SAMPLE * x = in + f * INPUTS;
+        T k1 = (T)f;
+        T acc[N_CH];
+        for (int c = 0; c < N_CH; c++) acc[c] = (gain[c] + k1 * step[c]) * x[0];
+
+        int k = 1;
+        for (; k + 1 < ninputs; k += 2) {
+            const T * g0 = gain + k * N_CH, * s0 = step + k * N_CH;
+            const T * g1 = g0 + N_CH, * s1 = s0 + N_CH;
+            T x0 = x[k], x1 = x[k + 1];
+            for (int c = 0; c < N_CH; c++) acc[c] += (g0[c] + k1 * s0[c]) * x0 + (g1[c] + k1 * s1[c]) * x1;
+        }
+        if (k < ninputs) {
+            const T * g0 = gain + k * N_CH, * s0 = step + k * N_CH;
+            T x0 = x[k];
+            for (int c = 0; c < N_CH; c++) acc[c] += (g0[c] + k1 * s0[c]) * x0;
+        }
+
+        for (int c = 0; c < N_CH; c++) out[f * N_CH + c] = acc[c];
+    }
+
+    for (int i = 0; i < ninputs * N_CH; i++) gain[i] += (T)nframes * step[i];
+}
+
+// decoding kernel: out[f] = (dL . in[f], dR . in[f])
+template<int N_CH>
+static AMBI_INLINE void decode( const SAMPLE * in, SAMPLE * out, int nframes, const float * dL, const float * dR )
+{
+    for (int f = 0; f < nframes; f++) {
+        float L = 0.f, R = 0.f;
+        for (int c = 0; c < N_CH; c++) {
+            float s = in[f * N_CH + c];
+            L += dL[c] * s;
+            R += dR[c] * s;
+        }
+        out[f * 2 + 0] = L;
+        out[f * 2 + 1] = R;
+    }
+}
+
+AMBI_KERNEL_CLONES(AMBI_ARGS(template<int N_CH, int STRIDE = N_CH, typename T>), encode_const, AMBI_ARGS(<N_CH, STRIDE>),
+                   (const SAMPLE * in, SAMPLE * out, int nframes, const T * gain),
+                   (in, out, nframes, gain))
+AMBI_KERNEL_CLONES(AMBI_ARGS(template<int N_CH, int STRIDE = N_CH, typename T>), encode_ramp, AMBI_ARGS(<N_CH, STRIDE>),
+                   (const SAMPLE * in, SAMPLE * out, int nframes, T * gain, const T * step),
+                   (in, out, nframes, gain, step))
+AMBI_KERNEL_CLONES(AMBI_ARGS(template<int N_CH, int STRIDE = N_CH, typename T>), encode_cubic, AMBI_ARGS(<N_CH, STRIDE>),
+                   (const SAMPLE * in, SAMPLE * out, int nframes, T * gain,
+                    T * step, T * accel, const T * jerk),
+                   (in, out, nframes, gain, step, accel, jerk))
+AMBI_KERNEL_CLONES(AMBI_ARGS(template<int N_CH, int INPUTS, typename T>), encode_multi_const, AMBI_ARGS(<N_CH, INPUTS>),
+                   (const SAMPLE * in, SAMPLE * out, int nframes, int ninputs, const T * gain),
+                   (in, out, nframes, ninputs, gain))
+AMBI_KERNEL_CLONES(AMBI_ARGS(template<int N_CH, int INPUTS, typename T>), encode_multi_ramp, AMBI_ARGS(<N_CH, INPUTS>),
+                   (const SAMPLE * in, SAMPLE * out, int nframes, int ninputs, T * gain, const T * step),
+                   (in, out, nframes, ninputs, gain, step))
+AMBI_KERNEL_CLONES(template<int N_CH>, decode, <N_CH>,
+                   (const SAMPLE * in, SAMPLE * out, int nframes, const float * dL, const float * dR),
+                   (in, out, nframes, dL, dR))
+
+// longest update period that keeps interpolated gains within max_error of the
+// true gains for a source whose azimuth and elevation together move omega
+// radians per sample; the k-th derivative of an order-N gain curve is then at
+// most (N * omega)^k, and over P samples linear interpolation is off by at most
+// P^2 / 8 times the 2nd, cubic Hermite with estimated slopes by P^3 / 24 times the 3rd.
+// omega is |d azimuth| + |d elevation| rather than the speed over the sphere:
+// every SN3D gain of order N is a sum of terms e^(i (m azimuth + n elevation))
+// with |m|, |n| <= N and is at most 1, so along any linear motion of the angles
+// its frequency is at most N * omega and Bernstein's inequality gives the bound
+// above. The speed over the sphere, |d azimuth| cos(elevation) combined with
+// |d elevation|, misses the curvature of circles of constant elevation; for
+// azimuth motion it let first order gains stray 2x max_error at 60 degrees
+// elevation and 30x at 89, and 7th order 6x at 89. Along a
+// great circle the gains are trig polynomials of degree N in the angle turned,
+// so there omega is that angle per sample
+static inline t_CKINT adaptive_period( t_CKFLOAT omega, t_CKINT order, t_CKFLOAT max_error, bool hermite )
+{
+    if (omega <= 0) return ADAPTIVE_MAX_PERIOD;
+    t_CKFLOAT p = hermite ? cbrt(24 * max_error) : sqrt(8 * max_error);
+    p /= order * omega;
+    if (p < 1) return 1;
+    if (p > ADAPTIVE_MAX_PERIOD) return ADAPTIVE_MAX_PERIOD;
+    return (t_CKINT)p;
+}
+
+// true if every input sample is within the silence threshold
+static inline bool is_silent( const SAMPLE * in, int nsamples )
+{
+    for (int i = 0; i < nsamples; i++)
+        if (fabs(in[i]) > SILENCE_THRESHOLD) return false;
+    return true;
+}
+
+// hysteresis shared by the bypasses: silent_frames counts the consecutive silent
+// frames, and silence is only reported once SILENCE_HOLD of them have gone by
+static inline bool hold_silence( const SAMPLE * in, int nsamples, int nframes, t_CKINT * silent_frames )
+{
+    if (!is_silent(in, nsamples)) {
+        *silent_frames = 0;
+        return false;
+    }
+
+    if (*silent_frames < SILENCE_HOLD) *silent_frames += nframes;
+    return *silent_frames >= SILENCE_HOLD;
+}
+
+// zero the output of a bypassed block; the samples themselves are checked, as the
+// host may have written something else into the same buffer since the last block
+static inline void clear_output( SAMPLE * out, int nsamples )
+{
+    for (int i = 0; i < nsamples; i++)
+        if (out[i] != 0) {
+            memset(out + i, 0, sizeof(SAMPLE) * (nsamples - i));
+            return;
+        }
+}
+
+#endif
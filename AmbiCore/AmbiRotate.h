@@ -0,0 +1,206 @@
+// AmbiRotate.h
+// Rotation of a whole sound field in the SH domain. A rotation never mixes
+// channels of different degrees, so it is one (2l + 1) x (2l + 1) block per
+// degree l, packed one after the other. The blocks are fitted rather than built
+// by recurrence: the SH gains of AMBI_ROT_DIRECTIONS fixed directions and of the
+// same directions rotated give M Y(d) = Y(R d) for every one, solved once per
+// rotation against a pseudo-inverse worked out when the library is first used.
+// Applying the blocks costs the same whatever is encoded on the bus, so moving
+// a group of sources costs one rotation however many sources it holds
+
+#ifndef AMBI_ROTATE_H
+#define AMBI_ROTATE_H
+
+#include "AmbiSH.h"
+#include "AmbiKernels.h"
+#include <algorithm>
+
+const int AMBI_ROT_DIRECTIONS = 32;         // fitting directions, at least 2 * MAX_ORDER + 1
+
+// offset of the block of degree l, and the size of all blocks up to order N at offset(N + 1)
+static constexpr int ambi_rot_offset( int l )
+{
+    return l * (2 * l - 1) * (2 * l + 1) / 3;
+}
+
+const int AMBI_ROT_SIZE = ambi_rot_offset(8);   // every block up to 7th order
+
+struct AmbiRotationBasis
+{
+    double dir[AMBI_ROT_DIRECTIONS][3];
+    // per channel c of degree l, row c - l^2 of (A A^T)^-1 A, where A holds the
+    // degree l gains of every direction
+    double pinv[MAX_CHANNELS][AMBI_ROT_DIRECTIONS];
+};
+
+// directions on a Fibonacci spiral, which covers the sphere evenly enough for
+// every degree block to be well conditioned, and their pseudo-inverse per degree
+static void compute_rotation_basis( AmbiRotationBasis * b )
+{
+    const int K = AMBI_ROT_DIRECTIONS;
+    const float * coeffs = sh_coeffs();
+    double g[AMBI_ROT_DIRECTIONS][MAX_CHANNELS];
+
+    for (int k = 0; k < K; k++) {
+        double z = 1 - (2 * k + 1.0) / K;
+        double r = sqrt(1 - z * z);
+        double a = k * M_PI * (3 - sqrt(5.0));
+        b->dir[k][0] = r * cos(a);
+        b->dir[k][1] = r * sin(a);
+        b->dir[k][2] = z;
+        sh_gains_xyz(b->dir[k][0], b->dir[k][1], b->dir[k][2], 7, coeffs, g[k], 1);
+    }
+
+    for (int l = 0; l * l < MAX_CHANNELS; l++) {
+        const int n = 2 * l + 1, base = l * l;
+
+        // G = A A^T next to the identity, then Gauss-Jordan with partial pivoting
+        double G[15][30];
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) {
+                double s = 0;
+                for (int k = 0; k < K; k++) s += g[k][base + i] * g[k][base + j];
+                G[i][j] = s;
+                G[i][n + j] = i == j;
+            }
+        for (int c = 0; c < n; c++) {
+            int p = c;
+            for (int i = c + 1; i < n; i++) if (fabs(G[i][c]) > fabs(G[p][c])) p = i;
+            for (int j = 0; j < 2 * n; j++) std::swap(G[c][j], G[p][j]);
+            double d = G[c][c];
+            for (int j = 0; j < 2 * n; j++) G[c][j] /= d;
+            for (int i = 0; i < n; i++) {
+                if (i == c) continue;
+                double f = G[i][c];
+                for (int j = 0; j < 2 * n; j++) G[i][j] -= f * G[c][j];
+            }
+        }
+
+        for (int i = 0; i < n; i++)
+            for (int k = 0; k < K; k++) {
+                double s = 0;
+                for (int j = 0; j < n; j++) s += G[i][n + j] * g[k][base + j];
+                b->pinv[base + i][k] = s;
+            }
+    }
+}
+
+static const AmbiRotationBasis * ambi_rotation_basis()
+{
+    static AmbiRotationBasis basis;
+    static bool ready = (compute_rotation_basis(&basis), true);
+    (void)ready;
+    return &basis;
+}
+
+// Blocks are stored column by column: entry j * n + i of the block of degree l
+// takes input channel l^2 + j to output channel l^2 + i
+
+// blocks that leave the field as it is
+template<typename T>
+static void ambi_rotation_identity( int order, T * m )
+{
+    for (int l = 0; l <= order; l++) {
+        const int n = 2 * l + 1;
+        T * block = m + ambi_rot_offset(l);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) block[i * n + j] = i == j;
+    }
+}
+
+// blocks up to the given order for the rotation that turns by roll about the x
+// axis, then lifts by pitch towards the z axis, then turns by yaw about the z
+// axis; with pitch and roll at 0 every source moves yaw further in azimuth
+template<typename T>
+static void ambi_rotation( t_CKFLOAT yaw, t_CKFLOAT pitch, t_CKFLOAT roll, int order, T * m )
+{
+    const AmbiRotationBasis * b = ambi_rotation_basis();
+    const float * coeffs = sh_coeffs();
+
+    double cy = cos(yaw), sy = sin(yaw), cp = cos(pitch), sp = sin(pitch), cr = cos(roll), sr = sin(roll);
+    const double R[3][3] = {
+        { cy * cp, cy * -sp * sr - sy * cr, cy * -sp * cr + sy * sr },
+        { sy * cp, sy * -sp * sr + cy * cr, sy * -sp * cr - cy * sr },
+        { sp,      cp * sr,                 cp * cr                 },
+    };
+
+    double g[AMBI_ROT_DIRECTIONS][MAX_CHANNELS];
+    for (int k = 0; k < AMBI_ROT_DIRECTIONS; k++) {
+        const double * d = b->dir[k];
+        sh_gains_xyz(R[0][0] * d[0] + R[0][1] * d[1] + R[0][2] * d[2],
+                     R[1][0] * d[0] + R[1][1] * d[1] + R[1][2] * d[2],
+                     R[2][0] * d[0] + R[2][1] * d[1] + R[2][2] * d[2], order, coeffs, g[k], 1);
+    }
+
+    for (int l = 0; l <= order; l++) {
+        const int n = 2 * l + 1, base = l * l;
+        T * block = m + ambi_rot_offset(l);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) {
+                double s = 0;
+                for (int k = 0; k < AMBI_ROT_DIRECTIONS; k++) s += g[k][base + i] * b->pinv[base + j][k];
+                block[j * n + i] = (T)s;
+            }
+    }
+}
+
+// y = M x for the block of degree L, one input channel at a time so that the
+// columns are contiguous and of a size the compiler knows
+template<int L, typename T>
+static AMBI_INLINE void rotate_degree( const SAMPLE * x, SAMPLE * y, const T * m, const T * step, T k )
+{
+    const int n = 2 * L + 1, base = L * L;
+    T acc[n];
+    for (int i = 0; i < n; i++) acc[i] = 0;
+    for (int j = 0; j < n; j++) {
+        T xj = x[base + j];
+        for (int i = 0; i < n; i++) acc[i] += (step ? m[j * n + i] + k * step[j * n + i] : m[j * n + i]) * xj;
+    }
+    for (int i = 0; i < n; i++) y[base + i] = acc[i];
+}
+
+// every degree from L up to ORDER
+template<int L, int ORDER, typename T>
+struct AmbiRotateDegrees
+{
+    static AMBI_INLINE void run( const SAMPLE * x, SAMPLE * y, const T * m, const T * step, T k )
+    {
+        const int off = ambi_rot_offset(L);
+        rotate_degree<L>(x, y, m + off, step ? step + off : NULL, k);
+        AmbiRotateDegrees<L + 1, ORDER, T>::run(x, y, m, step, k);
+    }
+};
+
+template<int ORDER, typename T>
+struct AmbiRotateDegrees<ORDER + 1, ORDER, T>
+{
+    static AMBI_INLINE void run( const SAMPLE *, SAMPLE *, const T *, const T *, T ) {}
+};
+
+// out[f] = M in[f], block by block up to ORDER; frames are STRIDE samples apart
+template<int ORDER, int STRIDE, typename T>
+static AMBI_INLINE void rotate_const( const SAMPLE * in, SAMPLE * out, int nframes, const T * m )
+{
+    for (int f = 0; f < nframes; f++)
+        AmbiRotateDegrees<0, ORDER, T>::run(in + f * STRIDE, out + f * STRIDE, m, (const T *)NULL, 0);
+}
+
+// as rotate_const, with every entry of M advancing by step after every frame;
+// like encode_ramp, the entries are evaluated from the start of the segment
+template<int ORDER, int STRIDE, typename T>
+static AMBI_INLINE void rotate_ramp( const SAMPLE * in, SAMPLE * out, int nframes, T * m, const T * step )
+{
+    for (int f = 0; f < nframes; f++)
+        AmbiRotateDegrees<0, ORDER, T>::run(in + f * STRIDE, out + f * STRIDE, m, step, (T)f);
+
+    for (int e = 0; e < ambi_rot_offset(ORDER + 1); e++) m[e] += (T)nframes * step[e];
+}
+
+AMBI_KERNEL_CLONES(AMBI_ARGS(template<int ORDER, int STRIDE, typename T>), rotate_const, AMBI_ARGS(<ORDER, STRIDE>),
+                   (const SAMPLE * in, SAMPLE * out, int nframes, const T * m),
+                   (in, out, nframes, m))
+AMBI_KERNEL_CLONES(AMBI_ARGS(template<int ORDER, int STRIDE, typename T>), rotate_ramp, AMBI_ARGS(<ORDER, STRIDE>),
+                   (const SAMPLE * in, SAMPLE * out, int nframes, T * m, const T * step),
+                   (in, out, nframes, m, step))
+
+#endif
@@ -0,0 +1,351 @@
+// AmbiSH.h
+// ACN / SN3D spherical harmonic gains up to 7th order
+
+#ifndef AMBI_SH_H
+#define AMBI_SH_H
+
+#include "AmbiConfig.h"
+#include "AmbiDispatch.h"
+
+// angle folded into [-pi, pi]; gains repeat every 2 pi in azimuth and elevation.
+// Adding 1.5 * 2^52 rounds to the nearest turn without a branch, so this also
+// vectorizes; angles already in range come back unchanged
+static AMBI_INLINE t_CKFLOAT wrap_angle( t_CKFLOAT a )
+{
+    t_CKFLOAT k = (a * (0.5 / M_PI) + 6755399441055744.0) - 6755399441055744.0;
+    return a - k * (2 * M_PI);
+}
+
+// sin and cos of x in [-pi, pi], to within about 1e-7, without branches or libm:
+// x is reduced by the nearest multiple of pi/2 (adding 1.5 * 2^23 rounds it; pi/2
+// is split in two so the reduction stays exact for |x| <= pi) and the minimax
+// polynomials of the Cephes sinf / cosf cover the remaining [-pi/4, pi/4]
+static AMBI_INLINE void fast_sincos( float x, float * s, float * c )
+{
+    float q = (x * (float)M_2_PI + 12582912.f) - 12582912.f;
+    int j = (int)q;
+    float y = (x - q * 1.5703125f) - q * 4.8382679e-4f;
+    float z = y * y;
+
+    float sy = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * y + y;
+    float cy = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+
+    // odd quadrants swap sin and cos, then signs follow the quadrant
+    float rs = (j & 1) ? cy : sy;
+    float rc = (j & 1) ? sy : cy;
+    *s = (j & 2) ? -rs : rs;
+    *c = ((j + 1) & 2) ? -rc : rc;
+}
+
+// SN3D normalization constants for every ACN channel up to 7th order
+static void compute_coeffs( float * coeffs )
+{
+    // 1st order — 4 channels
+    coeffs[0] = 1.;
+    coeffs[1] = 1.;
+    coeffs[2] = 1.;
+    coeffs[3] = 1.;
+
+    // 2nd order — 9 channels
+    coeffs[4] = sqrt(3);
+    coeffs[5] = (1. / 4.) * sqrt(3);
+    coeffs[6] = (3. / 2.);
+    coeffs[7] = (1. / 4.) * sqrt(3);
+    coeffs[8] = (1. / 2.) * sqrt(3);
+
+    // 3rd order — 16 channels
+    coeffs[9]  = (1. / 4.) * sqrt(10);
+    coeffs[10] = sqrt(15);
+    coeffs[11] = (1. / 4.) * sqrt(6);
+    coeffs[12] = (1. / 2.);
+    coeffs[13] = (1. / 4.) * sqrt(6);
+    coeffs[14] = (1. / 2.) * sqrt(15);
+    coeffs[15] = (1. / 4.) * sqrt(10);
+
+    // 4th order — 25 channels
+    coeffs[16] = (1. / 32.) * sqrt(35);
+    coeffs[17] = (1. / 4.) * sqrt(70);
+    coeffs[18] = (1. / 2.) * sqrt(5);
+    coeffs[19] = (1. / 4.) * sqrt(10);
+    coeffs[20] = (35. / 8.);
+    coeffs[21] = (1. / 4.) * sqrt(10);
+    coeffs[22] = (1. / 4.) * sqrt(5);
+    coeffs[23] = (1. / 4.) * sqrt(70);
+    coeffs[24] = sqrt(35);
+
+    // 5th order — 36 channels
+    coeffs[25] = (3. / 16.) * sqrt(14);
+    coeffs[26] = (3. / 64.) * sqrt(35);
+    coeffs[27] = (-1. / 16.) * sqrt(70);
+    coeffs[28] = (1. / 2.) * sqrt(105);
+    coeffs[29] = (1. / 8.) * sqrt(15);
+    coeffs[30] = (1. / 8.);
+    coeffs[31] = (1. / 8.) * sqrt(15);
+    coeffs[32] = (1. / 4.) * sqrt(105);
+    coeffs[33] = (-1. / 16.) * sqrt(70);
+    coeffs[34] = (3. / 8.) * sqrt(35);
+    coeffs[35] = (3. / 128.) * sqrt(14);
+
+    // 6th order — 49 channels
+    coeffs[36] = (1. / 16.) * sqrt(462);
+    coeffs[37] = (3. / 16.) * sqrt(154);
+    coeffs[38] = (3. / 256.) * sqrt(7);
+    coeffs[39] = (-1. / 16.) * sqrt(210);
+    coeffs[40] = (1. / 16.) * sqrt(210);
+    coeffs[41] = (1. / 8.) * sqrt(21);
+    coeffs[42] = (231. / 16.);
+    coeffs[43] = (1. / 8.);
+    coeffs[44] = (1. / 32.) * sqrt(210);
+    coeffs[45] = (-1. / 16.) * sqrt(210);
+    coeffs[46] = (3. / 16.) * sqrt(7);
+    coeffs[47] = (3. / 256.) * sqrt(154);
+    coeffs[48] = (1. / 256.) * sqrt(462);
+
+    // 7th order — 64 channels
+    coeffs[49] = (1. / 32.) * sqrt(429);
+    coeffs[50] = (1. / 512.) * sqrt(6006);
+    coeffs[51] = (1. / 32.) * sqrt(231);
+    coeffs[52] = (1. / 512.) * sqrt(231);
+    coeffs[53] = (-1. / 32.) * sqrt(21);
+    coeffs[54] = (1. / 16.) * sqrt(42);
+    coeffs[55] = (1. / 32.) * sqrt(7);
+    coeffs[56] = (1. / 16.);
+    coeffs[57] = (1. / 32.) * sqrt(7);
+    coeffs[58] = (1. / 32.) * sqrt(42);
+    coeffs[59] = (-1. / 32.) * sqrt(21);
+    coeffs[60] = (1. / 16.) * sqrt(231);
+    coeffs[61] = (1. / 32.) * sqrt(231);
+    coeffs[62] = (1. / 512.) * sqrt(6006);
+    coeffs[63] = (1. / 32.) * sqrt(429);
+}
+
+// ACN / SN3D gains of one direction up to the given order, from the sines and
+// cosines of its azimuth and elevation; channel c is written to gains[c * stride]
+template<typename T>
+static AMBI_INLINE void sh_gains_sincos( float sinA, float cosA, float sinE, float cosE,
+                                         int order, const float * coeffs, T * gains, int stride )
+{
+    // azimuth repeated expressions
+    float sinA2 = sinA * sinA;
+
+    float sin2A = 2 * sinA * cosA;
+    float cos2A = cosA * cosA - sinA2;
+
+    float sin3A = 2 * cosA * sin2A - sinA;
+    float cos3A = 2 * cosA * cos2A - cosA;
+
+    float sin4A = 2 * cosA * sin3A - sin2A;
+    float cos4A = 2 * cosA * cos3A - cos2A;
+
+    float sin5A = 2 * cosA * sin4A - sin3A;
+    float cos5A = 2 * cosA * cos4A - cos3A;
+
+    float sin6A = 2 * cosA * sin5A - sin4A;
+    float cos6A = 2 * cosA * cos5A - cos4A;
+
+    // elevation repeated expressions
+    float sinE2 = sinE * sinE;
+
+    float cosE2 = cosE * cosE;
+    float cosE3 = cosE2 * cosE;
+    float cosE4 = cosE2 * cosE2;
+    float cosE5 = cosE4 * cosE;
+    float cosE6 = cosE4 * cosE2;
+    float cosE7 = cosE6 * cosE;
+
+    float sin2E = 2 * sinE * cosE;
+    float cos2E = cosE2 - sinE2;
+
+    float sin3E = 2 * cosE * sin2E - sinE;
+
+    float cos2E_12 = (cos2E + 1) * (cos2E + 1);
+    float cos2E_13 = cos2E_12 * (cos2E + 1);
+
+    // compute gains based on the order
+    // 1st order — 4 channels
+    if (order >= 1) {
+        gains[0 * stride] = 1;
+        gains[1 * stride] = sinA * cosE;
+        gains[2 * stride] = sinE;
+        gains[3 * stride] = cosE * cosA;
+    }
+
+    // 2nd order — 9 channels
+    if (order >= 2) {
+        gains[4 * stride] = coeffs[4] * sinA * cosE2 * cosA;
+        gains[5 * stride] = coeffs[5] * 2 * sin2E * sinA;
+        gains[6 * stride] = coeffs[6] * sinE2 - 0.5f;
+        gains[7 * stride] = coeffs[7] * 2 * sin2E * cosA;
+        gains[8 * stride] = coeffs[8] * cosE2 * cos2A;
+    }
+
+    // 3rd order — 16 channels
+    if (order >= 3) {
+        gains[9 * stride]  = coeffs[9]  * (3 - 4 * sinA2) * sinA * cosE3;
+        gains[10 * stride] = coeffs[10] * sinE * sinA * cosE2 * cosA;
+        gains[11 * stride] = coeffs[11] * (5 * sinE2 - 1) * sinA * cosE;
+        gains[12 * stride] = coeffs[12] * (5 * sinE2 - 3) * sinE;
+        gains[13 * stride] = coeffs[13] * (5 * sinE2 - 1) * cosE * cosA;
+        gains[14 * stride] = coeffs[14] * sinE * cosE2 * cos2A;
+        gains[15 * stride] = coeffs[15] * (1 - 4 * sinA2) * cosE3 * cosA;
+    }
+
+    // 4th order — 25 channels
+    if (order >= 4) {
+        gains[16 * stride] = coeffs[16] * cos2E_12 * sin4A;
+        gains[17 * stride] = coeffs[17] * (3 - 4 * sinA2) * sinE * sinA * cosE3;
+        gains[18 * stride] = coeffs[18] * (7 * sinE2 - 1) * sinA * cosE2 * cosA;
+        gains[19 * stride] = coeffs[19] * (7 * sinE2 - 3) * sinE * sinA * cosE;
+        gains[20 * stride] = (coeffs[20] * sinE2 - 3.75f) * sinE2 + 0.375f;
+        gains[21 * stride] = coeffs[21] * (7 * sinE2 - 3) * sinE * cosE * cosA;
+        gains[22 * stride] = coeffs[22] * (7 * sinE2 - 1) * cosE2 * cos2A;
+        gains[23 * stride] = coeffs[23] * (1 - 4 * sinA2) * sinE * cosE3 * cosA;
+        gains[24 * stride] = coeffs[24] * ((sinA2 - 1) * sinA2 + 0.125f) * cosE4;
+    }
+
+    // 5th order — 36 channels
+    if (order >= 5) {
+        gains[25 * stride] = coeffs[25] * ((16 * sinA2 - 20) * sinA2 + 5) * sinA * cosE5;
+        gains[26 * stride] = coeffs[26] * cos2E_12 * 2 * sinE * sin4A;
+        gains[27 * stride] = coeffs[27] * (9 * sinE2 - 1) * (4 * sinA2 - 3) * sinA * cosE3;
+        gains[28 * stride] = coeffs[28] * (3 * sinE2 - 1) * sinE * sinA * cosE2 * cosA;
+        gains[29 * stride] = coeffs[29] * ((21 * sinE2 - 14) * sinE2 + 1) * sinA * cosE;
+        gains[30 * stride] = coeffs[30] * ((63 * sinE2 - 70) * sinE2 + 15) * sinE;
+        gains[31 * stride] = coeffs[31] * ((21 * sinE2 - 14) * sinE2 + 1) * cosE * cosA;
+        gains[32 * stride] = coeffs[32] * (3 * sinE2 - 1) * sinE * cosE2 * cos2A;
+        gains[33 * stride] = coeffs[33] * (9 * sinE2 - 1) * (4 * sinA2 - 1) * cosE3 * cosA;
+        gains[34 * stride] = coeffs[34] * ((8 * sinA2 - 8) * sinA2 + 1) * sinE * cosE4;
+        gains[35 * stride] = coeffs[35] * cos2E_12 * 2 * cosE * cos5A;
+    }
+
+    // 6th order — 49 channels
+    if (order >= 6) {
+        gains[36 * stride] = coeffs[36] * ((16 * sinA2 - 16) * sinA2 + 3) * sinA * cosE6 * cosA;
+        gains[37 * stride] = coeffs[37] * ((16 * sinA2 - 20) * sinA2 + 5) * sinE * sinA * cosE5;
+        gains[38 * stride] = coeffs[38] * cos2E_12 * sin4A * (18 - 22 * cos2E);
+        gains[39 * stride] = coeffs[39] * (11 * sinE2 - 3) * (4 * sinA2 - 3) * sinE * sinA * cosE3;
+        gains[40 * stride] = coeffs[40] * ((33 * sinE2 - 18) * sinE2 + 1) * sinA * cosE2 * cosA;
+        gains[41 * stride] = coeffs[41] * ((33 * sinE2 - 30) * sinE2 + 5) * sinE * sinA * cosE;
+        gains[42 * stride] = ((coeffs[42] * sinE2 - 19.6875f) * sinE2 + 6.5625f) * sinE2 - 0.3125f;
+        gains[43 * stride] = coeffs[43] * 4.58257569496f * ((33 * sinE2 - 30) * sinE2 + 5) * sinE * cosE * cosA;
+        gains[44 * stride] = coeffs[44] * ((33 * sinE2 - 18) * sinE2 + 1) * cosE2 * cos2A;
+        gains[45 * stride] = coeffs[45] * (11 * sinE2 - 3) * (4 * sinA2 - 1) * sinE * cosE3 * cosA;
+        gains[46 * stride] = coeffs[46] * (11 * sinE2 - 1) * ((8 * sinA2 - 8) * sinA2 + 1) * cosE4;
+        gains[47 * stride] = coeffs[47] * 2 * sin2E * cos5A * cos2E_12;
+        gains[48 * stride] = coeffs[48] * cos2E_13 * cos6A;
+    }
+
+    // 7th order — 64 channels
+    if (order >= 7) {
+        gains[49 * stride] = coeffs[49] * (((-64 * sinA2 + 112) * sinA2 - 56) * sinA2 + 7) * sinA * cosE7;
+        gains[50 * stride] = coeffs[50] * cos2E_13 * (2 * sinE * sin6A);
+        gains[51 * stride] = coeffs[51] * (13 * sinE2 - 1) * ((16 * sinA2 - 20) * sinA2 + 5) * sinA * cosE5;
+        gains[52 * stride] = coeffs[52] * cos2E_12 * sin4A * (54 * sinE - 26 * sin3E);
+        gains[53 * stride] = coeffs[53] * (4 * sinA2 - 3) * ((143 * sinE2 - 66) * sinE2 + 3) * sinA * cosE3;
+        gains[54 * stride] = coeffs[54] * ((143 * sinE2 - 110) * sinE2 + 15) * sinE * sinA * cosE2 * cosA;
+        gains[55 * stride] = coeffs[55] * (((429 * sinE2 - 495) * sinE2 + 135) * sinE2 - 5) * sinA * cosE;
+        gains[56 * stride] = coeffs[56] * (((429 * sinE2 - 693) * sinE2 + 315) * sinE2 - 35) * sinE;
+        gains[57 * stride] = coeffs[57] * (((429 * sinE2 - 495) * sinE2 + 135) * sinE2 - 5) * cosE * cosA;
+        gains[58 * stride] = coeffs[58] * ((143 * sinE2 - 110) * sinE2 + 15) * sinE * cosE2 * cos2A;
+        gains[59 * stride] = coeffs[59] * (4 * sinA2 - 1) * ((143 * sinE2 - 66) * sinE2 + 3) * cosE3 * cosA;
+        gains[60 * stride] = coeffs[60] * (13 * sinE2 - 3) * ((8 * sinA2 - 8) * sinA2 + 1) * sinE * cosE4;
+        gains[61 * stride] = coeffs[61] * (13 * sinE2 - 1) * ((16 * sinA2 - 12) * sinA2 + 1) * cosE5 * cosA;
+        gains[62 * stride] = coeffs[62] * (2 * sinE * cos6A) * cos2E_13;
+        gains[63 * stride] = coeffs[63] * (((-64 * sinA2 + 80) * sinA2 - 24) * sinA2 + 1) * cosE7 * cosA;
+    }
+}
+
+// ACN / SN3D gains of one direction up to the given order, with azimuth and
+// elevation already in [-pi, pi]; channel c is written to gains[c * stride]
+template<typename T>
+static AMBI_INLINE void sh_gains( float azimuth, float elevation, int order, const float * coeffs, T * gains, int stride )
+{
+    float sinA, cosA, sinE, cosE;
+    fast_sincos(azimuth, &sinA, &cosA);
+    fast_sincos(elevation, &sinE, &cosE);
+    sh_gains_sincos(sinA, cosA, sinE, cosE, order, coeffs, gains, stride);
+}
+
+// ACN / SN3D gains of the direction (x, y, z), x to the front, y to the left and z
+// up, of any length but zero. The sines and cosines come straight from the
+// components, so there is no trig at all; straight up or down takes azimuth 0
+template<typename T>
+static AMBI_INLINE void sh_gains_xyz( double x, double y, double z, int order, const float * coeffs, T * gains, int stride )
+{
+    double h = sqrt(x * x + y * y);
+    double r = sqrt(h * h + z * z);
+    float sinA = h > 0 ? (float)(y / h) : 0.f;
+    float cosA = h > 0 ? (float)(x / h) : 1.f;
+    sh_gains_sincos(sinA, cosA, (float)(z / r), (float)(h / r), order, coeffs, gains, stride);
+}
+
+// coefficients shared by every batch evaluation
+static inline const float * sh_coeffs()
+{
+    static float coeffs[MAX_CHANNELS];
+    static bool ready = (compute_coeffs(coeffs), true);
+    (void)ready;
+    return coeffs;
+}
+
+// sources gathered per batched evaluation when panning many at once
+const int AMBI_BATCH_SOURCES = 64;
+
+// sources evaluated side by side before their gains are handed out; 16 lanes of
+// 7th order gains are 4 KB and stay in L1 while they are copied to the sources
+const int AMBI_BATCH_LANES = 16;
+
+// ACN / SN3D gains for a bank of directions: channel c of source s goes to
+// gains[s][c], which is usually the gain buffer of the panner itself. Sources
+// are evaluated AMBI_BATCH_LANES at a time, one per SIMD lane, into a block that
+// is then copied out source by source; the last few go one at a time. Writing
+// into a full [channel][source] matrix and copying that out cost as much as one
+// source at a time from 3rd order up, because the stores dominated. The stores
+// still bound this one: with AVX2 or AVX-512 a source costs 2-4x less than one
+// at a time at every order, with SSE2 1.5-2x less, and nowhere near 10x. The
+// gains are written as T, the panners' gain type, so a batch matches what each
+// source would have evaluated on its own
+template<int ORDER, typename T>
+static AMBI_INLINE void sh_gains_bank( int nsources, const t_CKFLOAT * azimuth, const t_CKFLOAT * elevation,
+                                       const float * coeffs, T * const * gains )
+{
+    const int N_CH = (ORDER + 1) * (ORDER + 1);
+    T lanes[AMBI_BATCH_LANES * N_CH];
+    int s = 0;
+    for (; s + AMBI_BATCH_LANES <= nsources; s += AMBI_BATCH_LANES) {
+        for (int l = 0; l < AMBI_BATCH_LANES; l++)
+            sh_gains((float)wrap_angle(azimuth[s + l]), (float)wrap_angle(elevation[s + l]), ORDER, coeffs, lanes + l, AMBI_BATCH_LANES);
+        for (int l = 0; l < AMBI_BATCH_LANES; l++)
+            for (int c = 0; c < N_CH; c++) gains[s + l][c] = lanes[c * AMBI_BATCH_LANES + l];
+    }
+    for (; s < nsources; s++)
+        sh_gains((float)wrap_angle(azimuth[s]), (float)wrap_angle(elevation[s]), ORDER, coeffs, gains[s], 1);
+}
+
+AMBI_KERNEL_CLONES(AMBI_ARGS(template<int ORDER, typename T>), sh_gains_bank, <ORDER>,
+                   (int nsources, const t_CKFLOAT * azimuth, const t_CKFLOAT * elevation, const float * coeffs, T * const * gains),
+                   (nsources, azimuth, elevation, coeffs, gains))
+
+template<int ORDER, typename T>
+static inline void sh_gains_batch( int nsources, const t_CKFLOAT * azimuth, const t_CKFLOAT * elevation, T * const * gains )
+{
+    AMBI_CALL_KERNEL(sh_gains_bank, <ORDER>, (nsources, azimuth, elevation, sh_coeffs(), gains));
+}
+
+// sh_gains_batch for an order only known at run time
+template<typename T>
+static inline void sh_gains_batch( int order, int nsources, const t_CKFLOAT * azimuth, const t_CKFLOAT * elevation, T * const * gains )
+{
+    switch (order) {
+        case 0:
+        case 1:  sh_gains_batch<1>(nsources, azimuth, elevation, gains); break;
+        case 2:  sh_gains_batch<2>(nsources, azimuth, elevation, gains); break;
+        case 3:  sh_gains_batch<3>(nsources, azimuth, elevation, gains); break;
+        case 4:  sh_gains_batch<4>(nsources, azimuth, elevation, gains); break;
+        case 5:  sh_gains_batch<5>(nsources, azimuth, elevation, gains); break;
+        case 6:  sh_gains_batch<6>(nsources, azimuth, elevation, gains); break;
+        default: sh_gains_batch<7>(nsources, azimuth, elevation, gains); break;
+    }
+}
+
+#endif
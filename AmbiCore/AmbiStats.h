@@ -0,0 +1,480 @@
+// AmbiStats.h
+// Runtime counters of every chugin class, read from ChucK through static functions.
+// Each thread counts into its own block with relaxed load / store pairs, so counting
+// costs no locked instructions; readers sum every block, and a reset only moves the
+// baseline those sums start from. ChucK runs the shreds and UGens of a VM on one
+// thread, so an instance keeps the block of the thread that created it.
+//
+// The deadline monitor adds a histogram of tick times per class and, for every
+// tick over the budget, a record of the instance and of what it was doing, kept
+// in a per-thread ring until ambi_deadline_dump writes them out
+
+#ifndef AMBI_STATS_H
+#define AMBI_STATS_H
+
+#include "AmbiConfig.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <string>
+#include <vector>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define AMBI_STATS_TSC 1
+#else
+#define AMBI_STATS_TSC 0
+#endif
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#pragma intrinsic(_BitScanReverse64)
+#endif
+
+enum {
+    AMBI_STAT_INSTANCES,        // constructed minus destroyed
+    AMBI_STAT_SAMPLES,          // frames ticked
+    AMBI_STAT_GAIN_UPDATES,     // gain vector evaluations
+    AMBI_STAT_SILENT_BLOCKS,    // blocks bypassed as silent
+    AMBI_STAT_CLOCK,            // clock ticks spent ticking, while timing is on
+    AMBI_STAT_OVERRUNS,         // ticks over the deadline budget, while monitoring
+    AMBI_STAT_COUNT
+};
+
+// what a tick did, as recorded with an overrun
+enum {
+    AMBI_REASON_GAINS = 1,      // evaluated a gain vector
+    AMBI_REASON_PATH = 2,       // started a path
+    AMBI_REASON_ORDER = 4,      // runs at an order set since the last tick
+    AMBI_REASON_BLOCK = 8,      // processed a whole block
+    AMBI_REASON_COUNT = 4
+};
+
+static const char * const ambi_reason_names[AMBI_REASON_COUNT] = { "gains", "path", "order", "block" };
+
+// AmbiPan counts as class 0, AmbiEnc1-7 and AmbiBin1-7 as their order
+const int AMBI_STATS_CLASSES = 8;
+
+// tick time histogram: exact below 16 clock ticks, then 16 buckets per octave
+const int AMBI_HIST_SUB = 16;
+const int AMBI_HIST_BUCKETS = AMBI_HIST_SUB * 44;
+
+// overruns kept per thread until the next dump; later ones are only counted
+const int AMBI_OVERRUN_RING = 1024;
+
+struct AmbiOverrun
+{
+    const void * obj;       // instance
+    t_CKINT id;             // its instanceId()
+    t_CKINT start;          // ambi_clock() at the start of the tick
+    t_CKINT ticks;          // clock ticks the tick took
+    int cls;
+    int frames;
+    int reasons;            // AMBI_REASON_* flags
+};
+
+struct AmbiStatsBlock
+{
+    std::atomic<t_CKINT> value[AMBI_STATS_CLASSES][AMBI_STAT_COUNT];
+    std::atomic<t_CKINT> hist[AMBI_STATS_CLASSES][AMBI_HIST_BUCKETS];
+    std::atomic<t_CKINT> max_ticks[AMBI_STATS_CLASSES];
+
+    // single-producer ring of overruns, drained by ambi_deadline_dump
+    AmbiOverrun overrun[AMBI_OVERRUN_RING];
+    std::atomic<t_CKINT> overrun_head;
+    std::atomic<t_CKINT> overrun_tail;
+
+    AmbiStatsBlock * next;
+};
+
+static std::atomic<AmbiStatsBlock *> ambi_stats_head(NULL);
+static std::atomic<t_CKINT> ambi_stats_baseline[AMBI_STATS_CLASSES][AMBI_STAT_COUNT];
+static std::atomic<t_CKINT> ambi_hist_baseline[AMBI_STATS_CLASSES][AMBI_HIST_BUCKETS];
+static std::atomic<bool> ambi_stats_timing(false);
+static std::atomic<bool> ambi_deadline_on(false);
+static std::atomic<t_CKINT> ambi_deadline_ticks(0);
+static double ambi_deadline_us = 0;
+static std::atomic<t_CKINT> ambi_instance_ids(0);
+
+// id of a new instance, to find it again in a deadline dump
+static t_CKINT ambi_instance_id()
+{
+    return ++ambi_instance_ids;
+}
+
+// cheap clock: the TSC on x86, the steady clock in ns elsewhere
+static inline t_CKINT ambi_clock()
+{
+#if AMBI_STATS_TSC
+    return (t_CKINT)__rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// TSC and steady clock when the chugin loaded; their drift since gives the TSC rate
+static t_CKINT ambi_clock_origin;
+static std::chrono::steady_clock::time_point ambi_steady_origin;
+
+static void ambi_stats_init()
+{
+    ambi_clock_origin = ambi_clock();
+    ambi_steady_origin = std::chrono::steady_clock::now();
+}
+
+static double ambi_clock_ns_per_tick()
+{
+#if AMBI_STATS_TSC
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - ambi_steady_origin).count();
+    t_CKINT elapsed = ambi_clock() - ambi_clock_origin;
+    return ns > 0 && elapsed > 0 ? ns / elapsed : 0;
+#else
+    return 1;
+#endif
+}
+
+static double ambi_clock_to_ns( t_CKINT ticks )
+{
+    return ticks * ambi_clock_ns_per_tick();
+}
+
+// counters of the calling thread, created and linked in on first use
+static AmbiStatsBlock * ambi_stats_block()
+{
+    static thread_local AmbiStatsBlock * block = NULL;
+    if (!block) {
+        block = new AmbiStatsBlock();
+        block->next = ambi_stats_head.load();
+        while (!ambi_stats_head.compare_exchange_weak(block->next, block)) {}
+    }
+    return block;
+}
+
+static inline void ambi_stats_count( AmbiStatsBlock * block, int cls, int stat, t_CKINT n )
+{
+    std::atomic<t_CKINT> & v = block->value[cls][stat];
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// clock at the start of a tick, or 0 while neither timing nor the deadline monitor is on
+static inline t_CKINT ambi_stats_tick_start()
+{
+    return ambi_stats_timing.load(std::memory_order_relaxed) ||
+           ambi_deadline_on.load(std::memory_order_relaxed) ? ambi_clock() : 0;
+}
+
+// clock ticks the tick took, or 0 if it wasn't timed
+static inline t_CKINT ambi_stats_tick_end( AmbiStatsBlock * block, int cls, int nframes, t_CKINT start )
+{
+    ambi_stats_count(block, cls, AMBI_STAT_SAMPLES, nframes);
+    if (!start) return 0;
+
+    t_CKINT ticks = ambi_clock() - start;
+    ambi_stats_count(block, cls, AMBI_STAT_CLOCK, ticks);
+    return ticks;
+}
+
+// index of the highest set bit of x, which is not 0
+static inline int ambi_log2( unsigned long long x )
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long e;
+    _BitScanReverse64(&e, x);
+    return (int)e;
+#else
+    int e = 0;
+    while (x >>= 1) e++;
+    return e;
+#endif
+}
+
+static inline int ambi_hist_bucket( t_CKINT ticks )
+{
+    if (ticks < AMBI_HIST_SUB) return ticks < 0 ? 0 : (int)ticks;
+    int e = ambi_log2((unsigned long long)ticks);
+    int b = (e - 3) * AMBI_HIST_SUB + (int)((ticks >> (e - 4)) & (AMBI_HIST_SUB - 1));
+    return b < AMBI_HIST_BUCKETS ? b : AMBI_HIST_BUCKETS - 1;
+}
+
+// middle of a bucket, in clock ticks
+static double ambi_hist_value( int b )
+{
+    if (b < AMBI_HIST_SUB) return b;
+    int e = b / AMBI_HIST_SUB + 3;
+    return ((AMBI_HIST_SUB + b % AMBI_HIST_SUB) + 0.5) * (double)(1LL << (e - 4));
+}
+
+// histogram and budget check of a timed tick; true if it overran the budget, in which
+// case it is recorded with the instance id and the AMBI_REASON_* flags of what it did
+static inline bool ambi_deadline_check( AmbiStatsBlock * block, int cls, const void * obj, t_CKINT id,
+                                        t_CKINT start, t_CKINT ticks, int nframes, int reasons )
+{
+    if (!ticks || !ambi_deadline_on.load(std::memory_order_relaxed)) return false;
+
+    std::atomic<t_CKINT> & h = block->hist[cls][ambi_hist_bucket(ticks)];
+    h.store(h.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (ticks > block->max_ticks[cls].load(std::memory_order_relaxed))
+        block->max_ticks[cls].store(ticks, std::memory_order_relaxed);
+
+    t_CKINT budget = ambi_deadline_ticks.load(std::memory_order_relaxed);
+    if (!budget || ticks <= budget) return false;
+
+    ambi_stats_count(block, cls, AMBI_STAT_OVERRUNS, 1);
+    t_CKINT head = block->overrun_head.load(std::memory_order_relaxed);
+    if (head - block->overrun_tail.load(std::memory_order_acquire) < AMBI_OVERRUN_RING) {
+        AmbiOverrun & o = block->overrun[head & (AMBI_OVERRUN_RING - 1)];
+        o.obj = obj;
+        o.id = id;
+        o.start = start;
+        o.ticks = ticks;
+        o.cls = cls;
+        o.frames = nframes;
+        o.reasons = reasons;
+        block->overrun_head.store(head + 1, std::memory_order_release);
+    }
+    return true;
+}
+
+// deadline state of one instance: its id, what its current tick did, and its overruns
+struct AmbiTickMonitor
+{
+    t_CKINT id;
+    int reasons;            // AMBI_REASON_* flags of the current tick
+    t_CKINT overruns;
+    t_CKINT worst;          // longest timed tick, in clock ticks
+
+    AmbiTickMonitor() : id(ambi_instance_id()), reasons(0), overruns(0), worst(0) {}
+
+    // counts the tick that started at start, checks it against the budget and starts the next
+    void end( AmbiStatsBlock * block, int cls, const void * obj, int nframes, t_CKINT start )
+    {
+        t_CKINT ticks = ambi_stats_tick_end(block, cls, nframes, start);
+        if (ambi_deadline_check(block, cls, obj, id, start, ticks, nframes, reasons)) overruns++;
+        if (ticks > worst) worst = ticks;
+        reasons = 0;
+    }
+};
+
+static t_CKINT ambi_stats_sum( int cls, int stat )
+{
+    t_CKINT sum = 0;
+    for (AmbiStatsBlock * b = ambi_stats_head.load(); b; b = b->next)
+        sum += b->value[cls][stat].load(std::memory_order_relaxed);
+    return sum;
+}
+
+static t_CKINT ambi_stats_read( int cls, int stat )
+{
+    return ambi_stats_sum(cls, stat) - ambi_stats_baseline[cls][stat].load(std::memory_order_relaxed);
+}
+
+// accumulated tick time of a class in ns
+static double ambi_stats_tick_ns( int cls )
+{
+    return ambi_clock_to_ns(ambi_stats_read(cls, AMBI_STAT_CLOCK));
+}
+
+// restart every counter and the histogram of a class from zero, except the live instance count
+static void ambi_stats_reset( int cls )
+{
+    for (int stat = 0; stat < AMBI_STAT_COUNT; stat++)
+        if (stat != AMBI_STAT_INSTANCES)
+            ambi_stats_baseline[cls][stat].store(ambi_stats_sum(cls, stat), std::memory_order_relaxed);
+
+    for (int b = 0; b < AMBI_HIST_BUCKETS; b++) {
+        t_CKINT sum = 0;
+        for (AmbiStatsBlock * k = ambi_stats_head.load(); k; k = k->next)
+            sum += k->hist[cls][b].load(std::memory_order_relaxed);
+        ambi_hist_baseline[cls][b].store(sum, std::memory_order_relaxed);
+    }
+    for (AmbiStatsBlock * k = ambi_stats_head.load(); k; k = k->next)
+        k->max_ticks[cls].store(0, std::memory_order_relaxed);
+}
+
+// histogram of a class since the last reset, summed over every thread
+static void ambi_hist_read( int cls, std::vector<t_CKINT> & hist )
+{
+    hist.assign(AMBI_HIST_BUCKETS, 0);
+    for (AmbiStatsBlock * k = ambi_stats_head.load(); k; k = k->next)
+        for (int b = 0; b < AMBI_HIST_BUCKETS; b++)
+            hist[b] += k->hist[cls][b].load(std::memory_order_relaxed);
+    for (int b = 0; b < AMBI_HIST_BUCKETS; b++)
+        hist[b] -= ambi_hist_baseline[cls][b].load(std::memory_order_relaxed);
+}
+
+// tick time in ns that a fraction q of the monitored ticks of a class stayed within
+static double ambi_hist_quantile( const std::vector<t_CKINT> & hist, double q )
+{
+    t_CKINT total = 0;
+    for (int b = 0; b < AMBI_HIST_BUCKETS; b++) total += hist[b];
+    if (total <= 0) return 0;
+
+    t_CKINT rank = (t_CKINT)ceil(q * total), seen = 0;
+    for (int b = 0; b < AMBI_HIST_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= rank && hist[b] > 0) return ambi_clock_to_ns((t_CKINT)1) * ambi_hist_value(b);
+    }
+    return 0;
+}
+
+static double ambi_deadline_quantile_ns( int cls, double q )
+{
+    std::vector<t_CKINT> hist;
+    ambi_hist_read(cls, hist);
+    return ambi_hist_quantile(hist, q);
+}
+
+// longest monitored tick of a class in ns
+static double ambi_deadline_max_ns( int cls )
+{
+    t_CKINT mx = 0;
+    for (AmbiStatsBlock * k = ambi_stats_head.load(); k; k = k->next)
+        mx = std::max(mx, k->max_ticks[cls].load(std::memory_order_relaxed));
+    return ambi_clock_to_ns(mx);
+}
+
+// the budget is kept in clock ticks for the check; it is converted again whenever
+// monitoring starts, when the clock rate is known better
+static void ambi_deadline_budget( double us )
+{
+    ambi_deadline_us = us > 0 ? us : 0;
+    double ns_per_tick = ambi_clock_ns_per_tick();
+    ambi_deadline_ticks = ns_per_tick > 0 ? (t_CKINT)(ambi_deadline_us * 1000 / ns_per_tick) : 0;
+}
+
+static void ambi_deadline_monitor( bool on )
+{
+    ambi_deadline_budget(ambi_deadline_us);
+    ambi_deadline_on = on;
+}
+
+// a dump taken on the calling thread, waiting for the writer thread to write it out
+struct AmbiDeadlineSummary { int cls; t_CKINT ticks, overruns; double p50, p99, max; };
+struct AmbiDeadlineDump
+{
+    std::string path;
+    const char * chugin;
+    std::vector<AmbiDeadlineSummary> summary;
+    std::vector<AmbiOverrun> overruns;
+    double ns_per_tick;
+    double budget_us;
+};
+
+// the writer thread, started by the first dump and told to quit when the chugin
+// unloads; dumps queued by then are still written
+static std::mutex ambi_deadline_mutex;
+static std::condition_variable ambi_deadline_wake;
+static std::deque<AmbiDeadlineDump *> ambi_deadline_queue;
+static std::thread ambi_deadline_writer;
+static bool ambi_deadline_quit = false;
+
+static void ambi_deadline_write( const AmbiDeadlineDump & d )
+{
+    FILE * fp = fopen(d.path.c_str(), "w");
+    if (!fp) {
+        fprintf(stderr, "[%s]: cannot write %s\n", d.chugin, d.path.c_str());
+        return;
+    }
+
+    char name[32];
+    fprintf(fp, "class,ticks,p50_ns,p99_ns,max_ns,overruns,budget_us\n");
+    for (const AmbiDeadlineSummary & sm : d.summary) {
+        snprintf(name, sizeof(name), sm.cls ? "%s%d" : "%s", d.chugin, sm.cls);
+        fprintf(fp, "%s,%ld,%.1f,%.1f,%.1f,%ld,%.3f\n", name, (long)sm.ticks,
+                sm.p50, sm.p99, sm.max, (long)sm.overruns, d.budget_us);
+    }
+
+    fprintf(fp, "\ntime_s,class,instance,ns,frames,reasons\n");
+    for (const AmbiOverrun & o : d.overruns) {
+        snprintf(name, sizeof(name), o.cls ? "%s%d" : "%s", d.chugin, o.cls);
+        fprintf(fp, "%.6f,%s,%ld,%.1f,%d,", (o.start - ambi_clock_origin) * d.ns_per_tick / 1e9,
+                name, (long)o.id, o.ticks * d.ns_per_tick, o.frames);
+        const char * sep = "";
+        for (int r = 0; r < AMBI_REASON_COUNT; r++)
+            if (o.reasons & (1 << r)) { fprintf(fp, "%s%s", sep, ambi_reason_names[r]); sep = "|"; }
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+}
+
+static void ambi_deadline_writer_loop()
+{
+    std::unique_lock<std::mutex> lock(ambi_deadline_mutex);
+    for (;;) {
+        ambi_deadline_wake.wait(lock, [] { return ambi_deadline_quit || !ambi_deadline_queue.empty(); });
+        if (ambi_deadline_queue.empty()) return;
+        AmbiDeadlineDump * d = ambi_deadline_queue.front();
+        ambi_deadline_queue.pop_front();
+        lock.unlock();
+        ambi_deadline_write(*d);
+        delete d;
+        lock.lock();
+    }
+}
+
+struct AmbiDeadlineGuard
+{
+    ~AmbiDeadlineGuard()
+    {
+        if (!ambi_deadline_writer.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(ambi_deadline_mutex);
+            ambi_deadline_quit = true;
+        }
+        ambi_deadline_wake.notify_one();
+        ambi_deadline_writer.join();
+    }
+};
+static AmbiDeadlineGuard ambi_deadline_guard;
+
+// tick time summary of every class that ticked while monitored, then every overrun
+// recorded since the last dump, as CSV sections. The rings are drained on the calling
+// thread; opening and writing the file is left to the writer thread, which says on
+// stderr if it can't. Class 0 is named after the chugin, the others after the chugin
+// and their order. False if there is no path
+static bool ambi_deadline_dump( const char * path, const char * chugin )
+{
+    if (!path || !*path) return false;
+
+    AmbiDeadlineDump * d = new AmbiDeadlineDump();
+    d->path = path;
+    d->chugin = chugin;
+    d->ns_per_tick = ambi_clock_ns_per_tick();
+    d->budget_us = ambi_deadline_us;
+
+    std::vector<t_CKINT> hist;
+    for (int cls = 0; cls < AMBI_STATS_CLASSES; cls++) {
+        ambi_hist_read(cls, hist);
+        t_CKINT ticks = 0;
+        for (int b = 0; b < AMBI_HIST_BUCKETS; b++) ticks += hist[b];
+        if (ticks <= 0) continue;
+        AmbiDeadlineSummary sm = { cls, ticks, ambi_stats_read(cls, AMBI_STAT_OVERRUNS),
+                                   ambi_hist_quantile(hist, 0.5), ambi_hist_quantile(hist, 0.99), ambi_deadline_max_ns(cls) };
+        d->summary.push_back(sm);
+    }
+
+    for (AmbiStatsBlock * k = ambi_stats_head.load(); k; k = k->next) {
+        t_CKINT head = k->overrun_head.load(std::memory_order_acquire);
+        for (t_CKINT i = k->overrun_tail.load(std::memory_order_relaxed); i < head; i++)
+            d->overruns.push_back(k->overrun[i & (AMBI_OVERRUN_RING - 1)]);
+        k->overrun_tail.store(head, std::memory_order_release);
+    }
+    std::sort(d->overruns.begin(), d->overruns.end(),
+              []( const AmbiOverrun & a, const AmbiOverrun & b ) { return a.start < b.start; });
+
+    {
+        std::lock_guard<std::mutex> lock(ambi_deadline_mutex);
+        ambi_deadline_queue.push_back(d);
+        if (!ambi_deadline_writer.joinable()) ambi_deadline_writer = std::thread(ambi_deadline_writer_loop);
+    }
+    ambi_deadline_wake.notify_one();
+    return true;
+}
+
+#endif
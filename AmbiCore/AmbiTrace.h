@@ -0,0 +1,271 @@
+// AmbiTrace.h
+// Trace points for the tick functions, compiled in with AMBI_TRACE. Each thread
+// writes fixed-size records into its own single-producer ring; between
+// ambi_trace_start and ambi_trace_stop a writer thread drains every ring into a
+// Chrome trace JSON file (chrome://tracing, ui.perfetto.dev). A full ring drops
+// records and counts them rather than make the audio thread wait. The writer
+// thread also writes the end of the file and closes it, so ambi_trace_stop returns
+// at once; it lives until the chugin unloads. Without
+// AMBI_TRACE the trace points compile to nothing and ambi_trace_start only
+// reports that tracing is not built in
+
+#ifndef AMBI_TRACE_H
+#define AMBI_TRACE_H
+
+#include "AmbiStats.h"
+
+#ifdef AMBI_TRACE
+
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+const int AMBI_TRACE_RING = 1 << 16;        // records per thread, a power of two
+const int AMBI_TRACE_FLUSH_MS = 20;         // how often the writer thread drains the rings
+
+struct AmbiTraceRecord
+{
+    const char * name;      // event name, a string literal
+    const char * arg_name;  // what arg counts, a string literal
+    const void * obj;       // instance that recorded it
+    t_CKINT start;          // ambi_clock() at the start
+    t_CKINT dur;            // clock ticks, or -1 for an instant event
+    t_CKINT arg;
+};
+
+struct AmbiTraceRing
+{
+    AmbiTraceRecord rec[AMBI_TRACE_RING];
+    std::atomic<t_CKINT> head;      // records written, by the owning thread only
+    std::atomic<t_CKINT> tail;      // records drained, by the drain only
+    std::atomic<t_CKINT> dropped;   // records lost to a full ring, by the owning thread only
+    int tid;
+    AmbiTraceRing * next;
+};
+
+static std::atomic<AmbiTraceRing *> ambi_trace_head(NULL);
+static std::atomic<int> ambi_trace_rings(0);
+static std::atomic<bool> ambi_trace_on(false);
+
+// a trace is idle, running, or stopped and waiting for the writer thread to close it
+enum { AMBI_TRACE_IDLE, AMBI_TRACE_RUNNING, AMBI_TRACE_STOPPING };
+static std::atomic<int> ambi_trace_state(AMBI_TRACE_IDLE);
+
+// file state, set up by ambi_trace_start while idle and then only touched by the
+// writer thread until it is idle again; ambi_trace_mutex keeps start and stop apart
+static std::mutex ambi_trace_mutex;
+static FILE * ambi_trace_file = NULL;
+static const char * ambi_trace_cat = "";
+static int ambi_trace_pid = 0;
+static std::atomic<t_CKINT> ambi_trace_events(0);
+
+// the writer thread, started by the first trace and told to quit when the chugin unloads
+static std::thread ambi_trace_writer;
+static std::mutex ambi_trace_wake_mutex;
+static std::condition_variable ambi_trace_wake;
+static bool ambi_trace_quit = false;
+
+// ring of the calling thread, created and linked in on first use
+static AmbiTraceRing * ambi_trace_ring()
+{
+    static thread_local AmbiTraceRing * ring = NULL;
+    if (!ring) {
+        ring = new AmbiTraceRing();
+        ring->tid = ++ambi_trace_rings;
+        ring->next = ambi_trace_head.load();
+        while (!ambi_trace_head.compare_exchange_weak(ring->next, ring)) {}
+    }
+    return ring;
+}
+
+static void ambi_trace_record( const char * name, const char * arg_name, const void * obj,
+                               t_CKINT start, t_CKINT dur, t_CKINT arg )
+{
+    AmbiTraceRing * r = ambi_trace_ring();
+    t_CKINT head = r->head.load(std::memory_order_relaxed);
+    if (head - r->tail.load(std::memory_order_acquire) >= AMBI_TRACE_RING) {
+        r->dropped.store(r->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    AmbiTraceRecord & rec = r->rec[head & (AMBI_TRACE_RING - 1)];
+    rec.name = name;
+    rec.arg_name = arg_name;
+    rec.obj = obj;
+    rec.start = start;
+    rec.dur = dur;
+    rec.arg = arg;
+    r->head.store(head + 1, std::memory_order_release);
+}
+
+// records the enclosing scope as one complete event, if tracing was on when it began
+struct AmbiTraceScope
+{
+    const char * name;
+    const char * arg_name;
+    const void * obj;
+    t_CKINT arg;
+    t_CKINT start;
+
+    AmbiTraceScope( const char * n, const char * an, const void * o, t_CKINT a )
+        : name(n), arg_name(an), obj(o), arg(a),
+          start(ambi_trace_on.load(std::memory_order_relaxed) ? ambi_clock() : 0) {}
+
+    ~AmbiTraceScope()
+    {
+        if (start) ambi_trace_record(name, arg_name, obj, start, ambi_clock() - start, arg);
+    }
+};
+
+#define AMBI_TRACE_SCOPE(NAME, ARG_NAME, ARG) \
+    AmbiTraceScope ambi_trace_scope(NAME, ARG_NAME, this, ARG)
+
+#define AMBI_TRACE_INSTANT(NAME, ARG_NAME, ARG)                                      \
+    do {                                                                             \
+        if (ambi_trace_on.load(std::memory_order_relaxed))                           \
+            ambi_trace_record(NAME, ARG_NAME, this, ambi_clock(), -1, ARG);          \
+    } while (0)
+
+static void ambi_trace_event( const char * json )
+{
+    fprintf(ambi_trace_file, "%s\n%s", ambi_trace_events++ ? "," : "", json);
+}
+
+// write out every record drained from the rings; with write false, only discard them
+static void ambi_trace_drain( bool write )
+{
+    double us_per_tick = ambi_clock_ns_per_tick() / 1000;
+    char json[320];
+
+    for (AmbiTraceRing * r = ambi_trace_head.load(); r; r = r->next) {
+        t_CKINT head = r->head.load(std::memory_order_acquire);
+        t_CKINT tail = r->tail.load(std::memory_order_relaxed);
+        for (; write && tail < head; tail++) {
+            const AmbiTraceRecord & rec = r->rec[tail & (AMBI_TRACE_RING - 1)];
+            double ts = (rec.start - ambi_clock_origin) * us_per_tick;
+            if (rec.dur >= 0)
+                snprintf(json, sizeof(json),
+                         "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                         "\"args\":{\"obj\":\"%p\",\"%s\":%ld}}",
+                         rec.name, ambi_trace_cat, ambi_trace_pid, r->tid, ts, rec.dur * us_per_tick,
+                         rec.obj, rec.arg_name, (long)rec.arg);
+            else
+                snprintf(json, sizeof(json),
+                         "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,"
+                         "\"args\":{\"obj\":\"%p\",\"%s\":%ld}}",
+                         rec.name, ambi_trace_cat, ambi_trace_pid, r->tid, ts,
+                         rec.obj, rec.arg_name, (long)rec.arg);
+            ambi_trace_event(json);
+        }
+        r->tail.store(head, std::memory_order_release);
+    }
+    if (write) fflush(ambi_trace_file);
+}
+
+// write out what is left, the dropped records and the end of the file, then close it
+static void ambi_trace_close()
+{
+    ambi_trace_drain(true);
+
+    // records lost to full rings, as one instant event per thread at the end of the trace
+    char json[200];
+    double ts = (ambi_clock() - ambi_clock_origin) * ambi_clock_ns_per_tick() / 1000;
+    for (AmbiTraceRing * r = ambi_trace_head.load(); r; r = r->next) {
+        t_CKINT dropped = r->dropped.load();
+        if (!dropped) continue;
+        snprintf(json, sizeof(json),
+                 "{\"name\":\"dropped\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,"
+                 "\"args\":{\"records\":%ld}}",
+                 ambi_trace_cat, ambi_trace_pid, r->tid, ts, (long)dropped);
+        ambi_trace_event(json);
+    }
+
+    fprintf(ambi_trace_file, "\n]\n");
+    fclose(ambi_trace_file);
+    ambi_trace_file = NULL;
+    ambi_trace_state.store(AMBI_TRACE_IDLE, std::memory_order_release);
+}
+
+// drains the rings of a running trace every AMBI_TRACE_FLUSH_MS and closes a stopped
+// one; a trace still running when it is told to quit is closed first
+static void ambi_trace_writer_loop()
+{
+    std::unique_lock<std::mutex> lock(ambi_trace_wake_mutex);
+    for (;;) {
+        bool quit = ambi_trace_wake.wait_for(lock, std::chrono::milliseconds(AMBI_TRACE_FLUSH_MS),
+                                             [] { return ambi_trace_quit; });
+        int state = ambi_trace_state.load(std::memory_order_acquire);
+        if (state == AMBI_TRACE_RUNNING && !quit) ambi_trace_drain(true);
+        else if (state != AMBI_TRACE_IDLE) ambi_trace_close();
+        if (quit) return;
+    }
+}
+
+// start tracing into a new Chrome trace file; pid and name tell the chugins apart when
+// their traces are merged. Returns false if a trace is running or still being closed,
+// or the file can't be opened
+static bool ambi_trace_start( const char * path, int pid, const char * name )
+{
+    std::lock_guard<std::mutex> lock(ambi_trace_mutex);
+    if (ambi_trace_state.load(std::memory_order_acquire) != AMBI_TRACE_IDLE) return false;
+    ambi_trace_file = fopen(path, "w");
+    if (!ambi_trace_file) return false;
+
+    // whatever is left from an earlier trace belongs to that one
+    ambi_trace_drain(false);
+    for (AmbiTraceRing * r = ambi_trace_head.load(); r; r = r->next) r->dropped.store(0);
+
+    ambi_trace_cat = name;
+    ambi_trace_pid = pid;
+    ambi_trace_events = 0;
+    char json[160];
+    snprintf(json, sizeof(json), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}", pid, name);
+    fprintf(ambi_trace_file, "[");
+    ambi_trace_event(json);
+
+    ambi_trace_state.store(AMBI_TRACE_RUNNING, std::memory_order_release);
+    ambi_trace_on = true;
+    if (!ambi_trace_writer.joinable()) ambi_trace_writer = std::thread(ambi_trace_writer_loop);
+    return true;
+}
+
+// stop tracing and leave the rest of the file to the writer thread, without waiting
+// for it; returns the events written so far, or 0 if no trace is running
+static t_CKINT ambi_trace_stop()
+{
+    std::lock_guard<std::mutex> lock(ambi_trace_mutex);
+    if (ambi_trace_state.load(std::memory_order_acquire) != AMBI_TRACE_RUNNING) return 0;
+
+    ambi_trace_on = false;
+    ambi_trace_state.store(AMBI_TRACE_STOPPING, std::memory_order_release);
+    return ambi_trace_events - 1;
+}
+
+// a trace still running when the chugin unloads is closed properly
+struct AmbiTraceGuard
+{
+    ~AmbiTraceGuard()
+    {
+        if (!ambi_trace_writer.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(ambi_trace_wake_mutex);
+            ambi_trace_quit = true;
+        }
+        ambi_trace_wake.notify_one();
+        ambi_trace_writer.join();
+    }
+};
+static AmbiTraceGuard ambi_trace_guard;
+
+#else
+
+#define AMBI_TRACE_SCOPE(NAME, ARG_NAME, ARG)
+#define AMBI_TRACE_INSTANT(NAME, ARG_NAME, ARG) do {} while (0)
+
+static inline bool ambi_trace_start( const char *, int, const char * ) { return false; }
+static inline t_CKINT ambi_trace_stop() { return 0; }
+
+#endif
+
+#endif
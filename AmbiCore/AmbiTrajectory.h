@@ -0,0 +1,134 @@
+// AmbiTrajectory.h
+// Parametric source trajectories, evaluated once per update period. Each angle is
+// a centre that drifts at a constant rate and takes a random walk step, plus up
+// to AMBI_TRAJ_TERMS sine terms. Every term is a unit phasor turned by a rotation
+// worked out when the trajectory or the update period changes, so a step is a
+// few multiply-adds with no trig or branches
+
+#ifndef AMBI_TRAJECTORY_H
+#define AMBI_TRAJECTORY_H
+
+#include "AmbiSH.h"
+#include <stdint.h>
+
+const int AMBI_TRAJ_TERMS = 4;              // sine terms per angle
+const int AMBI_TRAJ_AZIMUTH = 0;
+const int AMBI_TRAJ_ELEVATION = 1;
+
+struct AmbiTrajectory
+{
+    // per angle, in radians, radians per second and Hz
+    t_CKFLOAT center[2];
+    t_CKFLOAT drift[2];
+    t_CKFLOAT wander[2];                    // random walk spread after one second
+    t_CKFLOAT amp[2][AMBI_TRAJ_TERMS];      // 0 for unused terms
+    t_CKFLOAT freq[2][AMBI_TRAJ_TERMS];
+    int nterms[2];
+
+    // state of the current update period
+    t_CKFLOAT dt;                           // seconds per update
+    t_CKFLOAT drift_step[2];
+    t_CKFLOAT wander_step[2];
+    t_CKFLOAT re[2][AMBI_TRAJ_TERMS], im[2][AMBI_TRAJ_TERMS];
+    t_CKFLOAT rot_re[2][AMBI_TRAJ_TERMS], rot_im[2][AMBI_TRAJ_TERMS];
+    uint32_t seed;
+};
+
+// a trajectory standing still at (azimuth, elevation)
+static inline void ambi_trajectory_init( AmbiTrajectory * t, t_CKFLOAT azimuth, t_CKFLOAT elevation, uint32_t seed )
+{
+    memset(t, 0, sizeof(AmbiTrajectory));
+    t->center[AMBI_TRAJ_AZIMUTH] = azimuth;
+    t->center[AMBI_TRAJ_ELEVATION] = elevation;
+    t->seed = seed * 2654435761u + 1;
+    for (int a = 0; a < 2; a++)
+        for (int k = 0; k < AMBI_TRAJ_TERMS; k++) {
+            t->re[a][k] = 1;
+            t->rot_re[a][k] = 1;
+        }
+}
+
+// rotations and steps for an update period of dt seconds
+static inline void ambi_trajectory_period( AmbiTrajectory * t, t_CKFLOAT dt )
+{
+    t->dt = dt;
+    for (int a = 0; a < 2; a++) {
+        t->drift_step[a] = t->drift[a] * dt;
+        // uniform steps in [-1, 1] have variance 1/3
+        t->wander_step[a] = t->wander[a] * sqrt(3 * dt);
+        for (int k = 0; k < AMBI_TRAJ_TERMS; k++) {
+            t->rot_re[a][k] = cos(2 * M_PI * t->freq[a][k] * dt);
+            t->rot_im[a][k] = sin(2 * M_PI * t->freq[a][k] * dt);
+        }
+    }
+}
+
+// add amp * sin(2 pi freq t + phase) to an angle; returns the number of terms of
+// that angle, or -1 if it has no room left
+static inline int ambi_trajectory_term( AmbiTrajectory * t, int angle, t_CKFLOAT amp, t_CKFLOAT freq, t_CKFLOAT phase )
+{
+    int k = t->nterms[angle];
+    if (k >= AMBI_TRAJ_TERMS) return -1;
+
+    t->amp[angle][k] = amp;
+    t->freq[angle][k] = freq;
+    t->re[angle][k] = cos(phase);
+    t->im[angle][k] = sin(phase);
+    t->rot_re[angle][k] = cos(2 * M_PI * freq * t->dt);
+    t->rot_im[angle][k] = sin(2 * M_PI * freq * t->dt);
+    return ++t->nterms[angle];
+}
+
+static inline void ambi_trajectory_drift( AmbiTrajectory * t, int angle, t_CKFLOAT rate )
+{
+    t->drift[angle] = rate;
+    t->drift_step[angle] = rate * t->dt;
+}
+
+static inline void ambi_trajectory_wander( AmbiTrajectory * t, int angle, t_CKFLOAT spread )
+{
+    t->wander[angle] = spread;
+    t->wander_step[angle] = spread * sqrt(3 * t->dt);
+}
+
+// where the trajectory is now, without moving it
+static AMBI_INLINE void ambi_trajectory_value( const AmbiTrajectory * t, t_CKFLOAT * azimuth, t_CKFLOAT * elevation )
+{
+    t_CKFLOAT v[2];
+    for (int a = 0; a < 2; a++) {
+        v[a] = t->center[a];
+        for (int k = 0; k < AMBI_TRAJ_TERMS; k++) v[a] += t->amp[a][k] * t->im[a][k];
+    }
+    *azimuth = v[AMBI_TRAJ_AZIMUTH];
+    *elevation = v[AMBI_TRAJ_ELEVATION];
+}
+
+// advance one update period and return the new position. Unused terms have zero
+// amplitude, so every trajectory runs the same straight-line code. The centre is
+// kept within [-pi, pi] like the other motion accumulators, and every phasor
+// is pulled back onto the unit circle to first order so long runs stay exact
+static AMBI_INLINE void ambi_trajectory_step( AmbiTrajectory * t, t_CKFLOAT * azimuth, t_CKFLOAT * elevation )
+{
+    for (int a = 0; a < 2; a++) {
+        // xorshift32, scaled to [-1, 1)
+        uint32_t x = t->seed;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        t->seed = x;
+        t_CKFLOAT u = (t_CKFLOAT)(int32_t)x * (1.0 / 2147483648.0);
+
+        t->center[a] = wrap_angle(t->center[a] + t->drift_step[a] + t->wander_step[a] * u);
+
+        for (int k = 0; k < AMBI_TRAJ_TERMS; k++) {
+            t_CKFLOAT re = t->re[a][k] * t->rot_re[a][k] - t->im[a][k] * t->rot_im[a][k];
+            t_CKFLOAT im = t->re[a][k] * t->rot_im[a][k] + t->im[a][k] * t->rot_re[a][k];
+            t_CKFLOAT g = 1.5 - 0.5 * (re * re + im * im);
+            t->re[a][k] = re * g;
+            t->im[a][k] = im * g;
+        }
+    }
+    ambi_trajectory_value(t, azimuth, elevation);
+}
+
+#endif
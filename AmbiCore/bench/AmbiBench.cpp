@@ -0,0 +1,303 @@
+// AmbiBench.cpp
+// Microbenchmarks for the AmbiCore kernels in isolation: SH evaluation, batched
+// and one source at a time, the gain ramp-and-scale encoders and the binaural
+// decode, for every order and every
+// instruction set this CPU runs, with cold and warm caches. Prints cycles / sample
+// and GFLOP/s, and writes the same rows as JSON or CSV to compare between commits.
+// A sample is one frame for the encoders and the decoder, one direction for SH.
+//
+// usage: AmbiBench [--json file] [--csv file] [--rev name] [--frames n] [--reps n]
+//                  [--evict-mb n]
+
+#include "AmbiCore.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define AMBI_BENCH_TSC 1
+#else
+#define AMBI_BENCH_TSC 0
+#endif
+
+// arithmetic operations in sh_gains up to each order, both sincos included;
+// counted from AmbiSH.h, so the SH GFLOP/s are an estimate
+static const int SH_FLOPS[] = { 0, 104, 117, 148, 194, 265, 357, 482 };
+
+static int sh_flops( int order )
+{
+    return order < (int)(sizeof(SH_FLOPS) / sizeof(SH_FLOPS[0])) ? SH_FLOPS[order] : 0;
+}
+
+// one source, as a voice evaluates its own gains; called through a pointer so that
+// the compiler cannot run the loop over sources across SIMD lanes
+template<int ORDER>
+static void sh_gains_one( t_CKFLOAT azimuth, t_CKFLOAT elevation, const float * coeffs, float * gains )
+{
+    sh_gains((float)wrap_angle(azimuth), (float)wrap_angle(elevation), ORDER, coeffs, gains, 1);
+}
+
+// timing: the TSC on x86 (reference cycles), nanoseconds elsewhere
+static inline uint64_t bench_ticks()
+{
+#if AMBI_BENCH_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// ticks per nanosecond, measured once against the steady clock
+static double bench_tick_rate()
+{
+#if AMBI_BENCH_TSC
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = bench_ticks();
+    while (std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(100)) {}
+    uint64_t c1 = bench_ticks();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    return (c1 - c0) / ns;
+#else
+    return 1.0;
+#endif
+}
+
+struct BenchConfig
+{
+    int frames;
+    int reps;
+    size_t evict_bytes;
+    double tick_rate;
+};
+
+struct BenchResult
+{
+    std::string kernel;
+    int order;
+    int channels;
+    std::string isa;
+    std::string cache;
+    double ns_per_sample;
+    double cycles_per_sample;
+    double gflops;
+};
+
+static std::vector<BenchResult> results;
+static std::vector<char> evict_buffer;
+static volatile float sink;
+
+// push the working set out of every cache level by writing a buffer larger than the LLC
+static void evict_caches()
+{
+    for (size_t i = 0; i < evict_buffer.size(); i += 64) evict_buffer[i]++;
+}
+
+// median ticks of one call of run(), with the caches flushed before every call (cold)
+// or averaged over back-to-back calls on the same buffers (warm)
+template<typename F>
+static double time_kernel( const BenchConfig & cfg, bool cold, F run )
+{
+    const int inner = 64;
+    std::vector<double> t(cfg.reps);
+
+    run();
+    for (int r = 0; r < cfg.reps; r++) {
+        if (cold) {
+            evict_caches();
+            uint64_t c0 = bench_ticks();
+            run();
+            t[r] = (double)(bench_ticks() - c0);
+        } else {
+            uint64_t c0 = bench_ticks();
+            for (int i = 0; i < inner; i++) run();
+            t[r] = (double)(bench_ticks() - c0) / inner;
+        }
+    }
+
+    std::sort(t.begin(), t.end());
+    return t[cfg.reps / 2];
+}
+
+static void record( const BenchConfig & cfg, const char * kernel, int order, bool cold,
+                    double ticks, double flops_per_sample, int samples )
+{
+    BenchResult r;
+    r.kernel = kernel;
+    r.order = order;
+    r.channels = (order + 1) * (order + 1);
+    r.isa = ambi_isa_name();
+    r.cache = cold ? "cold" : "warm";
+    r.ns_per_sample = ticks / cfg.tick_rate / samples;
+    r.cycles_per_sample = AMBI_BENCH_TSC ? ticks / samples : 0;
+    r.gflops = flops_per_sample > 0 ? flops_per_sample / r.ns_per_sample : 0;
+    results.push_back(r);
+
+    printf("%-13s %d  %2d ch  %-7s %-5s %9.3f ns  %9.2f cyc  %7.2f GFLOP/s\n", kernel, order,
+           r.channels, r.isa.c_str(), r.cache.c_str(), r.ns_per_sample, r.cycles_per_sample, r.gflops);
+}
+
+// every kernel at one order, on the instruction set selected in ambi_isa
+template<int ORDER>
+static void bench_order( const BenchConfig & cfg )
+{
+    const int N_CH = (ORDER + 1) * (ORDER + 1);
+    const int n = cfg.frames;
+
+    std::vector<SAMPLE> in(n * N_CH), out(n * N_CH);
+    std::vector<t_CKFLOAT> azimuth(n), elevation(n);
+    std::vector<float> gains(n * N_CH), dL(N_CH, 1.f / N_CH), dR(N_CH, -1.f / N_CH);
+    ambi_gain_t gain[MAX_CHANNELS], step[MAX_CHANNELS], accel[MAX_CHANNELS], jerk[MAX_CHANNELS];
+    std::vector<float *> rows(n);
+    const float * coeffs = sh_coeffs();
+    void (* volatile sh_one)( t_CKFLOAT, t_CKFLOAT, const float *, float * ) = sh_gains_one<ORDER>;
+
+    srand(ORDER);
+    for (int i = 0; i < n * N_CH; i++) in[i] = rand() / (float)RAND_MAX - 0.5f;
+    for (int i = 0; i < n; i++) {
+        azimuth[i] = (rand() / (double)RAND_MAX * 2 - 1) * M_PI;
+        elevation[i] = (rand() / (double)RAND_MAX - 0.5) * M_PI;
+        rows[i] = &gains[i * N_CH];
+    }
+    for (int c = 0; c < MAX_CHANNELS; c++) {
+        gain[c] = 0.5f;
+        step[c] = 1e-9f;
+        accel[c] = 0;
+        jerk[c] = 0;
+    }
+
+    for (int cold = 1; cold >= 0; cold--) {
+        double t;
+
+        // in batches of AMBI_BATCH_SOURCES, as panMany() evaluates them
+        t = time_kernel(cfg, cold, [&] {
+            for (int s = 0; s < n; s += AMBI_BATCH_SOURCES)
+                sh_gains_batch<ORDER>(std::min(AMBI_BATCH_SOURCES, n - s), &azimuth[s], &elevation[s], &rows[s]);
+        });
+        record(cfg, "sh_gains", ORDER, cold, t, sh_flops(ORDER), n);
+
+        t = time_kernel(cfg, cold, [&] {
+            for (int s = 0; s < n; s++) sh_one(azimuth[s], elevation[s], coeffs, &gains[s * N_CH]);
+        });
+        record(cfg, "sh_gains_one", ORDER, cold, t, sh_flops(ORDER), n);
+
+        t = time_kernel(cfg, cold, [&] { AMBI_CALL_KERNEL(encode_const, <N_CH>, (in.data(), out.data(), n, gain)); });
+        record(cfg, "encode_const", ORDER, cold, t, N_CH, n);
+
+        t = time_kernel(cfg, cold, [&] { AMBI_CALL_KERNEL(encode_ramp, <N_CH>, (in.data(), out.data(), n, gain, step)); });
+        record(cfg, "encode_ramp", ORDER, cold, t, 3 * N_CH, n);
+
+        t = time_kernel(cfg, cold, [&] { AMBI_CALL_KERNEL(encode_cubic, <N_CH>, (in.data(), out.data(), n, gain, step, accel, jerk)); });
+        record(cfg, "encode_cubic", ORDER, cold, t, 7 * N_CH, n);
+
+        t = time_kernel(cfg, cold, [&] { AMBI_CALL_KERNEL(decode, <N_CH>, (in.data(), out.data(), n, dL.data(), dR.data())); });
+        record(cfg, "decode", ORDER, cold, t, 4 * N_CH, n);
+    }
+
+    sink = out[0] + gains[0];
+}
+
+// orders 1 and up, as far as MAX_CHANNELS reaches
+template<int ORDER, bool IN_RANGE = ((ORDER + 1) * (ORDER + 1) <= MAX_CHANNELS)>
+struct BenchOrders
+{
+    static void run( const BenchConfig & cfg )
+    {
+        bench_order<ORDER>(cfg);
+        BenchOrders<ORDER + 1>::run(cfg);
+    }
+};
+
+template<int ORDER>
+struct BenchOrders<ORDER, false>
+{
+    static void run( const BenchConfig & ) {}
+};
+
+static bool write_json( const char * path, const std::string & rev, const BenchConfig & cfg )
+{
+    FILE * fp = fopen(path, "w");
+    if (!fp) return false;
+
+    fprintf(fp, "{\n  \"revision\": \"%s\",\n  \"compiler\": \"%s\",\n", rev.c_str(), __VERSION__);
+    fprintf(fp, "  \"frames\": %d,\n  \"reps\": %d,\n  \"tsc_ghz\": %.4f,\n  \"results\": [\n",
+            cfg.frames, cfg.reps, AMBI_BENCH_TSC ? cfg.tick_rate : 0.0);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult & r = results[i];
+        fprintf(fp, "    {\"kernel\": \"%s\", \"order\": %d, \"channels\": %d, \"isa\": \"%s\", \"cache\": \"%s\", "
+                    "\"ns_per_sample\": %.4f, \"cycles_per_sample\": %.3f, \"gflops\": %.3f}%s\n",
+                r.kernel.c_str(), r.order, r.channels, r.isa.c_str(), r.cache.c_str(),
+                r.ns_per_sample, r.cycles_per_sample, r.gflops, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return true;
+}
+
+static bool write_csv( const char * path, const std::string & rev )
+{
+    FILE * fp = fopen(path, "w");
+    if (!fp) return false;
+
+    fprintf(fp, "revision,kernel,order,channels,isa,cache,ns_per_sample,cycles_per_sample,gflops\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult & r = results[i];
+        fprintf(fp, "%s,%s,%d,%d,%s,%s,%.4f,%.3f,%.3f\n", rev.c_str(), r.kernel.c_str(), r.order,
+                r.channels, r.isa.c_str(), r.cache.c_str(), r.ns_per_sample, r.cycles_per_sample, r.gflops);
+    }
+    fclose(fp);
+    return true;
+}
+
+int main( int argc, char ** argv )
+{
+    BenchConfig cfg;
+    cfg.frames = MAX_BLOCK_SIZE;
+    cfg.reps = 21;
+    cfg.evict_bytes = 64 << 20;
+    const char * json = NULL;
+    const char * csv = NULL;
+    std::string rev = "unknown";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "usage: %s [--json file] [--csv file] [--rev name] [--frames n] [--reps n] [--evict-mb n]\n", argv[0]);
+            return 1;
+        }
+        if (arg == "--json") json = argv[++i];
+        else if (arg == "--csv") csv = argv[++i];
+        else if (arg == "--rev") rev = argv[++i];
+        else if (arg == "--frames") cfg.frames = std::max(1, atoi(argv[++i]));
+        else if (arg == "--reps") cfg.reps = std::max(1, atoi(argv[++i]));
+        else if (arg == "--evict-mb") cfg.evict_bytes = (size_t)std::max(1, atoi(argv[++i])) << 20;
+        else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    evict_buffer.assign(cfg.evict_bytes, 0);
+    cfg.tick_rate = bench_tick_rate();
+
+    // every instruction set up to the widest this CPU supports
+    int widest = ambi_detect_isa();
+    for (int isa = AMBI_ISA_GENERIC; isa <= widest; isa++) {
+        ambi_isa = isa;
+        BenchOrders<1>::run(cfg);
+    }
+
+    if (json && !write_json(json, rev, cfg)) {
+        fprintf(stderr, "cannot write %s\n", json);
+        return 1;
+    }
+    if (csv && !write_csv(csv, rev)) {
+        fprintf(stderr, "cannot write %s\n", csv);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,308 @@
+// AmbiAccuracy.cpp
+// Accuracy of the fast SH paths against a long double reference built from the
+// textbook ACN / SN3D definitions (associated Legendre recurrence, no
+// Condon-Shortley phase). Every path is evaluated over a dense sphere grid and
+// along a long motion run, and the largest and RMS error of every channel and
+// order is reported. Exits non-zero when an evaluation path is off by more than
+// the tolerance; the interpolated gains along the motion run are reported only,
+// as their error depends on the source speed rather than on the kernels, and so
+// are baked gains, which float16 rounds to about 2^-12 by design.
+//
+// usage: AmbiAccuracy [--tol x] [--step degrees] [--minutes m] [--summary] [--csv file]
+
+#include "AmbiCore.h"
+#include "AmbiBake.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+typedef long double ref_t;
+
+static const int MAX_ORDER = 7;
+static const ref_t REF_PI = 3.141592653589793238462643383279502884L;
+
+// ACN / SN3D gains of every channel up to MAX_ORDER. cos(elevation) keeps its sign,
+// so directions past the poles match the fast paths, which take any elevation
+static void ref_gains( ref_t azimuth, ref_t elevation, ref_t * gains )
+{
+    ref_t x = sinl(elevation);
+    ref_t y = cosl(elevation);
+
+    for (int m = 0; m <= MAX_ORDER; m++) {
+        // P_m^m = (2m - 1)!! cos^m, then P_l^m by the three-term recurrence in l
+        ref_t p_mm = 1;
+        for (int k = 1; k <= m; k++) p_mm *= (2 * k - 1) * y;
+
+        ref_t p_prev = 0, p = p_mm;
+        for (int l = m; l <= MAX_ORDER; l++) {
+            if (l == m + 1) {
+                p_prev = p;
+                p = x * (2 * m + 1) * p_mm;
+            } else if (l > m + 1) {
+                ref_t p_next = ((2 * l - 1) * x * p - (l + m - 1) * p_prev) / (l - m);
+                p_prev = p;
+                p = p_next;
+            }
+
+            // SN3D: sqrt((2 - delta_m0) (l - m)! / (l + m)!)
+            ref_t norm = m == 0 ? 1 : 2;
+            for (int k = l - m + 1; k <= l + m; k++) norm /= k;
+            norm = sqrtl(norm);
+
+            gains[l * l + l + m] = norm * p * cosl(m * azimuth);
+            if (m > 0) gains[l * l + l - m] = norm * p * sinl(m * azimuth);
+        }
+    }
+}
+
+// largest and RMS error of every channel for one path
+struct ErrorStats
+{
+    std::string path;
+    bool checked;
+    double max_err[MAX_CHANNELS];
+    double sum_sq[MAX_CHANNELS];
+    long count;
+
+    ErrorStats( const std::string & p, bool c ) : path(p), checked(c), count(0)
+    {
+        for (int ch = 0; ch < MAX_CHANNELS; ch++) max_err[ch] = sum_sq[ch] = 0;
+    }
+
+    template<typename T>
+    void add( const T * gains, const ref_t * ref, int stride = 1 )
+    {
+        for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+            double e = fabs((double)(gains[ch * stride] - ref[ch]));
+            max_err[ch] = std::max(max_err[ch], e);
+            sum_sq[ch] += e * e;
+        }
+        count++;
+    }
+
+    double rms( int ch ) const { return count ? sqrt(sum_sq[ch] / count) : 0; }
+};
+
+static std::vector<ErrorStats> stats;
+
+// every fast evaluation over a grid of the sphere with the given step; every
+// direction is also checked 2 pi k away, through the same angle wrap as the chugins
+static void check_grid( double step_deg )
+{
+    ErrorStats scalar("sh_gains", true), wrapped("sh_gains wrapped", true), dbl("sh_gains double", true);
+    ErrorStats xyz("sh_gains_xyz", true);
+    ErrorStats baked("baked float16", false);
+    const int saved_isa = ambi_isa;
+
+    std::vector<t_CKFLOAT> az, el;
+    for (double e = -90; e <= 90 + 1e-9; e += step_deg)
+        for (double a = -180; a <= 180 + 1e-9; a += step_deg) {
+            az.push_back(a * M_PI / 180);
+            el.push_back(e * M_PI / 180);
+        }
+    const int n = (int)az.size();
+
+    std::vector<ref_t> ref(n * MAX_CHANNELS);
+    for (int i = 0; i < n; i++)
+        ref_gains(az[i] * (REF_PI / M_PI), el[i] * (REF_PI / M_PI), &ref[i * MAX_CHANNELS]);
+
+    const float * coeffs = sh_coeffs();
+    float g[MAX_CHANNELS], gh[MAX_CHANNELS];
+    double gd[MAX_CHANNELS];
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        sh_gains((float)wrap_angle(az[i]), (float)wrap_angle(el[i]), MAX_ORDER, coeffs, g, 1);
+        scalar.add(g, &ref[i * MAX_CHANNELS]);
+
+        // the same gains through a baked file
+        for (int ch = 0; ch < MAX_CHANNELS; ch++) gh[ch] = ambi_half_to_float(ambi_half_from_float(g[ch]));
+        baked.add(gh, &ref[i * MAX_CHANNELS]);
+
+        sh_gains((float)wrap_angle(az[i]), (float)wrap_angle(el[i]), MAX_ORDER, coeffs, gd, 1);
+        dbl.add(gd, &ref[i * MAX_CHANNELS]);
+
+        int ka = rand() % 17 - 8, ke = rand() % 17 - 8;
+        sh_gains((float)wrap_angle(az[i] + ka * 2 * M_PI), (float)wrap_angle(el[i] + ke * 2 * M_PI),
+                 MAX_ORDER, coeffs, g, 1);
+        wrapped.add(g, &ref[i * MAX_CHANNELS]);
+
+        // the same direction as a vector of some length, the way a great-circle path holds it
+        double r = 0.5 + rand() % 16 / 8.0;
+        sh_gains_xyz(r * cos(el[i]) * cos(az[i]), r * cos(el[i]) * sin(az[i]), r * sin(el[i]),
+                     MAX_ORDER, coeffs, g, 1);
+        xyz.add(g, &ref[i * MAX_CHANNELS]);
+    }
+    stats.push_back(scalar);
+    stats.push_back(wrapped);
+    stats.push_back(dbl);
+    stats.push_back(xyz);
+    stats.push_back(baked);
+
+    // a group rotation applied to the gains of every direction, against the
+    // reference at the rotated direction; the rotations cycle through a few
+    // arbitrary ones
+    ErrorStats rotated("ambi_rotation", true);
+    const int NROT = 8;
+    std::vector<float> blocks(NROT * AMBI_ROT_SIZE);
+    double R[NROT][3][3];
+    for (int r = 0; r < NROT; r++) {
+        double yaw = 2.1 * r - 7, pitch = sin(1.7 * r) * 1.5, roll = cos(0.9 * r) * 3;
+        ambi_rotation(yaw, pitch, roll, MAX_ORDER, &blocks[r * AMBI_ROT_SIZE]);
+
+        // the same rotation as rows of a 3 x 3 matrix, from the images of the axes
+        const double axes[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+        for (int c = 0; c < 3; c++) {
+            double v[3] = { axes[c][0], axes[c][1], axes[c][2] };
+            double t;
+            t = v[1] * cos(roll) - v[2] * sin(roll); v[2] = v[1] * sin(roll) + v[2] * cos(roll); v[1] = t;
+            t = v[0] * cos(pitch) - v[2] * sin(pitch); v[2] = v[0] * sin(pitch) + v[2] * cos(pitch); v[0] = t;
+            t = v[0] * cos(yaw) - v[1] * sin(yaw); v[1] = v[0] * sin(yaw) + v[1] * cos(yaw); v[0] = t;
+            for (int row = 0; row < 3; row++) R[r][row][c] = v[row];
+        }
+    }
+    SAMPLE x[MAX_CHANNELS], y[MAX_CHANNELS];
+    ref_t rref[MAX_CHANNELS];
+    for (int i = 0; i < n; i++) {
+        const int r = i % NROT;
+        sh_gains((float)wrap_angle(az[i]), (float)wrap_angle(el[i]), MAX_ORDER, coeffs, x, 1);
+        rotate_const<MAX_ORDER, MAX_CHANNELS>(x, y, 1, &blocks[r * AMBI_ROT_SIZE]);
+
+        double d[3] = { cos(el[i]) * cos(az[i]), cos(el[i]) * sin(az[i]), sin(el[i]) }, q[3];
+        for (int row = 0; row < 3; row++) q[row] = R[r][row][0] * d[0] + R[r][row][1] * d[1] + R[r][row][2] * d[2];
+        ref_gains(atan2l(q[1], q[0]), atan2l(q[2], sqrtl((ref_t)q[0] * q[0] + (ref_t)q[1] * q[1])), rref);
+        rotated.add(y, rref);
+    }
+    stats.push_back(rotated);
+
+    // the batched evaluator, on every instruction set this CPU runs
+    std::vector<float> bank(n * MAX_CHANNELS);
+    std::vector<float *> rows(n);
+    for (int i = 0; i < n; i++) rows[i] = &bank[i * MAX_CHANNELS];
+    for (int isa = AMBI_ISA_GENERIC; isa <= ambi_detect_isa(); isa++) {
+        ambi_isa = isa;
+        ErrorStats batch(std::string("sh_gains_batch ") + ambi_isa_name(), true);
+        sh_gains_batch<MAX_ORDER>(n, az.data(), el.data(), rows.data());
+        for (int i = 0; i < n; i++) batch.add(rows[i], &ref[i * MAX_CHANNELS]);
+        stats.push_back(batch);
+    }
+    ambi_isa = saved_isa;
+}
+
+// a source moving at constant speed for a long run, with its angles accumulated
+// and wrapped every update period the way AmbiPan does; gains at every update
+// point are checked, and every 64th ramp runs through encode_ramp with a unit
+// input and is compared sample by sample against the true position
+static void check_motion( double minutes )
+{
+    ErrorStats points("motion update points", true), ramp("motion linear ramp", false);
+
+    const int period = 64;
+    const double srate = 48000;
+    const long updates = (long)(minutes * 60 * srate / period);
+    const ref_t va = 2 * REF_PI * 0.37L * period / srate;   // 0.37 turns / second
+    const ref_t ve = 2 * REF_PI * 0.11L * period / srate;   // over the poles as well
+    const ref_t a0 = 0.3L, e0 = -0.2L;
+
+    const float * coeffs = sh_coeffs();
+    t_CKFLOAT azimuth = (t_CKFLOAT)a0, elevation = (t_CKFLOAT)e0;
+    ambi_gain_t cur[MAX_CHANNELS], next[MAX_CHANNELS], step[MAX_CHANNELS];
+    ref_t ref[MAX_CHANNELS];
+    SAMPLE in[period], out[period * MAX_CHANNELS];
+    for (int f = 0; f < period; f++) in[f] = 1;
+
+    sh_gains((float)azimuth, (float)elevation, MAX_ORDER, coeffs, cur, 1);
+    for (long k = 1; k <= updates; k++) {
+        azimuth = wrap_angle(azimuth + (t_CKFLOAT)va);
+        elevation = wrap_angle(elevation + (t_CKFLOAT)ve);
+        sh_gains((float)azimuth, (float)elevation, MAX_ORDER, coeffs, next, 1);
+        ref_gains(a0 + k * va, e0 + k * ve, ref);
+        points.add(next, ref);
+
+        if (k % 64 == 0) {
+            for (int c = 0; c < MAX_CHANNELS; c++) step[c] = (next[c] - cur[c]) / period;
+            AMBI_CALL_KERNEL(encode_ramp, <MAX_CHANNELS>, (in, out, period, cur, step));
+            for (int f = 0; f < period; f++) {
+                ref_t t = (k - 1) + (ref_t)f / period;
+                ref_gains(a0 + t * va, e0 + t * ve, ref);
+                ramp.add(out + f * MAX_CHANNELS, ref);
+            }
+        }
+        for (int c = 0; c < MAX_CHANNELS; c++) cur[c] = next[c];
+    }
+    stats.push_back(points);
+    stats.push_back(ramp);
+}
+
+int main( int argc, char ** argv )
+{
+    double tol = 1e-5;
+    double step_deg = 0.5;
+    double minutes = 10;
+    bool summary = false;
+    const char * csv = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--summary") summary = true;
+        else if (i + 1 >= argc) {
+            fprintf(stderr, "usage: %s [--tol x] [--step degrees] [--minutes m] [--summary] [--csv file]\n", argv[0]);
+            return 1;
+        }
+        else if (arg == "--tol") tol = atof(argv[++i]);
+        else if (arg == "--step") step_deg = std::max(0.01, atof(argv[++i]));
+        else if (arg == "--minutes") minutes = std::max(0.0, atof(argv[++i]));
+        else if (arg == "--csv") csv = argv[++i];
+        else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    check_grid(step_deg);
+    check_motion(minutes);
+
+    FILE * fp = csv ? fopen(csv, "w") : NULL;
+    if (csv && !fp) {
+        fprintf(stderr, "cannot write %s\n", csv);
+        return 1;
+    }
+    if (fp) fprintf(fp, "path,channel,order,max_error,rms_error\n");
+
+    int failures = 0;
+    for (size_t s = 0; s < stats.size(); s++) {
+        const ErrorStats & st = stats[s];
+        printf("%s (%ld directions)%s\n", st.path.c_str(), st.count, st.checked ? "" : ", not checked");
+
+        // per channel
+        for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+            int l = (int)sqrt((double)ch);
+            bool bad = st.checked && st.max_err[ch] > tol;
+            if (bad) failures++;
+            if (!summary || bad)
+                printf("    ch %2d  l %d  m %+d   max %.3e  rms %.3e%s\n", ch, l, ch - l * l - l,
+                       st.max_err[ch], st.rms(ch), bad ? "  FAILED" : "");
+            if (fp) fprintf(fp, "%s,%d,%d,%.6e,%.6e\n", st.path.c_str(), ch, l, st.max_err[ch], st.rms(ch));
+        }
+
+        // per order, over every channel an encoder of that order writes
+        for (int order = 1; order <= MAX_ORDER; order++) {
+            int nch = (order + 1) * (order + 1);
+            double mx = 0, sq = 0;
+            for (int ch = 0; ch < nch; ch++) {
+                mx = std::max(mx, st.max_err[ch]);
+                sq += st.sum_sq[ch];
+            }
+            printf("  order %d  max %.3e  rms %.3e\n", order, mx, st.count ? sqrt(sq / (st.count * nch)) : 0);
+        }
+    }
+    if (fp) fclose(fp);
+
+    if (failures) {
+        printf("FAILED, %d channel / path pairs above %.1e\n", failures, tol);
+        return 1;
+    }
+    printf("PASSED, every evaluation path within %.1e\n", tol);
+    return 0;
+}
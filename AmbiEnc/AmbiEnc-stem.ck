@@ -0,0 +1,35 @@
+/*
+    AmbiEnc-stem.ck
+
+    Encode a 5.1 stem as one stream with AmbiEncMulti3: six tones go in on the
+    L R C LFE Ls Rs inputs, the whole layout turns once every 20 seconds, and
+    its width breathes between a point and twice the layout.
+
+    How to run (from AmbiEnc directory):
+        ```
+        $ chuck --chugin:./AmbiEnc.chug --dac:<DEVICE_FOR_AMBISONICS> --out:16 AmbiEnc-stem.ck
+        ```
+*/
+
+AmbiEncMulti3 stem(AmbiEncMulti3.SURROUND_51) => dac;
+stem.silenceDetection(1);
+
+// one tone per input; the LFE input (3) is left out of the encoding
+[48, 55, 60, 36, 64, 67] @=> int notes[];
+SinOsc osc[6];
+for (0 => int k; k < 6; k++) {
+    Math.mtof(notes[k]) => osc[k].freq;
+    0.1 => osc[k].gain;
+    osc[k] => stem.chan(k);
+}
+
+chout <= "encoding " <= stem.inputs() <= " inputs on " <= AmbiEncMulti3.isa() <= IO.nl();
+
+// normalized bounds: an azimuth of 1 is half a turn
+0.0 => float t;
+while (true) {
+    stem.pan(Math.remainder(t / 10, 2), 0);
+    1 + Math.sin(2 * pi * t / 8) => stem.width;
+    50::ms => now;
+    0.05 +=> t;
+}
@@ -3,11 +3,26 @@
 // For basic functionality like panning azimuth and elevation values
 
 #include "chugin.h"
+#include "AmbiCore.h"
+#include "AmbiBake.h"
 #include <cmath>
+#include <cstring>
 
-const int MAX_CHANNELS = 64;
 static t_CKUINT ambienc_bounds_normalized = 0;
 static t_CKUINT ambienc_bounds_radians = 1;
+static t_CKUINT ambienc_interp_linear = 0;
+static t_CKUINT ambienc_interp_hermite = 1;
+static t_CKUINT ambienc_layout_stereo = 0;
+static t_CKUINT ambienc_layout_quad = 1;
+static t_CKUINT ambienc_layout_51 = 2;
+static t_CKUINT ambienc_layout_71 = 3;
+static t_CKUINT ambienc_layout_custom = 4;
+
+// inputs of every multi-input encoder, enough for a 7.1 stem
+const int AMBIENC_MULTI_INPUTS = 8;
+
+// process id of AmbiEnc in Chrome traces (see AmbiTrace.h)
+static const int AMBIENC_TRACE_PID = 2;
 
 
 // declaration of chugin functions
@@ -26,6 +41,35 @@ static t_CKUINT ambienc_bounds_radians = 1;
     CK_DLL_MFUN(ambienc##N##_getUpdatePeriod);           \
     CK_DLL_MFUN(ambienc##N##_setBoundsType);             \
     CK_DLL_MFUN(ambienc##N##_getBoundsType);             \
+    CK_DLL_MFUN(ambienc##N##_setBlockSize);              \
+    CK_DLL_MFUN(ambienc##N##_getBlockSize);              \
+    CK_DLL_MFUN(ambienc##N##_getLatency);                \
+    CK_DLL_MFUN(ambienc##N##_setSilenceDetection);       \
+    CK_DLL_MFUN(ambienc##N##_getSilenceDetection);       \
+    CK_DLL_MFUN(ambienc##N##_getSilent);                 \
+    CK_DLL_MFUN(ambienc##N##_setAdaptive);               \
+    CK_DLL_MFUN(ambienc##N##_getAdaptive);               \
+    CK_DLL_MFUN(ambienc##N##_setMaxError);               \
+    CK_DLL_MFUN(ambienc##N##_getMaxError);               \
+    CK_DLL_MFUN(ambienc##N##_setInterp);                 \
+    CK_DLL_MFUN(ambienc##N##_getInterp);                 \
+    CK_DLL_MFUN(ambienc##N##_getOverruns);               \
+    CK_DLL_MFUN(ambienc##N##_getWorstTick);              \
+    CK_DLL_MFUN(ambienc##N##_getInstanceId);             \
+    CK_DLL_MFUN(ambienc##N##_playBaked);                 \
+    CK_DLL_MFUN(ambienc##N##_stopBaked);                 \
+    CK_DLL_SFUN(ambienc##N##_precisionError);            \
+    CK_DLL_SFUN(ambienc##N##_instances);                 \
+    CK_DLL_SFUN(ambienc##N##_samplesProcessed);          \
+    CK_DLL_SFUN(ambienc##N##_gainUpdates);               \
+    CK_DLL_SFUN(ambienc##N##_silentBlocks);              \
+    CK_DLL_SFUN(ambienc##N##_tickTime);                  \
+    CK_DLL_SFUN(ambienc##N##_resetStats);                \
+    CK_DLL_SFUN(ambienc##N##_tickP50);                   \
+    CK_DLL_SFUN(ambienc##N##_tickP99);                   \
+    CK_DLL_SFUN(ambienc##N##_tickMax);                   \
+    CK_DLL_SFUN(ambienc##N##_tickOverruns);              \
+    CK_DLL_SFUN(ambienc##N##_panMany);                   \
     t_CKINT ambienc##N##_data_offset = 0;
 
 DECLARE_ORDER_FUNCS(1)
@@ -36,14 +80,59 @@ DECLARE_ORDER_FUNCS(5)
 DECLARE_ORDER_FUNCS(6)
 DECLARE_ORDER_FUNCS(7)
 
-
-// class definition for internal chugin data
-class AmbiEnc
+#define DECLARE_MULTI_FUNCS(N)                              \
+    CK_DLL_CTOR(ambimulti##N##_ctor);                       \
+    CK_DLL_CTOR(ambimulti##N##_ctor_layout);                \
+    CK_DLL_CTOR(ambimulti##N##_ctor_layoutAndPeriod);       \
+    CK_DLL_CTOR(ambimulti##N##_ctor_layoutPeriodAndBounds); \
+    CK_DLL_DTOR(ambimulti##N##_dtor);                       \
+    CK_DLL_TICKF(ambimulti##N##_tickf);                     \
+    CK_DLL_MFUN(ambimulti##N##_setLayout);                  \
+    CK_DLL_MFUN(ambimulti##N##_getLayout);                  \
+    CK_DLL_MFUN(ambimulti##N##_setDirections);              \
+    CK_DLL_MFUN(ambimulti##N##_getInputs);                  \
+    CK_DLL_MFUN(ambimulti##N##_setAzimuth);                 \
+    CK_DLL_MFUN(ambimulti##N##_getAzimuth);                 \
+    CK_DLL_MFUN(ambimulti##N##_setElevation);               \
+    CK_DLL_MFUN(ambimulti##N##_getElevation);               \
+    CK_DLL_MFUN(ambimulti##N##_pan);                        \
+    CK_DLL_MFUN(ambimulti##N##_setWidth);                   \
+    CK_DLL_MFUN(ambimulti##N##_getWidth);                   \
+    CK_DLL_MFUN(ambimulti##N##_setUpdatePeriod);            \
+    CK_DLL_MFUN(ambimulti##N##_getUpdatePeriod);            \
+    CK_DLL_MFUN(ambimulti##N##_setBoundsType);              \
+    CK_DLL_MFUN(ambimulti##N##_getBoundsType);              \
+    CK_DLL_MFUN(ambimulti##N##_setSilenceDetection);        \
+    CK_DLL_MFUN(ambimulti##N##_getSilenceDetection);        \
+    CK_DLL_MFUN(ambimulti##N##_getSilent);                  \
+    t_CKINT ambimulti##N##_data_offset = 0;
+
+DECLARE_MULTI_FUNCS(1)
+DECLARE_MULTI_FUNCS(2)
+DECLARE_MULTI_FUNCS(3)
+DECLARE_MULTI_FUNCS(4)
+DECLARE_MULTI_FUNCS(5)
+DECLARE_MULTI_FUNCS(6)
+DECLARE_MULTI_FUNCS(7)
+CK_DLL_SFUN(ambienc_isa);
+CK_DLL_SFUN(ambienc_statsTiming);
+CK_DLL_SFUN(ambienc_traceStart);
+CK_DLL_SFUN(ambienc_traceStop);
+CK_DLL_SFUN(ambienc_deadlineMonitor);
+CK_DLL_SFUN(ambienc_deadlineBudget);
+CK_DLL_SFUN(ambienc_deadlineDump);
+
+
+// class definition for internal chugin data; T is the precision of the gain state
+template<typename T>
+class AmbiEncT
 {
 public:
-    AmbiEnc( t_CKINT order, t_CKINT update_period, t_CKINT bounds_type )
+    AmbiEncT( t_CKINT order, t_CKINT update_period, t_CKINT bounds_type )
     {
         m_order = order;
+        m_stats = ambi_stats_block();
+        ambi_stats_count(m_stats, m_order, AMBI_STAT_INSTANCES, 1);
         m_out_channels = (order + 1) * (order + 1);
         m_azimuth = 0;
         m_elevation = 0;
@@ -52,22 +141,70 @@ public:
         m_update_period = (update_period < 1 ? 1 : update_period);
         m_samples_left = 0;
 
+        // block processing is off until requested
+        m_block_size = 1;
+        m_block_pos = 0;
+        m_block_in = NULL;
+        m_block_out = NULL;
+
+        // silence detection
+        m_silence_detect = false;
+        m_silent_frames = 0;
+        m_gains_stale = false;
+
+        // adaptive update period
+        m_adaptive = false;
+        m_max_error = 0.001;
+        m_last_azimuth = 0;
+        m_last_elevation = 0;
+        m_samples_since_update = 0;
+
+        // gain interpolation shape
+        m_interp = ambienc_interp_linear;
+        m_slope_valid = false;
+        m_chord_period = m_update_period;
+
+        // baked gain playback (none playing)
+        m_bake = NULL;
+        m_bake_time = 0;
+        m_bake_step = 0;
+        m_bake_started = false;
+
+        // gains from a batched pan (none yet)
+        m_batch_valid = false;
+        m_batch_azimuth = 0;
+        m_batch_elevation = 0;
+
         for (int c = 0; c < MAX_CHANNELS; c++) {
-            m_gain_cur[c]  = 0;
-            m_gain_next[c] = 0;
-            m_gain_step[c] = 0;
+            m_gain_cur[c]   = 0;
+            m_gain_next[c]  = 0;
+            m_gain_step[c]  = 0;
+            m_gain_accel[c] = 0;
+            m_gain_jerk[c]  = 0;
+            m_gain_slope[c] = 0;
+            m_gain_chord[c] = 0;
+            m_gain_batch[c] = 0;
         }
 
         // Compute initial coefficients and gains
-        compute_coeffs();
-        compute_gains();
+        m_coeffs = sh_coeffs();
+        compute_gains(m_azimuth, m_elevation, m_gain_next);
         for (int c = 0; c < MAX_CHANNELS; c++)
             m_gain_cur[c] = m_gain_next[c];
     }
 
+    ~AmbiEncT()
+    {
+        delete [] m_block_in;
+        delete [] m_block_out;
+        ambi_choreo_release(m_bake, &m_bake_cursor);
+        ambi_stats_count(m_stats, m_order, AMBI_STAT_INSTANCES, -1);
+    }
+
     // setters
     t_CKFLOAT setAzimuth( t_CKFLOAT a )
     {
+        stopBaked();
         if (m_bounds_type == ambienc_bounds_normalized)
             a = scalef(a, -1., 1., -M_PI, M_PI);
         if (a != m_azimuth) { m_azimuth = a; m_pan_change = true; }
@@ -76,6 +213,7 @@ public:
 
     t_CKFLOAT setElevation( t_CKFLOAT e )
     {
+        stopBaked();
         if (m_bounds_type == ambienc_bounds_normalized)
             e = scalef(e, -1., 1., -M_PI, M_PI);
         if (e != m_elevation) { m_elevation = e; m_pan_change = true; }
@@ -84,6 +222,7 @@ public:
 
     t_CKVEC2 pan( t_CKFLOAT a, t_CKFLOAT e )
     {
+        stopBaked();
         if (m_bounds_type == ambienc_bounds_normalized) {
             a = scalef(a, -1., 1., -M_PI, M_PI);
             e = scalef(e, -1., 1., -M_PI, M_PI);
@@ -93,6 +232,17 @@ public:
         return v;
     }
 
+    // where gains at the position the last pan() set, evaluated together with
+    // other encoders, are to be written. The next update takes them instead of
+    // evaluating its own while the source is still there
+    T * pan_gains()
+    {
+        m_batch_azimuth = m_azimuth;
+        m_batch_elevation = m_elevation;
+        m_batch_valid = true;
+        return m_gain_batch;
+    }
+
     t_CKINT setUpdatePeriod( t_CKINT p )
     {
         m_update_period = (p < 1 ? 1 : p);
@@ -110,6 +260,88 @@ public:
         return -1;
     }
 
+    t_CKINT setBlockSize( t_CKINT b )
+    {
+        b = (b < 1 ? 1 : (b > MAX_BLOCK_SIZE ? MAX_BLOCK_SIZE : b));
+        if (b == m_block_size) return m_block_size;
+
+        delete [] m_block_in;
+        delete [] m_block_out;
+        m_block_in = NULL;
+        m_block_out = NULL;
+
+        // a block size of 1 processes every frame directly, without latency
+        if (b > 1) {
+            m_block_in = new SAMPLE[b];
+            m_block_out = new SAMPLE[b * m_out_channels];
+            memset(m_block_in, 0, sizeof(SAMPLE) * b);
+            memset(m_block_out, 0, sizeof(SAMPLE) * b * m_out_channels);
+        }
+
+        m_block_size = b;
+        m_block_pos = 0;
+        return m_block_size;
+    }
+
+    t_CKINT setSilenceDetection( t_CKINT d )
+    {
+        m_silence_detect = (d != 0);
+        m_silent_frames = 0;
+        return m_silence_detect;
+    }
+
+    t_CKINT setAdaptive( t_CKINT a )
+    {
+        m_adaptive = (a != 0);
+        return m_adaptive;
+    }
+
+    t_CKFLOAT setMaxError( t_CKFLOAT e )
+    {
+        m_max_error = (e <= 0 ? 1e-6 : e);
+        return m_max_error;
+    }
+
+    t_CKINT setInterp( t_CKINT i )
+    {
+        if (i != ambienc_interp_linear && i != ambienc_interp_hermite) return -1;
+
+        // takes effect at the next update
+        m_interp = i;
+        m_slope_valid = false;
+        return m_interp;
+    }
+
+    // play a file baked by AmbiPan.bake() from the next update on, interpolating
+    // between its gain vectors instead of evaluating them; returns its number of
+    // updates, or 0 if it can't be opened or was baked at a lower order
+    t_CKINT playBaked( const char * path, t_CKFLOAT srate )
+    {
+        AmbiChoreo * c = ambi_choreo_acquire(path);
+        if (!c) return 0;
+        if (c->order < m_order) {
+            ambi_choreo_release(c);
+            return 0;
+        }
+
+        stopBaked();
+        m_bake = c;
+        ambi_choreo_follow(c, &m_bake_cursor);
+        m_bake_time = 0;
+        m_bake_step = c->rate / srate;
+        m_bake_started = false;
+        m_samples_left = 0;
+        return c->nframes;
+    }
+
+    // stop baked playback, leaving the source where it is
+    void stopBaked()
+    {
+        if (!m_bake) return;
+        ambi_choreo_release(m_bake, &m_bake_cursor);
+        m_bake = NULL;
+    }
+
     // getters
     t_CKFLOAT getAzimuth()
     {
@@ -131,292 +363,728 @@ public:
         return m_bounds_type;
     }
 
+    t_CKINT getBlockSize()
+    {
+        return m_block_size;
+    }
+
+    t_CKDUR getLatency()
+    {
+        return m_block_size > 1 ? m_block_size : 0;
+    }
+
+    t_CKINT getSilenceDetection()
+    {
+        return m_silence_detect;
+    }
+
+    t_CKINT getSilent()
+    {
+        return m_silence_detect && m_silent_frames >= SILENCE_HOLD;
+    }
+
+    t_CKINT getOverruns()
+    {
+        return m_monitor.overruns;
+    }
+
+    t_CKFLOAT getWorstTick()
+    {
+        return ambi_clock_to_ns(m_monitor.worst);
+    }
+
+    t_CKINT getInstanceId()
+    {
+        return m_monitor.id;
+    }
+
+    t_CKINT getAdaptive()
+    {
+        return m_adaptive;
+    }
+
+    t_CKFLOAT getMaxError()
+    {
+        return m_max_error;
+    }
+
+    t_CKINT getInterp()
+    {
+        return m_interp;
+    }
+
     // tick template
     template<int N_CH>
     void tick( SAMPLE * in, SAMPLE * out, int nframes )
     {
-        for (int f = 0; f < nframes; f++) {
+        AMBI_TRACE_SCOPE("tick", "frames", nframes);
+        t_CKINT start = ambi_stats_tick_start();
+
+        if (m_block_size <= 1) {
+            process<N_CH>(in, out, nframes);
+        } else {
+            // buffer input and play back the block computed m_block_size frames ago
+            for (int f = 0; f < nframes; f++) {
+                m_block_in[m_block_pos] = in[f];
+                memcpy(out + f * N_CH, m_block_out + m_block_pos * N_CH, sizeof(SAMPLE) * N_CH);
+
+                if (++m_block_pos == m_block_size) {
+                    m_monitor.reasons |= AMBI_REASON_BLOCK;
+                    process<N_CH>(m_block_in, m_block_out, m_block_size);
+                    m_block_pos = 0;
+                }
+            }
+        }
+
+        m_monitor.end(m_stats, m_order, this, nframes, start);
+    }
+
+private:
+    // process template
+    template<int N_CH>
+    void process( SAMPLE * in, SAMPLE * out, int nframes )
+    {
+        AMBI_TRACE_SCOPE("process", "frames", nframes);
+        m_samples_since_update += nframes;
+
+        // silent input: write zeros once, then skip all work until the input comes back
+        if (detect_silence(in, nframes)) {
+            ambi_stats_count(m_stats, m_order, AMBI_STAT_SILENT_BLOCKS, 1);
+            if (m_bake) skip_baked(nframes);
+            AMBI_TRACE_INSTANT("silent", "frames", nframes);
+            clear_output(out, nframes * N_CH);
+            bypass<N_CH>();
+            return;
+        }
+
+        // the output was silent, so jump straight to any position set in the meantime
+        if (m_gains_stale) {
+            position_gains(m_gain_next);
+            for (int c = 0; c < N_CH; c++) {
+                m_gain_cur[c]   = m_gain_next[c];
+                m_gain_step[c]  = 0;
+                m_gain_accel[c] = 0;
+                m_gain_jerk[c]  = 0;
+            }
+            m_gains_stale = false;
+            m_slope_valid = false;
+            m_last_azimuth = m_azimuth;
+            m_last_elevation = m_elevation;
+            m_samples_since_update = 0;
+        }
+
+        int f = 0;
+        while (f < nframes) {
             // check if we need to recompute gains
-            if (m_samples_left <= 0 && m_pan_change) {
-                compute_gains();
-                for (int c = 0; c < N_CH; c++)
-                    m_gain_step[c] = (m_gain_next[c] - m_gain_cur[c]) / m_update_period;
+            if (m_samples_left <= 0 && (m_pan_change || baking())) {
+                AMBI_TRACE_SCOPE("update", "period", m_update_period);
+                if (m_bake) step_baked();
+                if (m_adaptive) adapt_period();
+                if (m_interp == ambienc_interp_hermite) {
+                    start_hermite<N_CH>();
+                } else {
+                    position_gains(m_gain_next);
+                    for (int c = 0; c < N_CH; c++)
+                        m_gain_step[c] = (m_gain_next[c] - m_gain_cur[c]) / m_update_period;
+                }
                 m_samples_left = m_update_period;
                 m_pan_change = false;
             }
 
-            // Set output channel every tick
-            for (int c = 0; c < N_CH; c++)
-                out[f * N_CH + c] = m_gain_cur[c] * in[f];
-
-            // gain interpolation
-            if (m_samples_left > 0) {
-                for (int c = 0; c < N_CH; c++)
-                    m_gain_cur[c] += m_gain_step[c];
-                m_samples_left--;
-
-                // if finished interpolating, set step size to 0 so we don't blow up the gain
-                if (m_samples_left == 0) {
-                    for (int c = 0; c < N_CH; c++) {
-                        m_gain_cur[c]  = m_gain_next[c];
-                        m_gain_step[c] = 0;
-                    }
+            // constant gains: nothing else can happen until the end of the block
+            if (m_samples_left <= 0) {
+                AMBI_CALL_KERNEL(encode_const, <N_CH>, (in + f, out + f * N_CH, nframes - f, m_gain_cur));
+                m_slope_valid = false;
+                return;
+            }
+
+            // gain interpolation, up to the end of the ramp or the block
+            int n = nframes - f;
+            if (m_samples_left < n) n = m_samples_left;
+            if (m_interp == ambienc_interp_hermite)
+                AMBI_CALL_KERNEL(encode_cubic, <N_CH>, (in + f, out + f * N_CH, n, m_gain_cur, m_gain_step, m_gain_accel, m_gain_jerk));
+            else
+                AMBI_CALL_KERNEL(encode_ramp, <N_CH>, (in + f, out + f * N_CH, n, m_gain_cur, m_gain_step));
+            m_samples_left -= n;
+            f += n;
+
+            // if finished interpolating, set step size to 0 so we don't blow up the gain
+            if (m_samples_left == 0) {
+                for (int c = 0; c < N_CH; c++) {
+                    m_gain_cur[c]   = m_gain_next[c];
+                    m_gain_step[c]  = 0;
+                    m_gain_accel[c] = 0;
+                    m_gain_jerk[c]  = 0;
                 }
+                m_slope_valid = true;
             }
         }
     }
 
-private:
-    void compute_coeffs()
-    {
-        // 1st order — 4 channels
-        m_coeffs[0] = 1.;
-        m_coeffs[1] = 1.;
-        m_coeffs[2] = 1.;
-        m_coeffs[3] = 1.;
-
-        // 2nd order — 9 channels
-        m_coeffs[4] = sqrt(3);
-        m_coeffs[5] = (1. / 4.) * sqrt(3);
-        m_coeffs[6] = (3. / 2.);
-        m_coeffs[7] = (1. / 4.) * sqrt(3);
-        m_coeffs[8] = (1. / 2.) * sqrt(3);
-
-        // 3rd order — 16 channels
-        m_coeffs[9]  = (1. / 4.) * sqrt(10);
-        m_coeffs[10] = sqrt(15);
-        m_coeffs[11] = (1. / 4.) * sqrt(6);
-        m_coeffs[12] = (1. / 2.);
-        m_coeffs[13] = (1. / 4.) * sqrt(6);
-        m_coeffs[14] = (1. / 2.) * sqrt(15);
-        m_coeffs[15] = (1. / 4.) * sqrt(10);
-
-        // 4th order — 25 channels
-        m_coeffs[16] = (1. / 32.) * sqrt(35);
-        m_coeffs[17] = (1. / 4.) * sqrt(70);
-        m_coeffs[18] = (1. / 2.) * sqrt(5);
-        m_coeffs[19] = (1. / 4.) * sqrt(10);
-        m_coeffs[20] = (35. / 8.);
-        m_coeffs[21] = (1. / 4.) * sqrt(10);
-        m_coeffs[22] = (1. / 4.) * sqrt(5);
-        m_coeffs[23] = (1. / 4.) * sqrt(70);
-        m_coeffs[24] = sqrt(35);
-
-        // 5th order — 36 channels
-        m_coeffs[25] = (3. / 16.) * sqrt(14);
-        m_coeffs[26] = (3. / 64.) * sqrt(35);
-        m_coeffs[27] = (-1. / 16.) * sqrt(70);
-        m_coeffs[28] = (1. / 2.) * sqrt(105);
-        m_coeffs[29] = (1. / 8.) * sqrt(15);
-        m_coeffs[30] = (1. / 8.);
-        m_coeffs[31] = (1. / 8.) * sqrt(15);
-        m_coeffs[32] = (1. / 4.) * sqrt(105);
-        m_coeffs[33] = (-1. / 16.) * sqrt(70);
-        m_coeffs[34] = (3. / 8.) * sqrt(35);
-        m_coeffs[35] = (3. / 128.) * sqrt(14);
-
-        // 6th order — 49 channels
-        m_coeffs[36] = (1. / 16.) * sqrt(462);
-        m_coeffs[37] = (3. / 16.) * sqrt(154);
-        m_coeffs[38] = (3. / 256.) * sqrt(7);
-        m_coeffs[39] = (-1. / 16.) * sqrt(210);
-        m_coeffs[40] = (1. / 16.) * sqrt(210);
-        m_coeffs[41] = (1. / 8.) * sqrt(21);
-        m_coeffs[42] = (231. / 16.);
-        m_coeffs[43] = (1. / 8.);
-        m_coeffs[44] = (1. / 32.) * sqrt(210);
-        m_coeffs[45] = (-1. / 16.) * sqrt(210);
-        m_coeffs[46] = (3. / 16.) * sqrt(7);
-        m_coeffs[47] = (3. / 256.) * sqrt(154);
-        m_coeffs[48] = (1. / 256.) * sqrt(462);
-
-        // 7th order — 64 channels
-        m_coeffs[49] = (1. / 32.) * sqrt(429);
-        m_coeffs[50] = (1. / 512.) * sqrt(6006);
-        m_coeffs[51] = (1. / 32.) * sqrt(231);
-        m_coeffs[52] = (1. / 512.) * sqrt(231);
-        m_coeffs[53] = (-1. / 32.) * sqrt(21);
-        m_coeffs[54] = (1. / 16.) * sqrt(42);
-        m_coeffs[55] = (1. / 32.) * sqrt(7);
-        m_coeffs[56] = (1. / 16.);
-        m_coeffs[57] = (1. / 32.) * sqrt(7);
-        m_coeffs[58] = (1. / 32.) * sqrt(42);
-        m_coeffs[59] = (-1. / 32.) * sqrt(21);
-        m_coeffs[60] = (1. / 16.) * sqrt(231);
-        m_coeffs[61] = (1. / 32.) * sqrt(231);
-        m_coeffs[62] = (1. / 512.) * sqrt(6006);
-        m_coeffs[63] = (1. / 32.) * sqrt(429);
-    }
-
-    void compute_gains()
-    {
-        // azimuth repeated expressions
-        t_CKFLOAT sinA = sinf(m_azimuth);
-        t_CKFLOAT cosA = cosf(m_azimuth);
-
-        t_CKFLOAT sinA2 = sinA * sinA;
-        t_CKFLOAT sinA4 = sinA2 * sinA2;
-        t_CKFLOAT sinA6 = sinA4 * sinA2;
-
-        t_CKFLOAT cosA2 = cosA * cosA;
-        t_CKFLOAT cosA4 = cosA2 * cosA2;
-        t_CKFLOAT cosA6 = cosA4 * cosA2;
-
-        t_CKFLOAT sin2A = 2 * sinA * cosA;
-        t_CKFLOAT cos2A = cosA2 - sinA2;
-
-        t_CKFLOAT sin3A = 2 * cosA * sin2A - sinA;
-        t_CKFLOAT cos3A = 2 * cosA * cos2A - cosA;
-
-        t_CKFLOAT sin4A = 2 * cosA * sin3A - sin2A;
-        t_CKFLOAT cos4A = 2 * cosA * cos3A - cos2A;
-
-        t_CKFLOAT sin5A = 2 * cosA * sin4A - sin3A;
-        t_CKFLOAT cos5A = 2 * cosA * cos4A - cos3A;
-
-        t_CKFLOAT sin6A = 2 * cosA * sin5A - sin4A;
-        t_CKFLOAT cos6A = 2 * cosA * cos5A - cos4A;
-
-        // elevation repeated expressions
-        t_CKFLOAT sinE = sinf(m_elevation);
-        t_CKFLOAT cosE = cosf(m_elevation);
-
-        t_CKFLOAT sinE2 = sinE * sinE;
-        t_CKFLOAT sinE4 = sinE2 * sinE2;
-        t_CKFLOAT sinE6 = sinE4 * sinE2;
-
-        t_CKFLOAT cosE2 = cosE * cosE;
-        t_CKFLOAT cosE3 = cosE2 * cosE;
-        t_CKFLOAT cosE4 = cosE2 * cosE2;
-        t_CKFLOAT cosE6 = cosE4 * cosE2;
-        t_CKFLOAT cosE7 = cosE6 * cosE;
-
-        t_CKFLOAT sin2E = 2 * sinE * cosE;
-        t_CKFLOAT cos2E = cosE2 - sinE2;
-
-        t_CKFLOAT sin3E = 2 * cosE * sin2E - sinE;
-        t_CKFLOAT cos3E = 2 * cosE * cos2E - cosE;
-
-        t_CKFLOAT cos2E_12 = (cos2E + 1) * (cos2E + 1);
-        t_CKFLOAT cos2E_13 = cos2E_12 * (cos2E + 1);
-
-        // compute gains based on the order
-        // 1st order — 4 channels
-        if (m_order >= 1) {
-            m_gain_next[0] = 1.;
-            m_gain_next[1] = sinA * cosE;
-            m_gain_next[2] = sinE;
-            m_gain_next[3] = cosE * cosA;
+    // pick the update period from how fast the source moved since the last update
+    void adapt_period()
+    {
+        t_CKFLOAT da = remainder(m_azimuth - m_last_azimuth, 2 * M_PI);
+        t_CKFLOAT de = m_elevation - m_last_elevation;
+        t_CKFLOAT omega = (fabs(da) + fabs(de)) / (m_samples_since_update < 1 ? 1 : m_samples_since_update);
+
+        // a jump after a long pause keeps the current period
+        if (omega > 0) m_update_period = adaptive_period(omega, m_order, m_max_error, m_interp == ambienc_interp_hermite);
+
+        m_last_azimuth = m_azimuth;
+        m_last_elevation = m_elevation;
+        m_samples_since_update = 0;
+    }
+
+    // set up a cubic Hermite segment from the current gains to the gains at the
+    // new position; the start slope carries over from the previous segment and
+    // the end slope is extrapolated from the last two segments, so gains stay
+    // smooth while pan() is called every update period
+    template<int N_CH>
+    void start_hermite()
+    {
+        position_gains(m_gain_next);
+
+        t_CKFLOAT P = m_update_period;
+        t_CKFLOAT h = m_chord_period;
+        for (int c = 0; c < N_CH; c++) {
+            t_CKFLOAT d  = m_gain_next[c] - m_gain_cur[c];
+            t_CKFLOAT s  = d / P;
+            t_CKFLOAT m1 = m_slope_valid ? m_gain_slope[c] : 0;
+            t_CKFLOAT m2 = m_slope_valid ? s + P * (s - m_gain_chord[c]) / (h + P) : s;
+
+            // g(k) = g1 + m1 k + b k^2 + a k^3 for k = 0..P, as forward differences
+            t_CKFLOAT b = (3 * s - 2 * m1 - m2) / P;
+            t_CKFLOAT a = (m1 + m2 - 2 * s) / (P * P);
+            m_gain_step[c]  = m1 + b + a;
+            m_gain_accel[c] = 2 * b + 6 * a;
+            m_gain_jerk[c]  = 6 * a;
+            m_gain_slope[c] = m2;
+            m_gain_chord[c] = s;
+        }
+        m_chord_period = m_update_period;
+        m_slope_valid = false;
+    }
+
+    // hysteresis: only report silence after SILENCE_HOLD consecutive silent frames
+    bool detect_silence( const SAMPLE * in, int nframes )
+    {
+        return m_silence_detect && hold_silence(in, nframes, nframes, &m_silent_frames);
+    }
+
+    // keep gain state current while silent, without computing gains
+    template<int N_CH>
+    void bypass()
+    {
+        // finish any ramp in progress
+        if (m_samples_left > 0) {
+            for (int c = 0; c < N_CH; c++) {
+                m_gain_cur[c]   = m_gain_next[c];
+                m_gain_step[c]  = 0;
+                m_gain_accel[c] = 0;
+                m_gain_jerk[c]  = 0;
+            }
+            m_samples_left = 0;
+        }
+        m_slope_valid = false;
+
+        // defer new positions until there is something to hear
+        if (m_pan_change) {
+            m_gains_stale = true;
+            m_pan_change = false;
+        }
+    }
+
+    void compute_gains( t_CKFLOAT azimuth, t_CKFLOAT elevation, T * gains )
+    {
+        AMBI_TRACE_SCOPE("gains", "order", m_order);
+        ambi_stats_count(m_stats, m_order, AMBI_STAT_GAIN_UPDATES, 1);
+        m_monitor.reasons |= AMBI_REASON_GAINS;
+        sh_gains(wrap_angle(azimuth), wrap_angle(elevation), m_order, m_coeffs, gains, 1);
+    }
+
+    // gains at the current position, read from the baked file while one plays
+    void position_gains( T * gains )
+    {
+        if (!m_bake_started) {
+            if (m_batch_valid && m_azimuth == m_batch_azimuth && m_elevation == m_batch_elevation) {
+                for (int c = 0; c < m_out_channels; c++) gains[c] = m_gain_batch[c];
+                return;
+            }
+            compute_gains(m_azimuth, m_elevation, gains);
+            return;
+        }
+
+        AMBI_TRACE_SCOPE("baked", "order", m_order);
+        ambi_stats_count(m_stats, m_order, AMBI_STAT_GAIN_UPDATES, 1);
+        m_monitor.reasons |= AMBI_REASON_GAINS;
+        ambi_bake_gains(m_bake, m_bake_time, m_out_channels, gains);
+    }
+
+    // whether baked playback still has updates to make
+    bool baking()
+    {
+        return m_bake && (!m_bake_started || m_bake_time < m_bake->nframes - 1);
+    }
+
+    // one update period along the baked file; until the start of the file is
+    // resident the source waits where it is, and the last update holds
+    void step_baked()
+    {
+        if (!m_bake_started) {
+            if (!ambi_choreo_ready(&m_bake_cursor)) return;
+            m_bake_started = true;
+        } else {
+            m_bake_time = std::min(m_bake_time + m_update_period * m_bake_step, (t_CKFLOAT)(m_bake->nframes - 1));
         }
+        ambi_choreo_report(&m_bake_cursor, (t_CKINT)m_bake_time);
+        ambi_choreo_at(m_bake, m_bake_time, 0, &m_azimuth, &m_elevation);
+    }
 
-        // 2nd order — 9 channels
-        if (m_order >= 2) {
-            m_gain_next[4] = m_coeffs[4] * sinA * cosE2 * cosA;
-            m_gain_next[5] = m_coeffs[5] * 2 * sin2E * sinA;
-            m_gain_next[6] = m_coeffs[6] * sinE2 - 0.5;
-            m_gain_next[7] = m_coeffs[7] * 2 * sin2E * cosA;
-            m_gain_next[8] = m_coeffs[8] * cosE2 * cos2A;
+    // keep the baked clock running through silence; the gains catch up when the
+    // input comes back
+    void skip_baked( int nframes )
+    {
+        if (!m_bake_started) {
+            if (!ambi_choreo_ready(&m_bake_cursor)) return;
+            m_bake_started = true;
+        } else if (m_bake_time >= m_bake->nframes - 1) {
+            return;
+        } else {
+            m_bake_time = std::min(m_bake_time + nframes * m_bake_step, (t_CKFLOAT)(m_bake->nframes - 1));
         }
+        ambi_choreo_report(&m_bake_cursor, (t_CKINT)m_bake_time);
+        ambi_choreo_at(m_bake, m_bake_time, 0, &m_azimuth, &m_elevation);
+        m_gains_stale = true;
+    }
+
+    // instance data
+    AmbiStatsBlock * m_stats;
+    AmbiTickMonitor  m_monitor;
+    t_CKINT   m_order;
+    t_CKINT   m_out_channels;
+    t_CKINT   m_update_period;
+    t_CKINT   m_samples_left;
+    t_CKINT   m_pan_change;
+    t_CKINT   m_bounds_type;
+
+    t_CKINT   m_block_size;
+    t_CKINT   m_block_pos;
+    SAMPLE *  m_block_in;
+    SAMPLE *  m_block_out;
+
+    t_CKINT   m_silence_detect;
+    t_CKINT   m_silent_frames;
+    t_CKINT   m_gains_stale;
+
+    t_CKINT   m_adaptive;
+    t_CKFLOAT m_max_error;
+    t_CKFLOAT m_last_azimuth;
+    t_CKFLOAT m_last_elevation;
+    t_CKINT   m_samples_since_update;
+
+    t_CKINT   m_interp;
+    t_CKINT   m_slope_valid;
+    t_CKINT   m_chord_period;
 
-        // 3rd order — 16 channels
-        if (m_order >= 3) {
-            m_gain_next[9]  = m_coeffs[9]  * (3 - 4 * sinA2) * sinA * cosE3;
-            m_gain_next[10] = m_coeffs[10] * sinE * sinA * cosE2 * cosA;
-            m_gain_next[11] = m_coeffs[11] * (5 * sinE2 - 1) * sinA * cosE;
-            m_gain_next[12] = m_coeffs[12] * (5 * sinE2 - 3) * sinE;
-            m_gain_next[13] = m_coeffs[13] * (5 * sinE2 - 1) * cosE * cosA;
-            m_gain_next[14] = m_coeffs[14] * sinE * cosE2 * cos2A;
-            m_gain_next[15] = m_coeffs[15] * (1 - 4 * sinA2) * cosE3 * cosA;
+    AmbiChoreo * m_bake;
+    AmbiChoreoCursor m_bake_cursor;
+    t_CKFLOAT m_bake_time;      // in updates of the file
+    t_CKFLOAT m_bake_step;      // updates of the file per sample
+    t_CKINT   m_bake_started;
+
+    t_CKINT   m_batch_valid;
+    t_CKFLOAT m_batch_azimuth;
+    t_CKFLOAT m_batch_elevation;
+
+    t_CKFLOAT m_azimuth;
+    t_CKFLOAT m_elevation;
+
+    const float * m_coeffs;
+    T m_gain_next[MAX_CHANNELS];
+    T m_gain_cur[MAX_CHANNELS];
+    T m_gain_step[MAX_CHANNELS];
+    T m_gain_accel[MAX_CHANNELS];
+    T m_gain_jerk[MAX_CHANNELS];
+    T m_gain_slope[MAX_CHANNELS];
+    T m_gain_chord[MAX_CHANNELS];
+    T m_gain_batch[MAX_CHANNELS];
+};
+
+typedef AmbiEncT<ambi_gain_t> AmbiEnc;
+
+// speaker directions of the preset layouts in degrees, anticlockwise from the
+// front, in WAV channel order; the LFE input is not encoded
+struct AmbiEncLayout
+{
+    int inputs;
+    int lfe;
+    t_CKFLOAT azimuth[AMBIENC_MULTI_INPUTS];
+};
+
+static const AmbiEncLayout ambienc_layouts[] = {
+    { 2, -1, { 30, -30 } },                                 // L R
+    { 4, -1, { 45, -45, 135, -135 } },                      // FL FR BL BR
+    { 6,  3, { 30, -30, 0, 0, 110, -110 } },                // L R C LFE Ls Rs
+    { 8,  3, { 30, -30, 0, 0, 150, -150, 90, -90 } },       // L R C LFE Lb Rb Ls Rs
+};
+
+// class definition for a fixed-order encoder of a whole multichannel stem: every
+// input has its own direction, the layout turns and widens as one, and all inputs
+// are summed into a single set of output channels
+template<typename T>
+class AmbiEncMultiT
+{
+public:
+    AmbiEncMultiT( t_CKINT order, t_CKINT update_period, t_CKINT bounds_type )
+    {
+        m_order = order;
+        m_stats = ambi_stats_block();
+        ambi_stats_count(m_stats, m_order, AMBI_STAT_INSTANCES, 1);
+        m_out_channels = (order + 1) * (order + 1);
+        m_bounds_type = bounds_type;
+        m_update_period = (update_period < 1 ? 1 : update_period);
+        m_samples_left = 0;
+        m_azimuth = 0;
+        m_elevation = 0;
+        m_width = 1;
+        m_silence_detect = false;
+        m_silent_frames = 0;
+        m_gains_stale = false;
+
+        for (int i = 0; i < AMBIENC_MULTI_INPUTS * MAX_CHANNELS; i++) {
+            m_gain_cur[i]  = 0;
+            m_gain_next[i] = 0;
+            m_gain_step[i] = 0;
         }
 
-        // 4th order — 25 channels
-        if (m_order >= 4) {
-            m_gain_next[16] = m_coeffs[16] * cos2E_12 * sin4A;
-            m_gain_next[17] = m_coeffs[17] * (3 - 4 * sinA2) * sinE * sinA * cosE3;
-            m_gain_next[18] = m_coeffs[18] * (7 * sinE2 - 1) * sinA * cosE2 * cosA;
-            m_gain_next[19] = m_coeffs[19] * (7 * sinE2 - 3) * sinE * sinA * cosE;
-            m_gain_next[20] = m_coeffs[20] * sinE4 - 3.75 * sinE2 + 0.375;
-            m_gain_next[21] = m_coeffs[21] * (7 * sinE2 - 3) * sinE * cosE * cosA;
-            m_gain_next[22] = m_coeffs[22] * (7 * sinE2 - 1) * cosE2 * cos2A;
-            m_gain_next[23] = m_coeffs[23] * (1 - 4 * sinA2) * sinE * cosE3 * cosA;
-            m_gain_next[24] = m_coeffs[24] * (sinA4 - sinA2 + 0.125) * cosE4;
+        m_coeffs = sh_coeffs();
+        m_inputs = 0;
+        setLayout(ambienc_layout_stereo);
+        compute_gains(m_gain_next);
+        for (int i = 0; i < m_inputs * m_out_channels; i++) m_gain_cur[i] = m_gain_next[i];
+        m_change = false;
+    }
+
+    ~AmbiEncMultiT()
+    {
+        ambi_stats_count(m_stats, m_order, AMBI_STAT_INSTANCES, -1);
+    }
+
+    // setters; every change moves the gains over the next update period
+    t_CKINT setLayout( t_CKINT l )
+    {
+        if (l < ambienc_layout_stereo || l > ambienc_layout_71) return -1;
+
+        const AmbiEncLayout & layout = ambienc_layouts[l];
+        for (int k = 0; k < layout.inputs; k++) {
+            m_dir_azimuth[k] = layout.azimuth[k] * M_PI / 180;
+            m_dir_elevation[k] = 0;
+            m_encoded[k] = k != layout.lfe;
+        }
+        set_inputs(layout.inputs);
+        m_layout = l;
+        return m_layout;
+    }
+
+    // directions of the first n inputs, in the bounds type; returns the inputs in use
+    t_CKINT setDirections( const t_CKFLOAT * azimuth, const t_CKFLOAT * elevation, t_CKINT n )
+    {
+        n = std::min(n, (t_CKINT)AMBIENC_MULTI_INPUTS);
+        if (n < 1) return m_inputs;
+
+        for (int k = 0; k < n; k++) {
+            m_dir_azimuth[k] = scale_angle(azimuth[k]);
+            m_dir_elevation[k] = scale_angle(elevation[k]);
+            m_encoded[k] = true;
+        }
+        set_inputs(n);
+        m_layout = ambienc_layout_custom;
+        return m_inputs;
+    }
+
+    // rotation of the whole layout
+    t_CKFLOAT setAzimuth( t_CKFLOAT a )
+    {
+        a = scale_angle(a);
+        if (a != m_azimuth) { m_azimuth = a; m_change = true; }
+        return m_azimuth;
+    }
+
+    // elevation added to every input
+    t_CKFLOAT setElevation( t_CKFLOAT e )
+    {
+        e = scale_angle(e);
+        if (e != m_elevation) { m_elevation = e; m_change = true; }
+        return m_elevation;
+    }
+
+    t_CKVEC2 pan( t_CKFLOAT a, t_CKFLOAT e )
+    {
+        m_azimuth = scale_angle(a);
+        m_elevation = scale_angle(e);
+        m_change = true;
+        t_CKVEC2 v; v.x = m_azimuth; v.y = m_elevation;
+        return v;
+    }
+
+    // scale of every input azimuth: 1 as laid out, 0 all at the front of the layout
+    t_CKFLOAT setWidth( t_CKFLOAT w )
+    {
+        if (w != m_width) { m_width = w; m_change = true; }
+        return m_width;
+    }
+
+    // a ramp under way lands on its target, so the gains don't stop partway
+    t_CKINT setUpdatePeriod( t_CKINT p )
+    {
+        m_update_period = (p < 1 ? 1 : p);
+        if (m_samples_left > 0)
+            for (int i = 0; i < m_inputs * m_out_channels; i++) m_gain_cur[i] = m_gain_next[i];
+        m_samples_left = 0;
+        return m_update_period;
+    }
+
+    t_CKINT setBoundsType( t_CKINT b )
+    {
+        if (b == ambienc_bounds_normalized || b == ambienc_bounds_radians) {
+            m_bounds_type = b;
+            return b;
+        }
+
+        return -1;
+    }
+
+    t_CKINT setSilenceDetection( t_CKINT d )
+    {
+        m_silence_detect = (d != 0);
+        m_silent_frames = 0;
+        return m_silence_detect;
+    }
+
+    // getters
+    t_CKINT getLayout()       { return m_layout; }
+    t_CKINT getInputs()       { return m_inputs; }
+    t_CKFLOAT getAzimuth()    { return m_azimuth; }
+    t_CKFLOAT getElevation()  { return m_elevation; }
+    t_CKFLOAT getWidth()      { return m_width; }
+    t_CKINT getUpdatePeriod() { return m_update_period; }
+    t_CKINT getBoundsType()   { return m_bounds_type; }
+    t_CKINT getSilenceDetection() { return m_silence_detect; }
+
+    t_CKINT getSilent()
+    {
+        return m_silence_detect && m_silent_frames >= SILENCE_HOLD;
+    }
+
+    // tick template; the inputs are AMBIENC_MULTI_INPUTS samples apart
+    template<int N_CH>
+    void tick( SAMPLE * in, SAMPLE * out, int nframes )
+    {
+        AMBI_TRACE_SCOPE("tick", "frames", nframes);
+        t_CKINT start = ambi_stats_tick_start();
+        process<N_CH>(in, out, nframes);
+        m_monitor.end(m_stats, m_order, this, nframes, start);
+    }
+
+private:
+    template<int N_CH>
+    void process( SAMPLE * in, SAMPLE * out, int nframes )
+    {
+        // all inputs silent: write zeros and pick up any change when they come back
+        if (detect_silence(in, nframes)) {
+            ambi_stats_count(m_stats, m_order, AMBI_STAT_SILENT_BLOCKS, 1);
+            clear_output(out, nframes * N_CH);
+            if (m_samples_left > 0 || m_change) {
+                m_gains_stale = true;
+                m_samples_left = 0;
+                m_change = false;
+            }
+            return;
         }
 
-        // 5th order — 36 channels
-        if (m_order >= 5) {
-            m_gain_next[25] = m_coeffs[25] * (16 * sinA4 - 20 * sinA2 + 5) * sinA * cosE3;
-            m_gain_next[26] = m_coeffs[26] * cos2E_12 * 2 * sinE * sin4A;
-            m_gain_next[27] = m_coeffs[27] * (9 * sinE2 - 1) * (4 * sinA2 - 3) * sinA * cosE3;
-            m_gain_next[28] = m_coeffs[28] * (3 * sinE2 - 1) * sinE * sinA * cosE2 * cosA;
-            m_gain_next[29] = m_coeffs[29] * (21 * sinE4 - 14 * sinE2 + 1) * sinA * cosE;
-            m_gain_next[30] = m_coeffs[30] * (63 * sinE4 - 70 * sinE2 + 15) * sinE;
-            m_gain_next[31] = m_coeffs[31] * (21 * sinE4 - 14 * sinE2 + 1) * cosE * cosA;
-            m_gain_next[32] = m_coeffs[32] * (3 * sinE2 - 1) * sinE * cosE2 * cos2A;
-            m_gain_next[33] = m_coeffs[33] * (9 * sinE2 - 1) * (4 * sinA2 - 1) * cosE3 * cosA;
-            m_gain_next[34] = m_coeffs[34] * (8 * sinA4 - 8 * sinA2 + 1) * sinE * cosE4;
-            m_gain_next[35] = m_coeffs[35] * cos2E_12 * 2 * cosE * cos5A;
+        if (m_gains_stale) {
+            compute_gains(m_gain_cur);
+            m_gains_stale = false;
         }
 
-        // 6th order — 49 channels
-        if (m_order >= 6) {
-            m_gain_next[36] = m_coeffs[36] * (16 * sinA4 - 16 * sinA2 + 3) * sinA * cosE6 * cosA;
-            m_gain_next[37] = m_coeffs[37] * (16 * sinA4 - 20 * sinA2 + 5) * sinE * sinA * cosE3;
-            m_gain_next[38] = m_coeffs[38] * cos2E_12 * sin4A * (18 - 22 * cos2E);
-            m_gain_next[39] = m_coeffs[39] * (11 * sinE2 - 3) * (4 * sinA2 - 3) * sinE * sinA * cosE3;
-            m_gain_next[40] = m_coeffs[40] * (33 * sinE4 - 18 * sinE2 + 1) * sinA * cosE2 * cosA;
-            m_gain_next[41] = m_coeffs[41] * (33 * sinE4 - 30 * sinE2 + 5) * sinE * sinA * cosE;
-            m_gain_next[42] = m_coeffs[42] * sinE6 - 19.6875 * sinE4 + 6.5625 * sinE2 - 0.3125;
-            m_gain_next[43] = m_coeffs[43] * 4.58257569496 * (33 * sinE4 - 30 * sinE2 + 5) * sinE * cosE * cosA;
-            m_gain_next[44] = m_coeffs[44] * (33 * sinE4 - 18 * sinE2 + 1) * cosE2 * cos2A;
-            m_gain_next[45] = m_coeffs[45] * (11 * sinE2 - 3) * (4 * sinA2 - 1) * sinE * cosE3 * cosA;
-            m_gain_next[46] = m_coeffs[46] * (11 * sinE2 - 1) * (8 * sinA4 - 8 * sinA2 + 1) * cosE4;
-            m_gain_next[47] = m_coeffs[47] * 2 * sin2E * cos5A * cos2E_12;
-            m_gain_next[48] = m_coeffs[48] * cos2E_13 * cos6A;
+        int f = 0;
+        while (f < nframes) {
+            if (m_samples_left <= 0 && m_change) {
+                AMBI_TRACE_SCOPE("update", "period", m_update_period);
+                compute_gains(m_gain_next);
+                for (int i = 0; i < m_inputs * N_CH; i++)
+                    m_gain_step[i] = (m_gain_next[i] - m_gain_cur[i]) / m_update_period;
+                m_samples_left = m_update_period;
+                m_change = false;
+            }
+
+            if (m_samples_left <= 0) {
+                AMBI_CALL_KERNEL(encode_multi_const, AMBI_ARGS(<N_CH, AMBIENC_MULTI_INPUTS>),
+                                 (in + f * AMBIENC_MULTI_INPUTS, out + f * N_CH, nframes - f, (int)m_inputs, m_gain_cur));
+                return;
+            }
+
+            int n = nframes - f;
+            if (m_samples_left < n) n = m_samples_left;
+            AMBI_CALL_KERNEL(encode_multi_ramp, AMBI_ARGS(<N_CH, AMBIENC_MULTI_INPUTS>),
+                             (in + f * AMBIENC_MULTI_INPUTS, out + f * N_CH, n, (int)m_inputs, m_gain_cur, m_gain_step));
+            m_samples_left -= n;
+            f += n;
+
+            if (m_samples_left == 0)
+                for (int i = 0; i < m_inputs * N_CH; i++) m_gain_cur[i] = m_gain_next[i];
         }
+    }
 
-        // 7th order — 64 channels
-        if (m_order >= 7) {
-            m_gain_next[49] = m_coeffs[49] * (-57 * sinA6 + 91 * sinA4 - 35 * sinA2 + 7 * cosA6) * sinA * cosE7;
-            m_gain_next[50] = m_coeffs[50] * cos2E_13 * (2 * sinE * sin6A);
-            m_gain_next[51] = m_coeffs[51] * (13 * sinE2 - 1) * (16 * sinA4 - 20 * sinA2 + 5) * sinA * cosE3;
-            m_gain_next[52] = m_coeffs[52] * cos2E_12 * sin4A * (54 * sinE - 26 * sin3E);
-            m_gain_next[53] = m_coeffs[53] * (4 * sinA2 - 3) * (143 * sinE4 - 66 * sinE2 + 3) * sinA * cosE3;
-            m_gain_next[54] = m_coeffs[54] * (143 * sinE4 - 110 * sinE2 + 15) * sinE * sinA * cosE2 * cosA;
-            m_gain_next[55] = m_coeffs[55] * (429 * sinE6 - 495 * sinE4 + 135 * sinE2 - 5) * sinA * cosE;
-            m_gain_next[56] = m_coeffs[56] * (429 * sinE6 - 693 * sinE4 + 315 * sinE2 - 35) * sinE;
-            m_gain_next[57] = m_coeffs[57] * (429 * sinE6 - 495 * sinE4 + 135 * sinE2 - 5) * cosE * cosA;
-            m_gain_next[58] = m_coeffs[58] * (143 * sinE4 - 110 * sinE2 + 15) * sinE * cosE2 * cos2A;
-            m_gain_next[59] = m_coeffs[59] * (4 * sinA2 - 1) * (143 * sinE4 - 66 * sinE2 + 3) * cosE3 * cosA;
-            m_gain_next[60] = m_coeffs[60] * (13 * sinE2 - 3) * (8 * sinA4 - 8 * sinA2 + 1) * sinE * cosE4;
-            m_gain_next[61] = m_coeffs[61] * (13 * sinE2 - 1) * (16 * sinA4 - 12 * sinA2 + 1) * cosE3 * cosA;
-            m_gain_next[62] = m_coeffs[62] * (2 * sinE * cos6A) * cos2E_13;
-            m_gain_next[63] = m_coeffs[63] * (-63 * sinA6 + 77 * sinA4 - 21 * sinA2 + cosA6) * cosE7 * cosA;
+    // inputs added by a layout start silent and fade in over the next update
+    void set_inputs( int n )
+    {
+        for (int i = m_inputs * m_out_channels; i < n * m_out_channels; i++) m_gain_cur[i] = 0;
+        m_inputs = n;
+        m_samples_left = 0;
+        m_change = true;
+    }
+
+    t_CKFLOAT scale_angle( t_CKFLOAT a )
+    {
+        return m_bounds_type == ambienc_bounds_normalized ? scalef(a, -1., 1., -M_PI, M_PI) : a;
+    }
+
+    // gains of every input, one block of output channels per input
+    void compute_gains( T * gains )
+    {
+        AMBI_TRACE_SCOPE("gains", "inputs", m_inputs);
+        ambi_stats_count(m_stats, m_order, AMBI_STAT_GAIN_UPDATES, m_inputs);
+        m_monitor.reasons |= AMBI_REASON_GAINS;
+        for (int k = 0; k < m_inputs; k++) {
+            T * g = gains + k * m_out_channels;
+            if (!m_encoded[k]) {
+                for (int c = 0; c < m_out_channels; c++) g[c] = 0;
+                continue;
+            }
+            sh_gains(wrap_angle(m_azimuth + m_width * m_dir_azimuth[k]), wrap_angle(m_elevation + m_dir_elevation[k]),
+                     m_order, m_coeffs, g, 1);
         }
     }
 
-    // helper functions
-    float scalef( float x, float in_min, float in_max, float out_min, float out_max )
+    // hysteresis as in AmbiEnc, over every input; only while detection is on
+    bool detect_silence( const SAMPLE * in, int nframes )
     {
-        return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+        return m_silence_detect && hold_silence(in, nframes * AMBIENC_MULTI_INPUTS, nframes, &m_silent_frames);
     }
 
     // instance data
+    AmbiStatsBlock * m_stats;
+    AmbiTickMonitor  m_monitor;
     t_CKINT   m_order;
     t_CKINT   m_out_channels;
     t_CKINT   m_update_period;
     t_CKINT   m_samples_left;
-    t_CKINT   m_pan_change;
+    t_CKINT   m_change;
     t_CKINT   m_bounds_type;
+    t_CKINT   m_silence_detect;
+    t_CKINT   m_silent_frames;
+    t_CKINT   m_gains_stale;
+
+    t_CKINT   m_layout;
+    t_CKINT   m_inputs;
+    t_CKFLOAT m_dir_azimuth[AMBIENC_MULTI_INPUTS];
+    t_CKFLOAT m_dir_elevation[AMBIENC_MULTI_INPUTS];
+    bool      m_encoded[AMBIENC_MULTI_INPUTS];
 
     t_CKFLOAT m_azimuth;
     t_CKFLOAT m_elevation;
+    t_CKFLOAT m_width;
 
-    t_CKFLOAT m_coeffs[MAX_CHANNELS];
-    t_CKFLOAT m_gain_next[MAX_CHANNELS];
-    t_CKFLOAT m_gain_cur[MAX_CHANNELS];
-    t_CKFLOAT m_gain_step[MAX_CHANNELS];
+    const float * m_coeffs;
+    T m_gain_cur[AMBIENC_MULTI_INPUTS * MAX_CHANNELS];
+    T m_gain_next[AMBIENC_MULTI_INPUTS * MAX_CHANNELS];
+    T m_gain_step[AMBIENC_MULTI_INPUTS * MAX_CHANNELS];
 };
 
+typedef AmbiEncMultiT<ambi_gain_t> AmbiEncMulti;
+
+// largest difference between the outputs of the float and the double pipeline for
+// a unit input, while the source steps through a grid of directions covering the
+// sphere and interpolates over one update period to each
+template<int N>
+static t_CKFLOAT precision_error( t_CKINT update_period, t_CKINT interp )
+{
+    const int N_CH = (N + 1) * (N + 1);
+    AmbiEncT<float> enc_f(N, update_period, ambienc_bounds_radians);
+    AmbiEncT<double> enc_d(N, update_period, ambienc_bounds_radians);
+    enc_f.setInterp(interp);
+    enc_d.setInterp(interp);
+
+    SAMPLE * in = new SAMPLE[MAX_BLOCK_SIZE];
+    SAMPLE * out_f = new SAMPLE[MAX_BLOCK_SIZE * N_CH];
+    SAMPLE * out_d = new SAMPLE[MAX_BLOCK_SIZE * N_CH];
+    for (int i = 0; i < MAX_BLOCK_SIZE; i++) in[i] = 1;
+
+    t_CKFLOAT max_error = 0;
+    for (int i = 0; i <= 12; i++) {
+        for (int j = 0; j <= 24; j++) {
+            t_CKFLOAT el = (i - 6) * M_PI / 12;
+            t_CKFLOAT az = (j - 12) * M_PI / 12;
+            enc_f.pan(az, el);
+            enc_d.pan(az, el);
+
+            for (t_CKINT left = enc_d.getUpdatePeriod(); left > 0; left -= MAX_BLOCK_SIZE) {
+                int n = left < MAX_BLOCK_SIZE ? (int)left : MAX_BLOCK_SIZE;
+                enc_f.template tick<N_CH>(in, out_f, n);
+                enc_d.template tick<N_CH>(in, out_d, n);
+                for (int k = 0; k < n * N_CH; k++) {
+                    t_CKFLOAT e = fabs(out_f[k] - out_d[k]);
+                    if (e > max_error) max_error = e;
+                }
+            }
+        }
+    }
+
+    delete [] in;
+    delete [] out_f;
+    delete [] out_d;
+    return max_error;
+}
+
+// pan every encoder in encs to the matching entries of azimuth and elevation, as
+// pan() would, with the gains of AMBI_BATCH_SOURCES encoders at a time evaluated
+// in one batch; null entries are skipped. Returns the number of encoders panned
+template<int N>
+static t_CKINT pan_many( Chuck_ArrayInt * encs, Chuck_ArrayFloat * azimuth, Chuck_ArrayFloat * elevation,
+                         t_CKINT off, CK_DL_API API )
+{
+    if (!encs || !azimuth || !elevation) return 0;
+    t_CKINT n = API->object->array_int_size(encs);
+    n = std::min(n, std::min(API->object->array_float_size(azimuth), API->object->array_float_size(elevation)));
+
+    AmbiEnc * obj[AMBI_BATCH_SOURCES];
+    t_CKFLOAT a[AMBI_BATCH_SOURCES], e[AMBI_BATCH_SOURCES];
+    ambi_gain_t * gains[AMBI_BATCH_SOURCES];
+    t_CKINT panned = 0;
+
+    for (t_CKINT i = 0; i < n; ) {
+        int k = 0;
+        for (; i < n && k < AMBI_BATCH_SOURCES; i++) {
+            Chuck_Object * o = (Chuck_Object *)API->object->array_int_get_idx(encs, i);
+            if (!o || !OBJ_MEMBER_INT(o, off)) continue;
+            obj[k] = (AmbiEnc *)OBJ_MEMBER_INT(o, off);
+            t_CKVEC2 p = obj[k]->pan(API->object->array_float_get_idx(azimuth, i), API->object->array_float_get_idx(elevation, i));
+            a[k] = p.x;
+            e[k] = p.y;
+            gains[k] = obj[k]->pan_gains();
+            k++;
+        }
+        if (!k) break;
+
+        sh_gains_batch<N>(k, a, e, gains);
+        ambi_stats_count(ambi_stats_block(), N, AMBI_STAT_GAIN_UPDATES, k);
+        panned += k;
+    }
+    return panned;
+}
+
 
 // functions that are the same for each order
 static void ambienc_setAzimuth( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
@@ -476,46 +1144,353 @@ static void ambienc_getBoundsType( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Re
     RETURN->v_int = obj->getBoundsType();
 }
 
+static void ambienc_setBlockSize( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setBlockSize(GET_NEXT_INT(ARGS));
+}
+
+static void ambienc_getBlockSize( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getBlockSize();
+}
+
+static void ambienc_getLatency( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_dur = obj->getLatency();
+}
+
+static void ambienc_setSilenceDetection( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setSilenceDetection(GET_NEXT_INT(ARGS));
+}
+
+static void ambienc_getSilenceDetection( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getSilenceDetection();
+}
+
+static void ambienc_getSilent( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getSilent();
+}
+
+static void ambienc_setAdaptive( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setAdaptive(GET_NEXT_INT(ARGS));
+}
+
+static void ambienc_getAdaptive( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getAdaptive();
+}
+
+static void ambienc_setMaxError( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->setMaxError(GET_NEXT_FLOAT(ARGS));
+}
+
+static void ambienc_getMaxError( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->getMaxError();
+}
+
+static void ambienc_setInterp( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setInterp(GET_NEXT_INT(ARGS));
+}
+
+static void ambienc_getInterp( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getInterp();
+}
+
+static void ambienc_getOverruns( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getOverruns();
+}
+
+static void ambienc_getWorstTick( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->getWorstTick();
+}
+
+static void ambienc_getInstanceId( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getInstanceId();
+}
+
+static void ambienc_playBaked( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, Chuck_VM * VM, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    const char * file = API->object->str(GET_NEXT_STRING(ARGS));
+    RETURN->v_int = obj->playBaked(file, API->vm->srate(VM));
+}
+
+static void ambienc_stopBaked( Chuck_Object * SELF, t_CKINT off, CK_DL_API API )
+{
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, off);
+    obj->stopBaked();
+}
+
+// multi-input encoder functions that are the same for each order
+static void ambimulti_setLayout( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setLayout(GET_NEXT_INT(ARGS));
+}
+
+static void ambimulti_getLayout( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getLayout();
+}
+
+static void ambimulti_setDirections( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    Chuck_ArrayFloat * az = (Chuck_ArrayFloat *)GET_NEXT_OBJECT(ARGS);
+    Chuck_ArrayFloat * el = (Chuck_ArrayFloat *)GET_NEXT_OBJECT(ARGS);
+    if (!az || !el) {
+        RETURN->v_int = obj->getInputs();
+        return;
+    }
+
+    t_CKFLOAT a[AMBIENC_MULTI_INPUTS], e[AMBIENC_MULTI_INPUTS];
+    t_CKINT n = std::min(API->object->array_float_size(az), API->object->array_float_size(el));
+    n = std::min(n, (t_CKINT)AMBIENC_MULTI_INPUTS);
+    for (t_CKINT k = 0; k < n; k++) {
+        a[k] = API->object->array_float_get_idx(az, k);
+        e[k] = API->object->array_float_get_idx(el, k);
+    }
+    RETURN->v_int = obj->setDirections(a, e, n);
+}
+
+static void ambimulti_getInputs( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getInputs();
+}
+
+static void ambimulti_setAzimuth( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->setAzimuth(GET_NEXT_FLOAT(ARGS));
+}
+
+static void ambimulti_getAzimuth( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->getAzimuth();
+}
+
+static void ambimulti_setElevation( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->setElevation(GET_NEXT_FLOAT(ARGS));
+}
+
+static void ambimulti_getElevation( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->getElevation();
+}
+
+static void ambimulti_pan( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    t_CKFLOAT a = GET_NEXT_FLOAT(ARGS);
+    t_CKFLOAT e = GET_NEXT_FLOAT(ARGS);
+    RETURN->v_vec2 = obj->pan(a, e);
+}
+
+static void ambimulti_setWidth( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->setWidth(GET_NEXT_FLOAT(ARGS));
+}
+
+static void ambimulti_getWidth( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_float = obj->getWidth();
+}
+
+static void ambimulti_setUpdatePeriod( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setUpdatePeriod(GET_NEXT_INT(ARGS));
+}
+
+static void ambimulti_getUpdatePeriod( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getUpdatePeriod();
+}
+
+static void ambimulti_setBoundsType( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setBoundsType(GET_NEXT_INT(ARGS));
+}
+
+static void ambimulti_getBoundsType( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getBoundsType();
+}
+
+static void ambimulti_setSilenceDetection( Chuck_Object * SELF, t_CKINT off, void * ARGS, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->setSilenceDetection(GET_NEXT_INT(ARGS));
+}
+
+static void ambimulti_getSilenceDetection( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getSilenceDetection();
+}
+
+static void ambimulti_getSilent( Chuck_Object * SELF, t_CKINT off, Chuck_DL_Return * RETURN, CK_DL_API API )
+{
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, off);
+    RETURN->v_int = obj->getSilent();
+}
+
+// shared by every order
+CK_DLL_SFUN(ambienc_isa)
+{
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ambi_isa_name(), FALSE);
+}
+
+CK_DLL_SFUN(ambienc_statsTiming)
+{
+    ambi_stats_timing = GET_NEXT_INT(ARGS) != 0;
+    RETURN->v_int = ambi_stats_timing;
+}
+
+CK_DLL_SFUN(ambienc_traceStart)
+{
+    const char * file = API->object->str(GET_NEXT_STRING(ARGS));
+    RETURN->v_int = ambi_trace_start(file, AMBIENC_TRACE_PID, "AmbiEnc");
+}
+
+CK_DLL_SFUN(ambienc_traceStop)
+{
+    RETURN->v_int = ambi_trace_stop();
+}
+
+CK_DLL_SFUN(ambienc_deadlineMonitor)
+{
+    ambi_deadline_monitor(GET_NEXT_INT(ARGS) != 0);
+    RETURN->v_int = ambi_deadline_on;
+}
+
+CK_DLL_SFUN(ambienc_deadlineBudget)
+{
+    ambi_deadline_budget(GET_NEXT_FLOAT(ARGS));
+    RETURN->v_float = ambi_deadline_us;
+}
+
+CK_DLL_SFUN(ambienc_deadlineDump)
+{
+    const char * file = API->object->str(GET_NEXT_STRING(ARGS));
+    RETURN->v_int = ambi_deadline_dump(file, "AmbiEnc");
+}
+
 
 
 // constructors and functions that differ per order
-#define DEFINE_ORDER_CALLBACKS(N)                                                                                          \
-CK_DLL_CTOR(ambienc##N##_ctor) {                                                                                           \
-    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = 0;                                                                    \
-    AmbiEnc * obj = new AmbiEnc(N, 64, ambienc_bounds_normalized);                                                         \
-    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = (t_CKINT)obj;                                                         \
-}                                                                                                                          \
-CK_DLL_CTOR(ambienc##N##_ctor_period) {                                                                                    \
-    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = 0;                                                                    \
-    t_CKINT p = GET_NEXT_INT(ARGS);                                                                                        \
-    AmbiEnc * obj = new AmbiEnc(N, p, ambienc_bounds_normalized);                                                          \
-    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = (t_CKINT)obj;                                                         \
-}                                                                                                                          \
-CK_DLL_CTOR(ambienc##N##_ctor_periodAndBounds) {                                                                           \
-    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = 0;                                                                    \
-    t_CKINT p = GET_NEXT_INT(ARGS); t_CKINT b = GET_NEXT_INT(ARGS);                                                        \
-    AmbiEnc * obj = new AmbiEnc(N, p, b);                                                                                  \
-    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = (t_CKINT)obj;                                                         \
-}                                                                                                                          \
-CK_DLL_DTOR(ambienc##N##_dtor) {                                                                                           \
-    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset);                                             \
-    CK_SAFE_DELETE(obj);                                                                                                   \
-    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = 0;                                                                    \
-}                                                                                                                          \
-CK_DLL_TICKF(ambienc##N##_tickf) {                                                                                         \
-    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset);                                             \
-    if (obj) obj->tick<(N+1)*(N+1)>(in, out, nframes);                                                                     \
-    return TRUE;                                                                                                           \
-}                                                                                                                          \
-CK_DLL_MFUN(ambienc##N##_setAzimuth)    { ambienc_setAzimuth(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }         \
-CK_DLL_MFUN(ambienc##N##_getAzimuth)    { ambienc_getAzimuth(SELF, ambienc##N##_data_offset, RETURN, API); }               \
-CK_DLL_MFUN(ambienc##N##_setElevation)  { ambienc_setElevation(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }       \
-CK_DLL_MFUN(ambienc##N##_getElevation)  { ambienc_getElevation(SELF, ambienc##N##_data_offset, RETURN, API); }             \
-CK_DLL_MFUN(ambienc##N##_pan)           { ambienc_pan(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }                \
-CK_DLL_MFUN(ambienc##N##_setUpdatePeriod) { ambienc_setUpdatePeriod(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }  \
-CK_DLL_MFUN(ambienc##N##_getUpdatePeriod) { ambienc_getUpdatePeriod(SELF, ambienc##N##_data_offset, RETURN, API); }        \
-CK_DLL_MFUN(ambienc##N##_setBoundsType) { ambienc_setBoundsType(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }      \
-CK_DLL_MFUN(ambienc##N##_getBoundsType) { ambienc_getBoundsType(SELF, ambienc##N##_data_offset, RETURN, API); }
+#define DEFINE_ORDER_CALLBACKS(N)                                                                                                 \
+CK_DLL_CTOR(ambienc##N##_ctor) {                                                                                                  \
+    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = 0;                                                                           \
+    AmbiEnc * obj = new AmbiEnc(N, 64, ambienc_bounds_normalized);                                                                \
+    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = (t_CKINT)obj;                                                                \
+}                                                                                                                                 \
+CK_DLL_CTOR(ambienc##N##_ctor_period) {                                                                                           \
+    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = 0;                                                                           \
+    t_CKINT p = GET_NEXT_INT(ARGS);                                                                                               \
+    AmbiEnc * obj = new AmbiEnc(N, p, ambienc_bounds_normalized);                                                                 \
+    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = (t_CKINT)obj;                                                                \
+}                                                                                                                                 \
+CK_DLL_CTOR(ambienc##N##_ctor_periodAndBounds) {                                                                                  \
+    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = 0;                                                                           \
+    t_CKINT p = GET_NEXT_INT(ARGS); t_CKINT b = GET_NEXT_INT(ARGS);                                                               \
+    AmbiEnc * obj = new AmbiEnc(N, p, b);                                                                                         \
+    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = (t_CKINT)obj;                                                                \
+}                                                                                                                                 \
+CK_DLL_DTOR(ambienc##N##_dtor) {                                                                                                  \
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset);                                                    \
+    CK_SAFE_DELETE(obj);                                                                                                          \
+    OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset) = 0;                                                                           \
+}                                                                                                                                 \
+CK_DLL_TICKF(ambienc##N##_tickf) {                                                                                                \
+    AmbiEnc * obj = (AmbiEnc *)OBJ_MEMBER_INT(SELF, ambienc##N##_data_offset);                                                    \
+    if (obj) obj->tick<(N+1)*(N+1)>(in, out, nframes);                                                                            \
+    return TRUE;                                                                                                                  \
+}                                                                                                                                 \
+CK_DLL_MFUN(ambienc##N##_setAzimuth)    { ambienc_setAzimuth(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }                \
+CK_DLL_MFUN(ambienc##N##_getAzimuth)    { ambienc_getAzimuth(SELF, ambienc##N##_data_offset, RETURN, API); }                      \
+CK_DLL_MFUN(ambienc##N##_setElevation)  { ambienc_setElevation(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }              \
+CK_DLL_MFUN(ambienc##N##_getElevation)  { ambienc_getElevation(SELF, ambienc##N##_data_offset, RETURN, API); }                    \
+CK_DLL_MFUN(ambienc##N##_pan)           { ambienc_pan(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }                       \
+CK_DLL_MFUN(ambienc##N##_setUpdatePeriod) { ambienc_setUpdatePeriod(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }         \
+CK_DLL_MFUN(ambienc##N##_getUpdatePeriod) { ambienc_getUpdatePeriod(SELF, ambienc##N##_data_offset, RETURN, API); }               \
+CK_DLL_MFUN(ambienc##N##_setBoundsType) { ambienc_setBoundsType(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }             \
+CK_DLL_MFUN(ambienc##N##_getBoundsType) { ambienc_getBoundsType(SELF, ambienc##N##_data_offset, RETURN, API); }                   \
+CK_DLL_MFUN(ambienc##N##_setBlockSize)  { ambienc_setBlockSize(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }              \
+CK_DLL_MFUN(ambienc##N##_getBlockSize)  { ambienc_getBlockSize(SELF, ambienc##N##_data_offset, RETURN, API); }                    \
+CK_DLL_MFUN(ambienc##N##_getLatency)    { ambienc_getLatency(SELF, ambienc##N##_data_offset, RETURN, API); }                      \
+CK_DLL_MFUN(ambienc##N##_setSilenceDetection) { ambienc_setSilenceDetection(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); } \
+CK_DLL_MFUN(ambienc##N##_getSilenceDetection) { ambienc_getSilenceDetection(SELF, ambienc##N##_data_offset, RETURN, API); }       \
+CK_DLL_MFUN(ambienc##N##_getSilent)     { ambienc_getSilent(SELF, ambienc##N##_data_offset, RETURN, API); }                       \
+CK_DLL_MFUN(ambienc##N##_setAdaptive)   { ambienc_setAdaptive(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }               \
+CK_DLL_MFUN(ambienc##N##_getAdaptive)   { ambienc_getAdaptive(SELF, ambienc##N##_data_offset, RETURN, API); }                     \
+CK_DLL_MFUN(ambienc##N##_setMaxError)   { ambienc_setMaxError(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }               \
+CK_DLL_MFUN(ambienc##N##_getMaxError)   { ambienc_getMaxError(SELF, ambienc##N##_data_offset, RETURN, API); }                     \
+CK_DLL_MFUN(ambienc##N##_setInterp)     { ambienc_setInterp(SELF, ambienc##N##_data_offset, ARGS, RETURN, API); }                 \
+CK_DLL_MFUN(ambienc##N##_getInterp)     { ambienc_getInterp(SELF, ambienc##N##_data_offset, RETURN, API); }                       \
+CK_DLL_MFUN(ambienc##N##_getOverruns)   { ambienc_getOverruns(SELF, ambienc##N##_data_offset, RETURN, API); }                     \
+CK_DLL_MFUN(ambienc##N##_getWorstTick)  { ambienc_getWorstTick(SELF, ambienc##N##_data_offset, RETURN, API); }                    \
+CK_DLL_MFUN(ambienc##N##_getInstanceId) { ambienc_getInstanceId(SELF, ambienc##N##_data_offset, RETURN, API); }                   \
+CK_DLL_MFUN(ambienc##N##_playBaked)     { ambienc_playBaked(SELF, ambienc##N##_data_offset, ARGS, RETURN, VM, API); }             \
+CK_DLL_MFUN(ambienc##N##_stopBaked)     { ambienc_stopBaked(SELF, ambienc##N##_data_offset, API); }                               \
+CK_DLL_SFUN(ambienc##N##_precisionError) {                                                                                        \
+    t_CKINT p = GET_NEXT_INT(ARGS);                                                                                               \
+    t_CKINT i = GET_NEXT_INT(ARGS);                                                                                               \
+    RETURN->v_float = precision_error<N>(p, i);                                                                                   \
+}                                                                                                                                 \
+CK_DLL_SFUN(ambienc##N##_instances)        { RETURN->v_int = ambi_stats_read(N, AMBI_STAT_INSTANCES); }                           \
+CK_DLL_SFUN(ambienc##N##_samplesProcessed) { RETURN->v_int = ambi_stats_read(N, AMBI_STAT_SAMPLES); }                             \
+CK_DLL_SFUN(ambienc##N##_gainUpdates)      { RETURN->v_int = ambi_stats_read(N, AMBI_STAT_GAIN_UPDATES); }                        \
+CK_DLL_SFUN(ambienc##N##_silentBlocks)     { RETURN->v_int = ambi_stats_read(N, AMBI_STAT_SILENT_BLOCKS); }                       \
+CK_DLL_SFUN(ambienc##N##_tickTime)         { RETURN->v_float = ambi_stats_tick_ns(N); }                                           \
+CK_DLL_SFUN(ambienc##N##_resetStats)       { ambi_stats_reset(N); }                                                               \
+CK_DLL_SFUN(ambienc##N##_tickP50)          { RETURN->v_float = ambi_deadline_quantile_ns(N, 0.5); }                               \
+CK_DLL_SFUN(ambienc##N##_tickP99)          { RETURN->v_float = ambi_deadline_quantile_ns(N, 0.99); }                              \
+CK_DLL_SFUN(ambienc##N##_tickMax)          { RETURN->v_float = ambi_deadline_max_ns(N); }                                         \
+CK_DLL_SFUN(ambienc##N##_tickOverruns)     { RETURN->v_int = ambi_stats_read(N, AMBI_STAT_OVERRUNS); }                            \
+CK_DLL_SFUN(ambienc##N##_panMany) {                                                                                               \
+    Chuck_ArrayInt * encs = (Chuck_ArrayInt *)GET_NEXT_OBJECT(ARGS);                                                              \
+    Chuck_ArrayFloat * a = (Chuck_ArrayFloat *)GET_NEXT_OBJECT(ARGS);                                                             \
+    Chuck_ArrayFloat * e = (Chuck_ArrayFloat *)GET_NEXT_OBJECT(ARGS);                                                             \
+    RETURN->v_int = pan_many<N>(encs, a, e, ambienc##N##_data_offset, API);                                                       \
+}
 
 DEFINE_ORDER_CALLBACKS(1)
 DEFINE_ORDER_CALLBACKS(2)
@@ -525,6 +1500,65 @@ DEFINE_ORDER_CALLBACKS(5)
 DEFINE_ORDER_CALLBACKS(6)
 DEFINE_ORDER_CALLBACKS(7)
 
+#define DEFINE_MULTI_CALLBACKS(N)                                                                                                 \
+static void ambimulti##N##_create( Chuck_Object * SELF, t_CKINT layout, t_CKINT p, t_CKINT b, CK_DL_API API ) {                   \
+    OBJ_MEMBER_INT(SELF, ambimulti##N##_data_offset) = 0;                                                                         \
+    AmbiEncMulti * obj = new AmbiEncMulti(N, p, b);                                                                               \
+    obj->setLayout(layout);                                                                                                       \
+    OBJ_MEMBER_INT(SELF, ambimulti##N##_data_offset) = (t_CKINT)obj;                                                              \
+}                                                                                                                                 \
+CK_DLL_CTOR(ambimulti##N##_ctor) {                                                                                                \
+    ambimulti##N##_create(SELF, ambienc_layout_stereo, 64, ambienc_bounds_normalized, API);                                       \
+}                                                                                                                                 \
+CK_DLL_CTOR(ambimulti##N##_ctor_layout) {                                                                                         \
+    t_CKINT l = GET_NEXT_INT(ARGS);                                                                                               \
+    ambimulti##N##_create(SELF, l, 64, ambienc_bounds_normalized, API);                                                           \
+}                                                                                                                                 \
+CK_DLL_CTOR(ambimulti##N##_ctor_layoutAndPeriod) {                                                                                \
+    t_CKINT l = GET_NEXT_INT(ARGS); t_CKINT p = GET_NEXT_INT(ARGS);                                                               \
+    ambimulti##N##_create(SELF, l, p, ambienc_bounds_normalized, API);                                                            \
+}                                                                                                                                 \
+CK_DLL_CTOR(ambimulti##N##_ctor_layoutPeriodAndBounds) {                                                                          \
+    t_CKINT l = GET_NEXT_INT(ARGS); t_CKINT p = GET_NEXT_INT(ARGS); t_CKINT b = GET_NEXT_INT(ARGS);                               \
+    ambimulti##N##_create(SELF, l, p, b, API);                                                                                    \
+}                                                                                                                                 \
+CK_DLL_DTOR(ambimulti##N##_dtor) {                                                                                                \
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, ambimulti##N##_data_offset);                                        \
+    CK_SAFE_DELETE(obj);                                                                                                          \
+    OBJ_MEMBER_INT(SELF, ambimulti##N##_data_offset) = 0;                                                                         \
+}                                                                                                                                 \
+CK_DLL_TICKF(ambimulti##N##_tickf) {                                                                                              \
+    AmbiEncMulti * obj = (AmbiEncMulti *)OBJ_MEMBER_INT(SELF, ambimulti##N##_data_offset);                                        \
+    if (obj) obj->tick<(N+1)*(N+1)>(in, out, nframes);                                                                            \
+    return TRUE;                                                                                                                  \
+}                                                                                                                                 \
+CK_DLL_MFUN(ambimulti##N##_setLayout)     { ambimulti_setLayout(SELF, ambimulti##N##_data_offset, ARGS, RETURN, API); }           \
+CK_DLL_MFUN(ambimulti##N##_getLayout)     { ambimulti_getLayout(SELF, ambimulti##N##_data_offset, RETURN, API); }                 \
+CK_DLL_MFUN(ambimulti##N##_setDirections) { ambimulti_setDirections(SELF, ambimulti##N##_data_offset, ARGS, RETURN, API); }       \
+CK_DLL_MFUN(ambimulti##N##_getInputs)     { ambimulti_getInputs(SELF, ambimulti##N##_data_offset, RETURN, API); }                 \
+CK_DLL_MFUN(ambimulti##N##_setAzimuth)    { ambimulti_setAzimuth(SELF, ambimulti##N##_data_offset, ARGS, RETURN, API); }          \
+CK_DLL_MFUN(ambimulti##N##_getAzimuth)    { ambimulti_getAzimuth(SELF, ambimulti##N##_data_offset, RETURN, API); }                \
+CK_DLL_MFUN(ambimulti##N##_setElevation)  { ambimulti_setElevation(SELF, ambimulti##N##_data_offset, ARGS, RETURN, API); }        \
+CK_DLL_MFUN(ambimulti##N##_getElevation)  { ambimulti_getElevation(SELF, ambimulti##N##_data_offset, RETURN, API); }              \
+CK_DLL_MFUN(ambimulti##N##_pan)           { ambimulti_pan(SELF, ambimulti##N##_data_offset, ARGS, RETURN, API); }                 \
+CK_DLL_MFUN(ambimulti##N##_setWidth)      { ambimulti_setWidth(SELF, ambimulti##N##_data_offset, ARGS, RETURN, API); }            \
+CK_DLL_MFUN(ambimulti##N##_getWidth)      { ambimulti_getWidth(SELF, ambimulti##N##_data_offset, RETURN, API); }                  \
+CK_DLL_MFUN(ambimulti##N##_setUpdatePeriod) { ambimulti_setUpdatePeriod(SELF, ambimulti##N##_data_offset, ARGS, RETURN, API); }   \
+CK_DLL_MFUN(ambimulti##N##_getUpdatePeriod) { ambimulti_getUpdatePeriod(SELF, ambimulti##N##_data_offset, RETURN, API); }         \
+CK_DLL_MFUN(ambimulti##N##_setBoundsType) { ambimulti_setBoundsType(SELF, ambimulti##N##_data_offset, ARGS, RETURN, API); }       \
+CK_DLL_MFUN(ambimulti##N##_getBoundsType) { ambimulti_getBoundsType(SELF, ambimulti##N##_data_offset, RETURN, API); }             \
+CK_DLL_MFUN(ambimulti##N##_setSilenceDetection) { ambimulti_setSilenceDetection(SELF, ambimulti##N##_data_offset, ARGS, RETURN, API); } \
+CK_DLL_MFUN(ambimulti##N##_getSilenceDetection) { ambimulti_getSilenceDetection(SELF, ambimulti##N##_data_offset, RETURN, API); }       \
+CK_DLL_MFUN(ambimulti##N##_getSilent)     { ambimulti_getSilent(SELF, ambimulti##N##_data_offset, RETURN, API); }
+
+DEFINE_MULTI_CALLBACKS(1)
+DEFINE_MULTI_CALLBACKS(2)
+DEFINE_MULTI_CALLBACKS(3)
+DEFINE_MULTI_CALLBACKS(4)
+DEFINE_MULTI_CALLBACKS(5)
+DEFINE_MULTI_CALLBACKS(6)
+DEFINE_MULTI_CALLBACKS(7)
+
 
 // register every class / constructor / function per order
 CK_DLL_INFO( AmbiEnc )
@@ -562,15 +1596,124 @@ do {
     QUERY->add_mfun(QUERY, ambienc##N##_setBoundsType, "int", "boundsType");                          \
         QUERY->add_arg(QUERY, "int", "b");                                                            \
     QUERY->add_mfun(QUERY, ambienc##N##_getBoundsType, "int", "boundsType");                          \
+    QUERY->add_mfun(QUERY, ambienc##N##_setBlockSize, "int", "blockSize");                            \
+        QUERY->add_arg(QUERY, "int", "b");                                                            \
+    QUERY->add_mfun(QUERY, ambienc##N##_getBlockSize, "int", "blockSize");                            \
+    QUERY->add_mfun(QUERY, ambienc##N##_getLatency, "dur", "latency");                                \
+    QUERY->add_mfun(QUERY, ambienc##N##_setSilenceDetection, "int", "silenceDetection");              \
+        QUERY->add_arg(QUERY, "int", "d");                                                            \
+    QUERY->add_mfun(QUERY, ambienc##N##_getSilenceDetection, "int", "silenceDetection");              \
+    QUERY->add_mfun(QUERY, ambienc##N##_getSilent, "int", "silent");                                  \
+    QUERY->add_mfun(QUERY, ambienc##N##_setAdaptive, "int", "adaptive");                              \
+        QUERY->add_arg(QUERY, "int", "a");                                                            \
+    QUERY->add_mfun(QUERY, ambienc##N##_getAdaptive, "int", "adaptive");                              \
+    QUERY->add_mfun(QUERY, ambienc##N##_setMaxError, "float", "maxError");                            \
+        QUERY->add_arg(QUERY, "float", "e");                                                          \
+    QUERY->add_mfun(QUERY, ambienc##N##_getMaxError, "float", "maxError");                            \
+    QUERY->add_mfun(QUERY, ambienc##N##_setInterp, "int", "interp");                                  \
+        QUERY->add_arg(QUERY, "int", "i");                                                            \
+    QUERY->add_mfun(QUERY, ambienc##N##_getInterp, "int", "interp");                                  \
+    QUERY->add_mfun(QUERY, ambienc##N##_getOverruns, "int", "overruns");                              \
+    QUERY->add_mfun(QUERY, ambienc##N##_getWorstTick, "float", "worstTick");                          \
+    QUERY->add_mfun(QUERY, ambienc##N##_getInstanceId, "int", "instanceId");                          \
+    QUERY->add_mfun(QUERY, ambienc##N##_playBaked, "int", "playBaked");                               \
+        QUERY->add_arg(QUERY, "string", "baked");                                                     \
+    QUERY->add_mfun(QUERY, ambienc##N##_stopBaked, "void", "stopBaked");                              \
+    QUERY->add_sfun(QUERY, ambienc##N##_panMany, "int", "panMany");                                   \
+        QUERY->add_arg(QUERY, "AmbiEnc" #N "[]", "encs");                                             \
+        QUERY->add_arg(QUERY, "float[]", "a"); QUERY->add_arg(QUERY, "float[]", "e");                 \
+    QUERY->add_sfun(QUERY, ambienc_isa, "string", "isa");                                             \
+    QUERY->add_sfun(QUERY, ambienc##N##_precisionError, "float", "precisionError");                   \
+        QUERY->add_arg(QUERY, "int", "updatePeriod"); QUERY->add_arg(QUERY, "int", "interp");         \
+    QUERY->add_sfun(QUERY, ambienc##N##_instances, "int", "instances");                               \
+    QUERY->add_sfun(QUERY, ambienc##N##_samplesProcessed, "int", "samplesProcessed");                 \
+    QUERY->add_sfun(QUERY, ambienc##N##_gainUpdates, "int", "gainUpdates");                           \
+    QUERY->add_sfun(QUERY, ambienc##N##_silentBlocks, "int", "silentBlocks");                         \
+    QUERY->add_sfun(QUERY, ambienc##N##_tickTime, "float", "tickTime");                               \
+    QUERY->add_sfun(QUERY, ambienc##N##_resetStats, "void", "resetStats");                            \
+    QUERY->add_sfun(QUERY, ambienc_statsTiming, "int", "statsTiming");                                \
+        QUERY->add_arg(QUERY, "int", "timing");                                                       \
+    QUERY->add_sfun(QUERY, ambienc_traceStart, "int", "traceStart");                                  \
+        QUERY->add_arg(QUERY, "string", "file");                                                      \
+    QUERY->add_sfun(QUERY, ambienc_traceStop, "int", "traceStop");                                    \
+    QUERY->add_sfun(QUERY, ambienc_deadlineMonitor, "int", "deadlineMonitor");                        \
+        QUERY->add_arg(QUERY, "int", "monitor");                                                      \
+    QUERY->add_sfun(QUERY, ambienc_deadlineBudget, "float", "deadlineBudget");                        \
+        QUERY->add_arg(QUERY, "float", "us");                                                         \
+    QUERY->add_sfun(QUERY, ambienc##N##_tickP50, "float", "tickP50");                                 \
+    QUERY->add_sfun(QUERY, ambienc##N##_tickP99, "float", "tickP99");                                 \
+    QUERY->add_sfun(QUERY, ambienc##N##_tickMax, "float", "tickMax");                                 \
+    QUERY->add_sfun(QUERY, ambienc##N##_tickOverruns, "int", "tickOverruns");                         \
+    QUERY->add_sfun(QUERY, ambienc_deadlineDump, "int", "deadlineDump");                              \
+        QUERY->add_arg(QUERY, "string", "file");                                                      \
     QUERY->add_svar(QUERY, "int", "NORMALIZED", true, (void *)&ambienc_bounds_normalized);            \
     QUERY->add_svar(QUERY, "int", "RADIANS",    true, (void *)&ambienc_bounds_radians);               \
+    QUERY->add_svar(QUERY, "int", "LINEAR",     true, (void *)&ambienc_interp_linear);                \
+    QUERY->add_svar(QUERY, "int", "HERMITE",    true, (void *)&ambienc_interp_hermite);               \
     ambienc##N##_data_offset = QUERY->add_mvar(QUERY, "int", "@ae" #N "_data", false);                \
     QUERY->end_class(QUERY);                                                                          \
 } while(0)
 
+#define REGISTER_MULTI_CLASS(N, N_CH)                                                                 \
+do {                                                                                                  \
+    QUERY->begin_class(QUERY, "AmbiEncMulti" #N, "UGen");                                             \
+    QUERY->doc_class(QUERY, "Order-" #N " encoder of a multichannel stem: up to 8 inputs, each with " \
+                            "its own direction, summed into " #N_CH " output channels, ACN/SN3D.");   \
+    QUERY->add_ctor(QUERY, ambimulti##N##_ctor);                                                      \
+    QUERY->add_ctor(QUERY, ambimulti##N##_ctor_layout);                                               \
+        QUERY->add_arg(QUERY, "int", "layout");                                                       \
+    QUERY->add_ctor(QUERY, ambimulti##N##_ctor_layoutAndPeriod);                                      \
+        QUERY->add_arg(QUERY, "int", "layout");                                                       \
+        QUERY->add_arg(QUERY, "int", "updatePeriod");                                                 \
+    QUERY->add_ctor(QUERY, ambimulti##N##_ctor_layoutPeriodAndBounds);                                \
+        QUERY->add_arg(QUERY, "int", "layout");                                                       \
+        QUERY->add_arg(QUERY, "int", "updatePeriod");                                                 \
+        QUERY->add_arg(QUERY, "int", "boundsType");                                                   \
+    QUERY->add_dtor(QUERY, ambimulti##N##_dtor);                                                      \
+    QUERY->add_ugen_funcf(QUERY, ambimulti##N##_tickf, NULL, AMBIENC_MULTI_INPUTS, N_CH);             \
+    QUERY->add_mfun(QUERY, ambimulti##N##_setLayout, "int", "layout");                                \
+        QUERY->add_arg(QUERY, "int", "l");                                                            \
+    QUERY->add_mfun(QUERY, ambimulti##N##_getLayout, "int", "layout");                                \
+    QUERY->add_mfun(QUERY, ambimulti##N##_setDirections, "int", "directions");                        \
+        QUERY->add_arg(QUERY, "float[]", "a"); QUERY->add_arg(QUERY, "float[]", "e");                 \
+    QUERY->add_mfun(QUERY, ambimulti##N##_getInputs, "int", "inputs");                                \
+    QUERY->add_mfun(QUERY, ambimulti##N##_setAzimuth, "float", "azimuth");                            \
+        QUERY->add_arg(QUERY, "float", "a");                                                          \
+    QUERY->add_mfun(QUERY, ambimulti##N##_getAzimuth, "float", "azimuth");                            \
+    QUERY->add_mfun(QUERY, ambimulti##N##_setElevation, "float", "elevation");                        \
+        QUERY->add_arg(QUERY, "float", "e");                                                          \
+    QUERY->add_mfun(QUERY, ambimulti##N##_getElevation, "float", "elevation");                        \
+    QUERY->add_mfun(QUERY, ambimulti##N##_pan, "vec2", "pan");                                        \
+        QUERY->add_arg(QUERY, "float", "a"); QUERY->add_arg(QUERY, "float", "e");                     \
+    QUERY->add_mfun(QUERY, ambimulti##N##_setWidth, "float", "width");                                \
+        QUERY->add_arg(QUERY, "float", "w");                                                          \
+    QUERY->add_mfun(QUERY, ambimulti##N##_getWidth, "float", "width");                                \
+    QUERY->add_mfun(QUERY, ambimulti##N##_setUpdatePeriod, "int", "updatePeriod");                    \
+        QUERY->add_arg(QUERY, "int", "p");                                                            \
+    QUERY->add_mfun(QUERY, ambimulti##N##_getUpdatePeriod, "int", "updatePeriod");                    \
+    QUERY->add_mfun(QUERY, ambimulti##N##_setBoundsType, "int", "boundsType");                        \
+        QUERY->add_arg(QUERY, "int", "b");                                                            \
+    QUERY->add_mfun(QUERY, ambimulti##N##_getBoundsType, "int", "boundsType");                        \
+    QUERY->add_mfun(QUERY, ambimulti##N##_setSilenceDetection, "int", "silenceDetection");            \
+        QUERY->add_arg(QUERY, "int", "d");                                                            \
+    QUERY->add_mfun(QUERY, ambimulti##N##_getSilenceDetection, "int", "silenceDetection");            \
+    QUERY->add_mfun(QUERY, ambimulti##N##_getSilent, "int", "silent");                                \
+    QUERY->add_sfun(QUERY, ambienc_isa, "string", "isa");                                             \
+    QUERY->add_svar(QUERY, "int", "NORMALIZED",  true, (void *)&ambienc_bounds_normalized);           \
+    QUERY->add_svar(QUERY, "int", "RADIANS",     true, (void *)&ambienc_bounds_radians);              \
+    QUERY->add_svar(QUERY, "int", "STEREO",      true, (void *)&ambienc_layout_stereo);               \
+    QUERY->add_svar(QUERY, "int", "QUAD",        true, (void *)&ambienc_layout_quad);                 \
+    QUERY->add_svar(QUERY, "int", "SURROUND_51", true, (void *)&ambienc_layout_51);                   \
+    QUERY->add_svar(QUERY, "int", "SURROUND_71", true, (void *)&ambienc_layout_71);                   \
+    QUERY->add_svar(QUERY, "int", "CUSTOM",      true, (void *)&ambienc_layout_custom);               \
+    ambimulti##N##_data_offset = QUERY->add_mvar(QUERY, "int", "@aem" #N "_data", false);             \
+    QUERY->end_class(QUERY);                                                                          \
+} while(0)
+
 CK_DLL_QUERY( AmbiEnc )
 {
     QUERY->setname(QUERY, "AmbiEnc");
+    ambi_stats_init();
     REGISTER_ORDER_CLASS(1,  4);
     REGISTER_ORDER_CLASS(2,  9);
     REGISTER_ORDER_CLASS(3, 16);
@@ -578,5 +1721,12 @@ CK_DLL_QUERY( AmbiEnc )
     REGISTER_ORDER_CLASS(5, 36);
     REGISTER_ORDER_CLASS(6, 49);
     REGISTER_ORDER_CLASS(7, 64);
+    REGISTER_MULTI_CLASS(1,  4);
+    REGISTER_MULTI_CLASS(2,  9);
+    REGISTER_MULTI_CLASS(3, 16);
+    REGISTER_MULTI_CLASS(4, 25);
+    REGISTER_MULTI_CLASS(5, 36);
+    REGISTER_MULTI_CLASS(6, 49);
+    REGISTER_MULTI_CLASS(7, 64);
     return TRUE;
 }
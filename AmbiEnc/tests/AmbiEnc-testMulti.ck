@@ -0,0 +1,94 @@
+/*
+    AmbiEnc-testMulti.ck
+
+    Check AmbiEncMulti3 against separate AmbiEnc3 encoders, one per input, each
+    panned to that input's direction. For the stereo, quad, 5.1 and 7.1 layouts,
+    a few rotations, widths and elevations, every output channel of the stem
+    encoder has to match the sum of the separate encoders once the gains have
+    settled. The LFE input of the surround layouts has to stay out of the mix.
+    Prints the largest difference of each run, then PASSED or FAILED as the
+    last line.
+
+    How to run (from AmbiEnc directory):
+        ```
+        $ chuck --chugin:./AmbiEnc.chug --silent tests/AmbiEnc-testMulti.ck
+        ```
+*/
+
+// largest difference tolerated between the stem and the sum of the encoders
+1e-5 => float tolerance;
+
+// matches AmbiEnc's layout table, in degrees, with -1 where there is no LFE
+[[30.0, -30], [45.0, -45, 135, -135], [30.0, -30, 0, 0, 110, -110], [30.0, -30, 0, 0, 150, -150, 90, -90]] @=> float layouts[][];
+[-1, -1, 3, 3] @=> int lfe[];
+[AmbiEncMulti3.STEREO, AmbiEncMulti3.QUAD, AmbiEncMulti3.SURROUND_51, AmbiEncMulti3.SURROUND_71] @=> int layoutIds[];
+["stereo", "quad", "5.1", "7.1"] @=> string layoutNames[];
+
+// rotation, elevation and width of every run, in radians
+[[0.0, 0, 1], [1.2, 0.3, 1], [-2.5, -0.4, 0.5], [3.0, 0.9, 0]] @=> float moves[][];
+
+16 => int channels;
+64 => int period;
+0 => int failures;
+
+fun void check(int ok, string what) {
+    if (!ok) {
+        cherr <= "  failed: " <= what <= IO.nl();
+        failures++;
+    }
+}
+
+// a different tone on every input
+SinOsc osc[8];
+for (0 => int k; k < 8; k++) {
+    220 * (k + 1) => osc[k].freq;
+    0.1 => osc[k].gain;
+}
+
+for (0 => int l; l < layoutIds.size(); l++) {
+    layouts[l].size() => int n;
+    AmbiEncMulti3 stem(layoutIds[l], period, AmbiEncMulti3.RADIANS) => blackhole;
+    AmbiEnc3 enc[n];
+    for (0 => int k; k < n; k++) {
+        osc[k] => stem.chan(k);
+        osc[k] => enc[k] => blackhole;
+        period => enc[k].updatePeriod;
+        AmbiEnc3.RADIANS => enc[k].boundsType;
+    }
+    check(stem.inputs() == n, layoutNames[l] + " uses every input");
+
+    for (0 => int m; m < moves.size(); m++) {
+        moves[m][0] => float a;
+        moves[m][1] => float e;
+        moves[m][2] => float w;
+        stem.pan(a, e);
+        w => stem.width;
+        for (0 => int k; k < n; k++) enc[k].pan(a + w * layouts[l][k] * pi / 180, e);
+
+        // let both settle, then compare sample by sample
+        (4 * period)::samp => now;
+        0.0 => float worst;
+        for (0 => int s; s < 256; s++) {
+            1::samp => now;
+            for (0 => int c; c < channels; c++) {
+                0.0 => float sum;
+                for (0 => int k; k < n; k++)
+                    if (k != lfe[l]) enc[k].chan(c).last() +=> sum;
+                Math.max(worst, Math.fabs(stem.chan(c).last() - sum)) => worst;
+            }
+        }
+
+        chout <= layoutNames[l] <= ", azimuth " <= a <= ", elevation " <= e <= ", width " <= w <= ": " <= worst <= IO.nl();
+        check(worst <= tolerance, layoutNames[l] + " matches the separate encoders");
+    }
+
+    for (0 => int k; k < n; k++) {
+        osc[k] =< stem.chan(k);
+        osc[k] =< enc[k];
+        enc[k] =< blackhole;
+    }
+    stem =< blackhole;
+}
+
+if (failures == 0) chout <= "PASSED" <= IO.nl();
+else chout <= "FAILED, " <= failures <= " checks" <= IO.nl();
@@ -0,0 +1,105 @@
+/*
+    AmbiEnc-testPanMany.ck
+
+    Check AmbiEnc1.panMany() and AmbiEnc3.panMany() against pan(): one set of
+    encoders is moved with panMany(), a twin set with pan() on each encoder, and
+    every output channel of each encoder has to match its twin once the gains
+    have settled. The arrays handed to panMany() have null entries, which are
+    skipped, and their elevations are one shorter than the encoders, so the last
+    encoder has to stay where it is. Prints the largest difference of each run,
+    then PASSED or FAILED as the last line.
+
+    How to run (from AmbiEnc directory):
+        ```
+        $ chuck --chugin:./AmbiEnc.chug --silent tests/AmbiEnc-testPanMany.ck
+        ```
+*/
+
+// largest difference tolerated between an encoder and its twin
+1e-5 => float tolerance;
+
+// 1 for an encoder, 0 where the array holds null
+[1, 1, 0, 1, 1, 0, 1] @=> int used[];
+used.size() => int n;
+64 => int period;
+
+// positions of every run, in radians
+[[0.0, 0], [1.2, 0.3], [-2.5, -0.4], [3.0, 0.9]] @=> float moves[][];
+
+0 => int failures;
+
+fun void check(int ok, string what) {
+    if (!ok) {
+        cherr <= "  failed: " <= what <= IO.nl();
+        failures++;
+    }
+}
+
+SinOsc osc => blackhole;
+330 => osc.freq;
+
+AmbiEnc1 @ many1[n];
+AmbiEnc1 @ twin1[n];
+AmbiEnc3 @ many3[n];
+AmbiEnc3 @ twin3[n];
+0 => int voices;
+for (0 => int k; k < n; k++) {
+    if (!used[k]) continue;
+    new AmbiEnc1(period, AmbiEnc1.RADIANS) @=> many1[k];
+    new AmbiEnc1(period, AmbiEnc1.RADIANS) @=> twin1[k];
+    new AmbiEnc3(period, AmbiEnc3.RADIANS) @=> many3[k];
+    new AmbiEnc3(period, AmbiEnc3.RADIANS) @=> twin3[k];
+    osc => many1[k] => blackhole;
+    osc => twin1[k] => blackhole;
+    osc => many3[k] => blackhole;
+    osc => twin3[k] => blackhole;
+    voices++;
+}
+
+// every encoder starts at the same place as its twin, away from the moves
+for (0 => int k; k < n; k++) {
+    if (!used[k]) continue;
+    many1[k].pan(0.4, -0.2);
+    twin1[k].pan(0.4, -0.2);
+    many3[k].pan(0.4, -0.2);
+    twin3[k].pan(0.4, -0.2);
+}
+
+for (0 => int m; m < moves.size(); m++) {
+    // a different position for every encoder, with one elevation too few
+    float a[n];
+    float e[n - 1];
+    for (0 => int k; k < n; k++) {
+        moves[m][0] + 0.3 * k => a[k];
+        if (k < n - 1) moves[m][1] - 0.05 * k => e[k];
+    }
+
+    check(AmbiEnc1.panMany(many1, a, e) == voices - 1, "AmbiEnc1.panMany() moves every encoder it has an elevation for");
+    check(AmbiEnc3.panMany(many3, a, e) == voices - 1, "AmbiEnc3.panMany() moves every encoder it has an elevation for");
+    for (0 => int k; k < n - 1; k++) {
+        if (!used[k]) continue;
+        twin1[k].pan(a[k], e[k]);
+        twin3[k].pan(a[k], e[k]);
+    }
+
+    // let both settle, then compare sample by sample
+    (4 * period)::samp => now;
+    0.0 => float worst;
+    for (0 => int s; s < 256; s++) {
+        1::samp => now;
+        for (0 => int k; k < n; k++) {
+            if (!used[k]) continue;
+            for (0 => int c; c < 4; c++)
+                Math.max(worst, Math.fabs(many1[k].chan(c).last() - twin1[k].chan(c).last())) => worst;
+            for (0 => int c; c < 16; c++)
+                Math.max(worst, Math.fabs(many3[k].chan(c).last() - twin3[k].chan(c).last())) => worst;
+        }
+    }
+
+    chout <= "azimuth " <= moves[m][0] <= ", elevation " <= moves[m][1] <= ": " <= worst <= IO.nl();
+    check(worst <= tolerance, "panMany() matches pan() at azimuth " + moves[m][0]);
+    check(Math.fabs(many3[n - 1].azimuth() - 0.4) < tolerance, "the encoder past the shortest array stays put");
+}
+
+if (failures == 0) chout <= "PASSED" <= IO.nl();
+else chout <= "FAILED, " <= failures <= " checks" <= IO.nl();
@@ -1,17 +1,37 @@
 // include chugin header
 #include "chugin.h"
 
+// shared SH math, kernels and dispatch
+#include "AmbiCore.h"
+
+// choreography files and baked gains, which map files and so live outside AmbiCore.h
+#include "AmbiBake.h"
+
 // general includes
 #include <stdio.h>
 #include <iostream>
 #include <cmath>
-
-// constants
-const int MAX_CHANNELS = 64;
+#include <cstring>
+#include <vector>
 
 // static variables
 static t_CKUINT amb_bounds_normalized = 0;
 static t_CKUINT amb_bounds_radians = 1;
+static t_CKUINT amb_interp_linear = 0;
+static t_CKUINT amb_interp_hermite = 1;
+static t_CKUINT amb_keys_once = 0;
+static t_CKUINT amb_keys_loop = 1;
+static t_CKUINT amb_keys_pingpong = 2;
+static t_CKUINT amb_path_angles = 0;
+static t_CKUINT amb_path_great_circle = 1;
+static t_CKUINT amb_angle_azimuth = AMBI_TRAJ_AZIMUTH;
+static t_CKUINT amb_angle_elevation = AMBI_TRAJ_ELEVATION;
+
+// runtime counters of AmbiPan (see AmbiStats.h)
+static const int AMBIPAN_STATS_CLASS = 0;
+
+// process id of AmbiPan in Chrome traces (see AmbiTrace.h)
+static const int AMBIPAN_TRACE_PID = 1;
 
 // declaration of chugin constructor
 CK_DLL_CTOR( ambipan_ctor );
@@ -24,6 +44,20 @@ CK_DLL_DTOR( ambipan_dtor );
 
 // declaration of ZAmbPan functions
 CK_DLL_MFUN( ambipan_path );
+CK_DLL_MFUN( ambipan_keyframe );
+CK_DLL_MFUN( ambipan_clearKeyframes );
+CK_DLL_MFUN( ambipan_playKeyframes );
+CK_DLL_MFUN( ambipan_stopKeyframes );
+CK_DLL_MFUN( ambipan_getKeyframeIndex );
+CK_DLL_MFUN( ambipan_getDone );
+CK_DLL_MFUN( ambipan_getDoneCount );
+CK_DLL_MFUN( ambipan_trajectory );
+CK_DLL_MFUN( ambipan_trajectoryTerm );
+CK_DLL_MFUN( ambipan_stopTrajectory );
+CK_DLL_MFUN( ambipan_playChoreography );
+CK_DLL_MFUN( ambipan_stopChoreography );
+CK_DLL_MFUN( ambipan_bake );
+CK_DLL_MFUN( ambipan_playBaked );
 
 // declaration of setters
 CK_DLL_MFUN( ambipan_setAzimuth );
@@ -35,6 +69,12 @@ CK_DLL_MFUN( ambipan_pan );
 CK_DLL_MFUN( ambipan_set );
 CK_DLL_MFUN( ambipan_setUpdatePeriod );
 CK_DLL_MFUN( ambipan_setOrder );
+CK_DLL_MFUN( ambipan_setBlockSize );
+CK_DLL_MFUN( ambipan_setSilenceDetection );
+CK_DLL_MFUN( ambipan_setAdaptive );
+CK_DLL_MFUN( ambipan_setMaxError );
+CK_DLL_MFUN( ambipan_setInterp );
+CK_DLL_MFUN( ambipan_setPathMode );
 
 // declaration of getters
 CK_DLL_MFUN( ambipan_getAzimuth );
@@ -44,6 +84,40 @@ CK_DLL_MFUN( ambipan_getElevationVelocity );
 CK_DLL_MFUN( ambipan_getOrder );
 CK_DLL_MFUN( ambipan_getOutChannels );
 CK_DLL_MFUN( ambipan_getUpdatePeriod );
+CK_DLL_MFUN( ambipan_getBlockSize );
+CK_DLL_MFUN( ambipan_getLatency );
+CK_DLL_MFUN( ambipan_getSilenceDetection );
+CK_DLL_MFUN( ambipan_getSilent );
+CK_DLL_MFUN( ambipan_getAdaptive );
+CK_DLL_MFUN( ambipan_getMaxError );
+CK_DLL_MFUN( ambipan_getInterp );
+CK_DLL_MFUN( ambipan_getPathMode );
+CK_DLL_MFUN( ambipan_getOverruns );
+CK_DLL_MFUN( ambipan_getWorstTick );
+CK_DLL_MFUN( ambipan_getInstanceId );
+
+// declaration of static functions
+CK_DLL_SFUN( ambipan_isa );
+CK_DLL_SFUN( ambipan_precisionError );
+CK_DLL_SFUN( ambipan_instances );
+CK_DLL_SFUN( ambipan_samplesProcessed );
+CK_DLL_SFUN( ambipan_gainUpdates );
+CK_DLL_SFUN( ambipan_silentBlocks );
+CK_DLL_SFUN( ambipan_tickTime );
+CK_DLL_SFUN( ambipan_resetStats );
+CK_DLL_SFUN( ambipan_statsTiming );
+CK_DLL_SFUN( ambipan_traceStart );
+CK_DLL_SFUN( ambipan_traceStop );
+CK_DLL_SFUN( ambipan_deadlineMonitor );
+CK_DLL_SFUN( ambipan_deadlineBudget );
+CK_DLL_SFUN( ambipan_tickP50 );
+CK_DLL_SFUN( ambipan_tickP99 );
+CK_DLL_SFUN( ambipan_tickMax );
+CK_DLL_SFUN( ambipan_tickOverruns );
+CK_DLL_SFUN( ambipan_deadlineDump );
+CK_DLL_SFUN( ambipan_choreographySources );
+CK_DLL_SFUN( ambipan_writeChoreography );
+CK_DLL_SFUN( ambipan_panMany );
 
 // for chugins extending UGen, this is mono synthesis function for 1 sample
 CK_DLL_TICKF( ambipan_tickf );
@@ -51,16 +125,52 @@ CK_DLL_TICKF( ambipan_tickf );
 // this is a special offset reserved for chugin internal data
 t_CKINT ambipan_data_offset = 0;
 
+// declaration of AmbiGroup functions
+CK_DLL_CTOR( ambigroup_ctor );
+CK_DLL_CTOR( ambigroup_ctor_order );
+CK_DLL_CTOR( ambigroup_ctor_orderAndPeriod );
+CK_DLL_CTOR( ambigroup_ctor_orderAndPeriodAndBounds );
+CK_DLL_DTOR( ambigroup_dtor );
+CK_DLL_TICKF( ambigroup_tickf );
+CK_DLL_MFUN( ambigroup_rotate );
+CK_DLL_MFUN( ambigroup_setYaw );
+CK_DLL_MFUN( ambigroup_setPitch );
+CK_DLL_MFUN( ambigroup_setRoll );
+CK_DLL_MFUN( ambigroup_setOrder );
+CK_DLL_MFUN( ambigroup_setUpdatePeriod );
+CK_DLL_MFUN( ambigroup_setBoundsType );
+CK_DLL_MFUN( ambigroup_getYaw );
+CK_DLL_MFUN( ambigroup_getPitch );
+CK_DLL_MFUN( ambigroup_getRoll );
+CK_DLL_MFUN( ambigroup_getOrder );
+CK_DLL_MFUN( ambigroup_getUpdatePeriod );
+CK_DLL_MFUN( ambigroup_getBoundsType );
+
+t_CKINT ambigroup_data_offset = 0;
+
+// out[f][c] = 0 for the inactive channels nch..MAX_CHANNELS
+static inline void encode_zero( SAMPLE * out, int nframes, int nch )
+{
+    if (nch >= MAX_CHANNELS) return;
+    for (int f = 0; f < nframes; f++)
+        memset(out + f * MAX_CHANNELS + nch, 0, sizeof(SAMPLE) * (MAX_CHANNELS - nch));
+}
+
 //-----------------------------------------------------------------------------
 // class definition for internal chugin data
 // (NOTE this isn't strictly necessary, but is one example of a recommended approach)
+// T is the precision of the gain state
 //-----------------------------------------------------------------------------
-class AmbiPan
+template<typename T>
+class AmbiPanT
 {
 public:
     // constructor
-    AmbiPan( t_CKFLOAT fs, t_CKINT order, t_CKDUR update_period, t_CKINT bounds_type )
+    AmbiPanT( t_CKFLOAT fs, t_CKINT order, t_CKDUR update_period, t_CKINT bounds_type )
     {
+        m_stats = ambi_stats_block();
+        ambi_stats_count(m_stats, AMBIPAN_STATS_CLASS, AMBI_STAT_INSTANCES, 1);
+
         m_order = order;
         m_out_channels = (order+1) * (order+1);
         m_azimuth = 0;
@@ -72,21 +182,85 @@ public:
         srate = fs;
         m_path_change = false;
         m_path_samples_left = -1;
+        m_path_running = false;
         m_bounds_type = bounds_type;
 
+        // Great-circle paths (angles interpolated separately by default)
+        m_path_mode = amb_path_angles;
+        m_gc_active = false;
+        m_gc_angle = 0;
+        m_gc_final_azimuth = 0;
+        m_gc_final_elevation = 0;
+        for (int i = 0; i < 3; i++) {
+            m_gc_pos[i] = 0;
+            m_gc_axis[i] = 0;
+            m_ahead_pos[i] = 0;
+        }
+        for (int i = 0; i < 9; i++) m_gc_rot[i] = 0;
+
+        // Keyframe runs (none playing)
+        m_key_mode = amb_keys_once;
+        m_key_index = -1;
+        m_key_dir = 1;
+        m_key_left = 0;
+
+        // Trajectories (none running)
+        m_traj_active = false;
+        ambi_trajectory_init(&m_traj, 0, 0, 0);
+
+        // Choreography playback (none playing)
+        m_choreo = NULL;
+        m_choreo_source = 0;
+        m_choreo_time = 0;
+        m_choreo_started = false;
+
+        // Done events (the ChucK Event is attached by the constructor glue)
+        m_done_event = NULL;
+        m_done_vm = NULL;
+        m_done_buffer = NULL;
+        m_done_pending = 0;
+        m_done_count = 0;
+        m_done_landing = false;
+
         // Gain interpolation
         m_update_period = (update_period < 1 ? 1 : update_period);
         m_samples_left = 0;
 
+        // Block processing (off by default)
+        m_block_size = 1;
+        m_block_pos = 0;
+        m_block_in = NULL;
+        m_block_out = NULL;
+
+        // Silence detection
+        m_silence_detect = false;
+        m_silent_frames = 0;
+        m_gains_stale = false;
+
+        // Adaptive update period
+        m_adaptive = false;
+        m_max_error = 0.001;
+
+        // Gain interpolation shape (linear by default)
+        m_interp = amb_interp_linear;
+        m_slope_valid = false;
+        m_ahead_valid = false;
+        m_ahead_azimuth = 0;
+        m_ahead_elevation = 0;
+
         for (int c = 0; c < MAX_CHANNELS; c++) {
             m_gain_cur[c] = 0;
             m_gain_next[c] = 0;
             m_gain_step[c] = 0;
+            m_gain_accel[c] = 0;
+            m_gain_jerk[c] = 0;
+            m_gain_slope[c] = 0;
+            m_gain_ahead[c] = 0;
         }
 
         // Initial calculation for coefficients + gains
-        compute_coeffs();
-        compute_gains();
+        m_coeffs = sh_coeffs();
+        compute_gains(m_azimuth, m_elevation, m_gain_next);
 
         // Initialize starting gains
         for (int c = 0; c < MAX_CHANNELS; c++)
@@ -95,56 +269,168 @@ public:
         }
     }
 
+    // destructor
+    ~AmbiPanT()
+    {
+        delete [] m_block_in;
+        delete [] m_block_out;
+        ambi_choreo_release(m_choreo, &m_choreo_cursor);
+        ambi_stats_count(m_stats, AMBIPAN_STATS_CLASS, AMBI_STAT_INSTANCES, -1);
+    }
+
     // for chugins extending UGen
     void tick( SAMPLE * in, SAMPLE * out, int nframes )
     {
-        for (int f = 0; f < nframes; f++) {
-            // compute new gains only if updatePeriod samples have passed and azimuth and/or elevation has changed
-            // if (m_samples_left <= 0)
+        AMBI_TRACE_SCOPE("tick", "frames", nframes);
+        t_CKINT start = ambi_stats_tick_start();
+
+        if (m_block_size <= 1) {
+            process( in, out, nframes );
+        } else {
+            // Buffer input and play back the block computed m_block_size frames ago
+            for (int f = 0; f < nframes; f++) {
+                m_block_in[m_block_pos] = in[f];
+                memcpy(out + f * MAX_CHANNELS, m_block_out + m_block_pos * MAX_CHANNELS, sizeof(SAMPLE) * MAX_CHANNELS);
+
+                if (++m_block_pos == m_block_size) {
+                    m_monitor.reasons |= AMBI_REASON_BLOCK;
+                    process( m_block_in, m_block_out, m_block_size );
+                    m_block_pos = 0;
+                }
+            }
+        }
+
+        m_monitor.end(m_stats, AMBIPAN_STATS_CLASS, this, nframes, start);
+    }
+
+    void process( SAMPLE * in, SAMPLE * out, int nframes )
+    {
+        AMBI_TRACE_SCOPE("process", "frames", nframes);
+
+        // Silent input: write zeros once, then only keep position and ramp state moving
+        bool silent = detect_silence( in, nframes );
+        if (silent) {
+            ambi_stats_count(m_stats, AMBIPAN_STATS_CLASS, AMBI_STAT_SILENT_BLOCKS, 1);
+            AMBI_TRACE_INSTANT("silent", "frames", nframes);
+            clear_output(out, nframes * MAX_CHANNELS);
+        } else {
+            // The output was silent, so jump straight to where the source is now
+            if (m_gains_stale) {
+                position_gains(m_gain_next);
+                for (int c = 0; c < m_out_channels; c++) {
+                    m_gain_cur[c] = m_gain_next[c];
+                    m_gain_step[c] = 0;
+                    m_gain_accel[c] = 0;
+                    m_gain_jerk[c] = 0;
+                }
+                m_gains_stale = false;
+                m_slope_valid = false;
+            }
+        }
+
+        int f = 0;
+        while (f < nframes) {
+            // compute new gains only if updatePeriod samples have passed and the source has moved
             if (    m_samples_left <= 0 &&
-                    (m_pan_change || m_velo_change || m_path_change) ||
-                    (m_azi_velocity != 0 || m_ele_velocity != 0)
+                    (m_pan_change || m_velo_change || m_path_change ||
+                     m_azi_velocity != 0 || m_ele_velocity != 0 || m_key_index >= 0 || m_gc_active || m_traj_active ||
+                     (m_choreo && (!m_choreo_started || m_choreo_time < m_choreo->nframes - 1)))
             ) {
-                m_azimuth += m_azi_velocity;
-                m_elevation += m_ele_velocity;
+                AMBI_TRACE_SCOPE("update", "period", (t_CKINT)m_update_period);
+                if (m_path_change) m_monitor.reasons |= AMBI_REASON_PATH;
+
+                // Samples until the next update point: an update period, or less where a keyframe falls
+                t_CKDUR ramp;
+                if (m_key_index >= 0) {
+                    ramp = step_keyframes();
+                } else {
+                    if (m_adaptive) adapt_period();
+                    ramp = m_update_period;
+                    if (m_gc_active) {
+                        // One precomputed rotation along the great circle
+                        rotate(m_gc_pos, m_gc_pos);
+                    } else if (m_traj_active) {
+                        // A new trajectory starts where it was put; after that, one step per update
+                        if (!m_pan_change) step_trajectory();
+                    } else if (m_choreo) {
+                        step_choreography();
+                    } else {
+                        // The angles stay as set, for azimuth() / elevation(); compute_gains()
+                        // wraps them in double precision, so long sessions stay as accurate as short ones
+                        m_azimuth += m_azi_velocity;
+                        m_elevation += m_ele_velocity;
+                    }
+                }
                 if (m_pan_change && !m_velo_change) m_path_samples_left = 0;
-                // Update gains based on new azimuth / elevation
-                compute_gains();
-                m_samples_left = m_update_period;
+                if (silent) {
+                    // Nothing to hear; defer the gain computation until the input comes back
+                    m_gains_stale = true;
+                    m_ahead_valid = false;
+                } else if (m_interp == amb_interp_hermite) {
+                    start_hermite(ramp);
+                } else {
+                    // Update gains based on new azimuth / elevation
+                    position_gains(m_gain_next);
+                    for (int c = 0; c < m_out_channels; c++) {
+                        m_gain_step[c] = (m_gain_next[c] - m_gain_cur[c]) / ramp;
+                    }
+                }
+                m_samples_left = ramp;
                 m_pan_change = false;
                 m_velo_change = false;
                 m_path_change = false;
             }
 
+            // Number of frames until the next control event (end of block, ramp or path)
+            int n = nframes - f;
+            if (m_samples_left > 0 && m_samples_left < n) n = m_samples_left;
+            if (m_path_samples_left >= 0 && (int)m_path_samples_left + 1 < n) n = (int)m_path_samples_left + 1;
+
+            if (silent) {
+                // Advance the ramp without touching the output
+                if (m_samples_left > 0) {
+                    advance_gains(n, m_out_channels, m_gain_cur, m_gain_step, m_gain_accel, m_gain_jerk);
+                }
+            } else {
+                // Write only active channels, then zero out the rest
+                switch (m_out_channels) {
+                    case 1:  encode_segment<1>(in + f, out + f * MAX_CHANNELS, n); break;
+                    case 4:  encode_segment<4>(in + f, out + f * MAX_CHANNELS, n); break;
+                    case 9:  encode_segment<9>(in + f, out + f * MAX_CHANNELS, n); break;
+                    case 16: encode_segment<16>(in + f, out + f * MAX_CHANNELS, n); break;
+                    case 25: encode_segment<25>(in + f, out + f * MAX_CHANNELS, n); break;
+                    case 36: encode_segment<36>(in + f, out + f * MAX_CHANNELS, n); break;
+                    case 49: encode_segment<49>(in + f, out + f * MAX_CHANNELS, n); break;
+                    default: encode_segment<64>(in + f, out + f * MAX_CHANNELS, n); break;
+                }
+                encode_zero(out + f * MAX_CHANNELS, n, m_out_channels);
+            }
+
             if (m_path_samples_left >= 0) {
-                m_path_samples_left--;
+                m_path_samples_left -= n;
                 if (m_path_samples_left < 0) {
+                    if (m_path_running) {
+                        m_path_running = false;
+                        m_done_landing = true;
+                    }
                     m_path_change = false;
                     m_azi_velocity = 0;
                     m_ele_velocity = 0;
+                    if (m_gc_active) {
+                        // Settle on the end point as given; in adaptive mode the last
+                        // update may have fallen short of it
+                        m_gc_active = false;
+                        m_ahead_valid = false;
+                        m_azimuth = m_gc_final_azimuth;
+                        m_elevation = m_gc_final_elevation;
+                        m_pan_change = true;
+                    }
                 }
             }
 
-            // Write only active channels
-            for(int c = 0; c < m_out_channels; c++)
-            {
-                out[(f * MAX_CHANNELS) + c] = m_gain_cur[c] * in[f];
-            }
-
-            // Zero out the rest
-            for(int c = m_out_channels; c < MAX_CHANNELS; c++)
-            {
-                out[(f * MAX_CHANNELS) + c] = 0.;
-            }
-
             if (m_samples_left > 0) {
-                // Advance gains toward target
-                for (int c = 0; c < m_out_channels; c++) {
-                    m_gain_cur[c] += m_gain_step[c];
-                }
-
                 // Decrement sample counter
-                m_samples_left--;
+                m_samples_left -= n;
 
                 // Stop exactly at target
                 if (m_samples_left == 0)
@@ -153,13 +439,42 @@ public:
                     {
                         m_gain_cur[c] = m_gain_next[c];
                         m_gain_step[c] = 0;
+                        m_gain_accel[c] = 0;
+                        m_gain_jerk[c] = 0;
+                    }
+                    m_slope_valid = true;
+
+                    // The gains have arrived at the end of a path or at a keyframe
+                    if (m_done_landing) {
+                        m_done_landing = false;
+                        m_done_pending++;
                     }
                 }
             }
+
+            f += n;
+        }
+    }
+
+    // n frames of the current gain segment; N_CH is the channel count of this order,
+    // and frames are MAX_CHANNELS apart in the output
+    template<int N_CH>
+    void encode_segment( const SAMPLE * in, SAMPLE * out, int n )
+    {
+        if (m_samples_left > 0 && m_interp == amb_interp_hermite) {
+            AMBI_CALL_KERNEL(encode_cubic, AMBI_ARGS(<N_CH, MAX_CHANNELS>), (in, out, n, m_gain_cur, m_gain_step, m_gain_accel, m_gain_jerk));
+        } else if (m_samples_left > 0) {
+            AMBI_CALL_KERNEL(encode_ramp, AMBI_ARGS(<N_CH, MAX_CHANNELS>), (in, out, n, m_gain_cur, m_gain_step));
+        } else {
+            AMBI_CALL_KERNEL(encode_const, AMBI_ARGS(<N_CH, MAX_CHANNELS>), (in, out, n, m_gain_cur));
+            m_slope_valid = false;
         }
     }
 
     void path(t_CKFLOAT init_a, t_CKFLOAT init_e, t_CKFLOAT final_a, t_CKFLOAT final_e, t_CKDUR path_time) {
+        stop_keyframes();
+        stop_path();
+
         // Scale [-1, 1] to [-PI, PI]
         if (m_bounds_type == amb_bounds_normalized) {
             init_a = scalef(init_a, -1.0, 1., -1 * M_PI, M_PI);
@@ -171,19 +486,247 @@ public:
         path_time = path_time <= m_update_period ? m_update_period: path_time;
         path_time += fmod(m_update_period - path_time, m_update_period);
 
-        m_azi_velocity = (final_a - init_a) / path_time * m_update_period;
-        m_ele_velocity = (final_e - init_e) / path_time * m_update_period;
-        m_azimuth = init_a - m_azi_velocity;
-        m_elevation = init_e - m_ele_velocity;
+        if (m_path_mode == amb_path_great_circle) {
+            start_great_circle(init_a, init_e, final_a, final_e, path_time);
+        } else {
+            m_azi_velocity = (final_a - init_a) / path_time * m_update_period;
+            m_ele_velocity = (final_e - init_e) / path_time * m_update_period;
+            m_azimuth = init_a - m_azi_velocity;
+            m_elevation = init_e - m_ele_velocity;
+        }
 
         m_pan_change = false;
         m_path_change = true;
         m_path_samples_left = path_time;
+        m_path_running = true;
+        AMBI_TRACE_INSTANT("path", "samples", (t_CKINT)path_time);
+    }
+
+    // Queue a keyframe: the source reaches (a, e) time after the previous keyframe
+    t_CKINT keyframe( t_CKFLOAT a, t_CKFLOAT e, t_CKDUR time )
+    {
+        // Scale [-1, 1] to [-PI, PI]
+        if (m_bounds_type == amb_bounds_normalized) {
+            a = scalef(a, -1.0, 1., -1 * M_PI, M_PI);
+            e = scalef(e, -1.0, 1., -1 * M_PI, M_PI);
+        }
+
+        // Keyframes fall on whole samples, at least one apart
+        Keyframe k = { a, e, time < 1 ? 1 : floor(time + 0.5) };
+        m_keys.push_back(k);
+        return m_keys.size();
+    }
+
+    void clearKeyframes()
+    {
+        stop_keyframes();
+        m_keys.clear();
+    }
+
+    // Move through the keyframes from where the source is now, once, in a loop or back and forth
+    t_CKINT playKeyframes( t_CKINT mode )
+    {
+        stop_keyframes();
+        stop_path();
+        if (m_keys.empty()) return 0;
+
+        // A pending pan() lands first
+        t_CKFLOAT a = m_azimuth, e = m_elevation;
+        if (m_pan_change) {
+            a += m_azi_velocity;
+            e += m_ele_velocity;
+        }
+        m_azimuth = a;
+        m_elevation = e;
+        m_pan_change = false;
+        m_velo_change = false;
+        m_path_change = false;
+        m_path_samples_left = -1;
+
+        m_key_mode = mode;
+        m_key_dir = 1;
+        start_segment(0, m_keys[0].dur, a, e);
+
+        // Start on this sample, from wherever the current ramp has got to
+        m_samples_left = 0;
+        return m_keys.size();
+    }
+
+    // Stop a keyframe run; the source stays where it is
+    void stopKeyframes()
+    {
+        stop_keyframes();
+    }
+
+    t_CKINT getKeyframeIndex()
+    {
+        return m_key_index;
+    }
+
+    // Start a trajectory shape from the current update: an orbit at elevation size,
+    // a spiral that climbs to +-size and back every 8 turns, a 3:2 Lissajous figure
+    // of half-width size, or an orbit that also wanders randomly by size after one
+    // second. rate is in turns (cycles) per second, phase the starting azimuth.
+    // Returns 0 for an unknown shape
+    t_CKINT trajectory( const char * shape, t_CKFLOAT rate, t_CKFLOAT size, t_CKFLOAT phase )
+    {
+        // Scale [-1, 1] to [-PI, PI]
+        if (m_bounds_type == amb_bounds_normalized) {
+            size = scalef(size, -1.0, 1., -1 * M_PI, M_PI);
+            phase = scalef(phase, -1.0, 1., -1 * M_PI, M_PI);
+        }
+
+        AmbiTrajectory t;
+        ambi_trajectory_init(&t, phase, 0, m_monitor.id);
+        ambi_trajectory_period(&t, m_update_period / srate);
+        if (!strcmp(shape, "orbit")) {
+            t.center[AMBI_TRAJ_ELEVATION] = size;
+            ambi_trajectory_drift(&t, AMBI_TRAJ_AZIMUTH, 2 * M_PI * rate);
+        } else if (!strcmp(shape, "spiral")) {
+            ambi_trajectory_drift(&t, AMBI_TRAJ_AZIMUTH, 2 * M_PI * rate);
+            ambi_trajectory_term(&t, AMBI_TRAJ_ELEVATION, size, rate / 8, 0);
+        } else if (!strcmp(shape, "lissajous")) {
+            ambi_trajectory_term(&t, AMBI_TRAJ_AZIMUTH, size, 3 * rate, 0);
+            ambi_trajectory_term(&t, AMBI_TRAJ_ELEVATION, size, 2 * rate, 0);
+        } else if (!strcmp(shape, "walk")) {
+            ambi_trajectory_drift(&t, AMBI_TRAJ_AZIMUTH, 2 * M_PI * rate);
+            ambi_trajectory_wander(&t, AMBI_TRAJ_AZIMUTH, size);
+            ambi_trajectory_wander(&t, AMBI_TRAJ_ELEVATION, size);
+        } else {
+            return 0;
+        }
+
+        stop_keyframes();
+        stop_path();
+        m_traj = t;
+        m_traj_active = true;
+
+        // Jump to the start on this sample, like pan()
+        ambi_trajectory_value(&m_traj, &m_azimuth, &m_elevation);
+        m_azi_velocity = 0;
+        m_ele_velocity = 0;
+        m_pan_change = true;
+        m_velo_change = false;
+        m_samples_left = 0;
+        return 1;
+    }
+
+    // Add amp * sin(2 pi freq t + phase) to one angle of the running trajectory;
+    // returns the number of terms of that angle, or -1 if none runs or it is full
+    t_CKINT trajectoryTerm( t_CKINT angle, t_CKFLOAT amp, t_CKFLOAT freq, t_CKFLOAT phase )
+    {
+        if (!m_traj_active || (angle != amb_angle_azimuth && angle != amb_angle_elevation)) return -1;
+
+        // Scale [-1, 1] to [-PI, PI]
+        if (m_bounds_type == amb_bounds_normalized) {
+            amp = scalef(amp, -1.0, 1., -1 * M_PI, M_PI);
+            phase = scalef(phase, -1.0, 1., -1 * M_PI, M_PI);
+        }
+        return ambi_trajectory_term(&m_traj, angle, amp, freq, phase);
+    }
+
+    void stopTrajectory()
+    {
+        stop_trajectory();
+    }
+
+    // Play source of a choreography file from the next update on; returns its
+    // number of frames, or 0 if the file can't be opened or has no such source.
+    // Opening blocks the VM while the header is read, one page; the frames are
+    // read in by the prefetch thread, and the source waits until they are
+    t_CKINT playChoreography( const char * path, t_CKINT source )
+    {
+        AmbiChoreo * c = ambi_choreo_acquire(path);
+        if (!c) return 0;
+        if (c->order >= 0 || source < 0 || source >= c->nsources) {
+            ambi_choreo_release(c);
+            return 0;
+        }
+
+        start_choreography(c, source);
+        return c->nframes;
+    }
+
+    // Evaluate source of a choreography file ahead of time into a baked gain file,
+    // at this voice's order and update period; returns the number of updates
+    // written, or 0 if either file can't be opened or there is no such source
+    t_CKINT bake( const char * path, t_CKINT source, const char * baked )
+    {
+        AmbiChoreo * c = ambi_choreo_acquire(path);
+        if (!c) return 0;
+
+        t_CKINT n = 0;
+        if (c->order < 0 && source >= 0 && source < c->nsources)
+            n = ambi_bake_write(baked, c, source, m_order, srate / m_update_period);
+        ambi_choreo_release(c);
+        return n;
+    }
+
+    // Play a baked gain file from the next update on; returns its number of
+    // updates, or 0 if it can't be opened or was baked at a lower order
+    t_CKINT playBaked( const char * path )
+    {
+        AmbiChoreo * c = ambi_choreo_acquire(path);
+        if (!c) return 0;
+        if (c->order < m_order) {
+            ambi_choreo_release(c);
+            return 0;
+        }
+
+        start_choreography(c, 0);
+        return c->nframes;
+    }
+
+    void stopChoreography()
+    {
+        stop_choreography();
+    }
+
+    // The Event broadcast when a path or keyframe segment finishes, and the VM
+    // and event buffer it is queued through
+    void setDoneEvent( Chuck_Object * e, Chuck_VM * vm, CBufferSimple * buffer )
+    {
+        m_done_event = e;
+        m_done_vm = vm;
+        m_done_buffer = buffer;
+    }
+
+    Chuck_Object * getDoneEvent()
+    {
+        return m_done_event;
+    }
+
+    Chuck_VM * getDoneVM()
+    {
+        return m_done_vm;
+    }
+
+    CBufferSimple * getDoneBuffer()
+    {
+        return m_done_buffer;
+    }
+
+    // Paths and keyframe segments finished since the last call
+    t_CKINT takeDone()
+    {
+        t_CKINT n = m_done_pending;
+        m_done_count += n;
+        m_done_pending = 0;
+        return n;
+    }
+
+    // Paths and keyframe segments finished since the panner was created
+    t_CKINT getDoneCount()
+    {
+        return m_done_count;
     }
 
     // setters
     t_CKFLOAT setAzimuth( t_CKFLOAT a )
     {
+        stop_keyframes();
+        stop_path();
+
         // Scale [-1, 1] to [-PI, PI]
         if (m_bounds_type == amb_bounds_normalized) {
             a = scalef(a, -1.0, 1., -1 * M_PI, M_PI);
@@ -199,6 +742,9 @@ public:
 
     t_CKFLOAT setElevation( t_CKFLOAT e )
     {
+        stop_keyframes();
+        stop_path();
+
         // Scale [-1, 1] to [-PI, PI]
         if (m_bounds_type == amb_bounds_normalized) {
             e = scalef(e, -1.0, 1., -1 * M_PI, M_PI);
@@ -214,6 +760,9 @@ public:
 
     t_CKFLOAT setAzimuthVelocity( t_CKFLOAT a_v )
     {
+        stop_keyframes();
+        stop_path();
+
     // Scale [-1, 1] to [-PI, PI]
         if (m_bounds_type == amb_bounds_normalized) {
             a_v = scalef(a_v, -1.0, 1., -1 * M_PI, M_PI);
@@ -232,6 +781,9 @@ public:
 
     t_CKFLOAT setElevationVelocity( t_CKFLOAT e_v )
     {
+        stop_keyframes();
+        stop_path();
+
         // Scale [-1, 1] to [-PI, PI]
         if (m_bounds_type == amb_bounds_normalized) {
             e_v = scalef(e_v, -1.0, 1., -1 * M_PI, M_PI);
@@ -250,6 +802,9 @@ public:
 
     t_CKVEC2 setVelocities( t_CKFLOAT a_v, t_CKFLOAT e_v )
     {
+        stop_keyframes();
+        stop_path();
+
         // Scale [-1, 1] to [-PI, PI]
         if (m_bounds_type == amb_bounds_normalized) {
             a_v = scalef(a_v, -1.0, 1., -1 * M_PI, M_PI);
@@ -270,6 +825,9 @@ public:
 
     t_CKVEC2 pan( t_CKFLOAT a, t_CKFLOAT e)
     {
+        stop_keyframes();
+        stop_path();
+
         // Scale [-1, 1] to [-PI, PI]
         if (m_bounds_type == amb_bounds_normalized) {
             a = scalef(a, -1.0, 1., -1 * M_PI, M_PI);
@@ -288,8 +846,37 @@ public:
         return retVec;
     }
 
+    // Where the next update puts a source just moved by pan(). In adaptive mode
+    // that update first rescales the velocities to the period it picks, so the
+    // step is worked out the same way here and batched gains land on it
+    void pan_target( t_CKFLOAT * azimuth, t_CKFLOAT * elevation )
+    {
+        t_CKFLOAT azi_velocity = m_azi_velocity, ele_velocity = m_ele_velocity;
+        if (m_adaptive) {
+            t_CKDUR p = next_period();
+            azi_velocity *= p / m_update_period;
+            ele_velocity *= p / m_update_period;
+        }
+        *azimuth = wrap_angle(m_azimuth + azi_velocity);
+        *elevation = wrap_angle(m_elevation + ele_velocity);
+    }
+
+    // Where gains at (azimuth, elevation), evaluated together with other panners,
+    // are to be written. They take the place of the look-ahead gains, so the next
+    // update uses them if the source gets there
+    T * pan_gains( t_CKFLOAT azimuth, t_CKFLOAT elevation )
+    {
+        m_ahead_azimuth = azimuth;
+        m_ahead_elevation = elevation;
+        m_ahead_valid = true;
+        return m_gain_ahead;
+    }
+
     t_CKVEC4 set( t_CKFLOAT a, t_CKFLOAT e, t_CKFLOAT a_v, t_CKFLOAT e_v)
     {
+        stop_keyframes();
+        stop_path();
+
         // Scale [-1, 1] to [-PI, PI]
         if (m_bounds_type == amb_bounds_normalized) {
             a = scalef(a, -1.0, 1., -1 * M_PI, M_PI);
@@ -320,21 +907,98 @@ public:
         m_azi_velocity *= p / m_update_period;
         m_ele_velocity *= p / m_update_period;
         m_path_samples_left *= p / m_update_period;
+        if (m_gc_active) set_rotation(m_gc_angle * p / m_update_period);
+        if (m_traj_active) ambi_trajectory_period(&m_traj, p / srate);
         m_update_period = p;
         m_samples_left = 0;
+
+        // The ramp is cut short, so whatever it was heading for counts as reached
+        if (m_done_landing) {
+            m_done_landing = false;
+            m_done_pending++;
+        }
         return m_update_period;
     }
 
     t_CKINT setOrder( t_CKINT order )
     {
+        // Baked gains have no channels above the order they were baked at
+        if (m_choreo && order > m_choreo->order && m_choreo->order >= 0) stop_choreography();
+
         m_order = order;
         m_out_channels = (order+1) * (order+1);
+        m_ahead_valid = false;
+        m_slope_valid = false;
+        m_monitor.reasons |= AMBI_REASON_ORDER;
         return order;
     }
 
+    t_CKINT setBlockSize( t_CKINT b )
+    {
+        b = (b < 1 ? 1 : (b > MAX_BLOCK_SIZE ? MAX_BLOCK_SIZE : b));
+        if (b == m_block_size) return m_block_size;
+
+        delete [] m_block_in;
+        delete [] m_block_out;
+        m_block_in = NULL;
+        m_block_out = NULL;
+
+        // A block size of 1 processes every frame directly, without latency
+        if (b > 1) {
+            m_block_in = new SAMPLE[b];
+            m_block_out = new SAMPLE[b * MAX_CHANNELS];
+            memset(m_block_in, 0, sizeof(SAMPLE) * b);
+            memset(m_block_out, 0, sizeof(SAMPLE) * b * MAX_CHANNELS);
+        }
+
+        m_block_size = b;
+        m_block_pos = 0;
+        return m_block_size;
+    }
+
+    t_CKINT setSilenceDetection( t_CKINT d )
+    {
+        m_silence_detect = (d != 0);
+        m_silent_frames = 0;
+        return m_silence_detect;
+    }
+
+    t_CKINT setAdaptive( t_CKINT a )
+    {
+        m_adaptive = (a != 0);
+        return m_adaptive;
+    }
+
+    t_CKFLOAT setMaxError( t_CKFLOAT e )
+    {
+        m_max_error = (e <= 0 ? 1e-6 : e);
+        return m_max_error;
+    }
+
+    t_CKINT setInterp( t_CKINT i )
+    {
+        if (i != amb_interp_linear && i != amb_interp_hermite) return -1;
+
+        // Takes effect at the next update; the current ramp finishes as it started
+        m_interp = i;
+        m_ahead_valid = false;
+        m_slope_valid = false;
+        return m_interp;
+    }
+
+    t_CKINT setPathMode( t_CKINT m )
+    {
+        if (m != amb_path_angles && m != amb_path_great_circle) return -1;
+
+        // Takes effect at the next path(); a path in motion keeps its mode
+        m_path_mode = m;
+        return m_path_mode;
+    }
+
     // getters
     t_CKFLOAT getAzimuth()
     {
+        if (m_gc_active) sync_angles();
         if (m_bounds_type == amb_bounds_normalized) {
             return scalef(m_azimuth, -1 * M_PI, M_PI, -1.0, 1.0);
         } else return m_azimuth;
@@ -342,6 +1006,7 @@ public:
 
     t_CKFLOAT getElevation()
     {
+        if (m_gc_active) sync_angles();
         if (m_bounds_type == amb_bounds_normalized) {
             return scalef(m_elevation, -1 * M_PI, M_PI, -1.0, 1.0);
         } else return m_elevation;
@@ -376,295 +1041,840 @@ public:
         return m_update_period;
     }
 
-private:
+    t_CKINT getBlockSize()
+    {
+        return m_block_size;
+    }
 
-    void compute_coeffs() {
-        // Run only once and store values
-        // 1st order - 4 channels
-        m_coeffs[0] = 1.;
-        m_coeffs[1] = 1.;
-        m_coeffs[2] = 1.;
-        m_coeffs[3] = 1.;
-
-        // 2nd order - 9 channels
-        m_coeffs[4] = sqrt(3);
-        m_coeffs[5] = (1. / 4.) * sqrt(3);
-        m_coeffs[6] = (3. / 2.);
-        m_coeffs[7] = (1. / 4.) * sqrt(3);
-        m_coeffs[8] = (1. / 2.) * sqrt(3);
-
-        // 3rd order - 16 channels
-        m_coeffs[9] = (1. / 4.) * sqrt(10);
-        m_coeffs[10] = sqrt(15);
-        m_coeffs[11] = (1. / 4.) * sqrt(6);
-        m_coeffs[12] = (1. / 2.);
-        m_coeffs[13] = (1. / 4.) * sqrt(6);
-        m_coeffs[14] = (1. / 2.) * sqrt(15);
-        m_coeffs[15] = (1. / 4.) * sqrt(10);
-
-        // 4th order - 25 channels
-        m_coeffs[16] = (1. / 32.) * sqrt(35);
-        m_coeffs[17] = (1. / 4.) * sqrt(70);
-        m_coeffs[18] = (1. / 2.) * sqrt(5);
-        m_coeffs[19] = (1. / 4.) * sqrt(10);
-        m_coeffs[20] = (35. / 8.);
-        m_coeffs[21] = (1. / 4.) * sqrt(10);
-        m_coeffs[22] = (1. / 4.) * sqrt(5);
-        m_coeffs[23] = (1. / 4.) * sqrt(70);
-        m_coeffs[24] = sqrt(35);
-
-        // 5th order - 36 channels
-        m_coeffs[25] = (3. / 16.) * sqrt(14);
-        m_coeffs[26] = (3. / 64.) * sqrt(35);
-        m_coeffs[27] = (-1. / 16.) * sqrt(70);
-        m_coeffs[28] = (1. / 2.) * sqrt(105);
-        m_coeffs[29] = (1. / 8.) * sqrt(15);
-        m_coeffs[30] = (1. / 8.);
-        m_coeffs[31] = (1. / 8.) * sqrt(15);
-        m_coeffs[32] = (1. / 4.) * sqrt(105);
-        m_coeffs[33] = (-1. / 16.) * sqrt(70);
-        m_coeffs[34] = (3. / 8.) * sqrt(35);
-        m_coeffs[35] = (3. / 128.) * sqrt(14);
-
-        // 6th order - 49 channels
-        m_coeffs[36] = (1. / 16.) * sqrt(462);
-        m_coeffs[37] = (3. / 16.) * sqrt(154);
-        m_coeffs[38] = (3. / 256.) * sqrt(7);
-        m_coeffs[39] = (-1. / 16.) * sqrt(210);
-        m_coeffs[40] = (1. / 16.) * sqrt(210);
-        m_coeffs[41] = (1. / 8.) * sqrt(21);
-        m_coeffs[42] = (231. / 16.);
-        m_coeffs[43] = (1. / 8.);
-        m_coeffs[44] = (1. / 32.) * sqrt(210);
-        m_coeffs[45] = (-1. / 16.) * sqrt(210);
-        m_coeffs[46] = (3. / 16.) * sqrt(7);
-        m_coeffs[47] = (3. / 256.) * sqrt(154);
-        m_coeffs[48] = (1. / 256.) * sqrt(462);
-
-        // 7th order - 64 channels
-        m_coeffs[49] = (1. / 32.) * sqrt(429);
-        m_coeffs[50] = (1. / 512.) * sqrt(6006);
-        m_coeffs[51] = (1. / 32.) * sqrt(231);
-        m_coeffs[52] = (1. / 512.) * sqrt(231);
-        m_coeffs[53] = (-1. / 32.) * sqrt(21);
-        m_coeffs[54] = (1. / 16.) * sqrt(42);
-        m_coeffs[55] = (1. / 32.) * sqrt(7);
-        m_coeffs[56] = (1. / 16.);
-        m_coeffs[57] = (1. / 32.) * sqrt(7);
-        m_coeffs[58] = (1. / 32.) * sqrt(42);
-        m_coeffs[59] = (-1. / 32.) * sqrt(21);
-        m_coeffs[60] = (1. / 16.) * sqrt(231);
-        m_coeffs[61] = (1. / 32.) * sqrt(231);
-        m_coeffs[62] = (1. / 512.) * sqrt(6006);
-        m_coeffs[63] = (1. / 32.) * sqrt(429);
-    }
-
-    void compute_gains()
-    {
-        // Azimuth repeated expressions
-        t_CKFLOAT sinA = sinf(m_azimuth);
-        t_CKFLOAT cosA = cosf(m_azimuth);
-
-        t_CKFLOAT sinA2 = sinA * sinA;
-        t_CKFLOAT sinA4 = sinA2 * sinA2;
-        t_CKFLOAT sinA6 = sinA4 * sinA2;
-
-        t_CKFLOAT cosA2 = cosA * cosA;
-        t_CKFLOAT cosA4 = cosA2 * cosA2;
-        t_CKFLOAT cosA6 = cosA4 * cosA2;
-
-        t_CKFLOAT sin2A = 2 * sinA * cosA;
-        t_CKFLOAT cos2A = (cosA * cosA) - (sinA * sinA);
-
-        t_CKFLOAT sin3A = 2 * cosA * sin2A - sinA;
-        t_CKFLOAT cos3A = 2 * cosA * cos2A - cosA;
-
-        t_CKFLOAT sin4A = 2 * cosA * sin3A - sin2A;
-        t_CKFLOAT cos4A = 2 * cosA * cos3A - cos2A;
-
-        t_CKFLOAT sin5A = 2 * cosA * sin4A - sin3A;
-        t_CKFLOAT cos5A = 2 * cosA * cos4A - cos3A;
-
-        t_CKFLOAT sin6A = 2 * cosA * sin5A - sin4A;
-        t_CKFLOAT cos6A = 2 * cosA * cos5A - cos4A;
-
-        // Elevation repeated expressions
-        t_CKFLOAT sinE = sinf(m_elevation);
-        t_CKFLOAT cosE = cosf(m_elevation);
-
-        t_CKFLOAT sinE2 = sinE * sinE;
-        t_CKFLOAT sinE4 = sinE2 * sinE2;
-        t_CKFLOAT sinE6 = sinE4 * sinE2;
-
-        t_CKFLOAT cosE2 = cosE * cosE;
-        t_CKFLOAT cosE3 = cosE2 * cosE;
-        t_CKFLOAT cosE4 = cosE2 * cosE2;
-        t_CKFLOAT cosE6 = cosE4 * cosE2;
-        t_CKFLOAT cosE7 = cosE6 * cosE;
-
-        t_CKFLOAT sin2E = 2 * sinE * cosE;
-        t_CKFLOAT cos2E = (cosE * cosE) - (sinE * sinE);
-
-        t_CKFLOAT sin3E = 2 * cosE * sin2E - sinE;
-        t_CKFLOAT cos3E = 2 * cosE * cos2E - cosE;
-
-        t_CKFLOAT cos2E_12 = (cos2E + 1) * (cos2E + 1);
-        t_CKFLOAT cos2E_13 = cos2E_12 * (cos2E + 1);
-
-        // Calculate ACN Equations with SN3D normalization
-        // 1st order - 4 channels
-        if (m_order >= 1) {
-            m_gain_next[0] = 1.;
-            m_gain_next[1] = sinA * cosE;
-            m_gain_next[2] = sinE;
-            m_gain_next[3] = cosE * cosA;
-        }
+    t_CKDUR getLatency()
+    {
+        return m_block_size > 1 ? m_block_size : 0;
+    }
 
-        // 2nd order - 9 channels
-        if (m_order >= 2) {
-            m_gain_next[4] = m_coeffs[4] * sinA * cosE2 * cosA;
-            m_gain_next[5] = m_coeffs[5] * 2 * sin2E * sinA;
-            m_gain_next[6] = m_coeffs[6] * sinE2 - 0.5;
-            m_gain_next[7] = m_coeffs[7] * 2 * sin2E * cosA;
-            m_gain_next[8] = m_coeffs[8] * cosE2 * cos2A;
-        }
+    t_CKINT getSilenceDetection()
+    {
+        return m_silence_detect;
+    }
 
-        // 3rd order - 16 channels
-        if (m_order >= 3) {
-            m_gain_next[9]  = m_coeffs[9]  * (3 - 4 * sinA2) * sinA * cosE3;
-            m_gain_next[10] = m_coeffs[10] * sinE * sinA * cosE2 * cosA;
-            m_gain_next[11] = m_coeffs[11] * (5 * sinE2 - 1) * sinA * cosE;
-            m_gain_next[12] = m_coeffs[12] * (5 * sinE2 - 3) * sinE;
-            m_gain_next[13] = m_coeffs[13] * (5 * sinE2 - 1) * cosE * cosA;
-            m_gain_next[14] = m_coeffs[14] * sinE * cosE2 * cos2A;
-            m_gain_next[15] = m_coeffs[15] * (1 - 4 * sinA2) * cosE3 * cosA;
-        }
+    t_CKINT getSilent()
+    {
+        return m_silence_detect && m_silent_frames >= SILENCE_HOLD;
+    }
 
-        // 4th order - 25 channels
-        if (m_order >= 4) {
-            m_gain_next[16] = m_coeffs[16] * cos2E_12 * sin4A;
-            m_gain_next[17] = m_coeffs[17] * (3 - 4 * sinA2) * sinE * sinA * cosE3;
-            m_gain_next[18] = m_coeffs[18] * (7 * sinE2 - 1) * sinA * cosE2 * cosA;
-            m_gain_next[19] = m_coeffs[19] * (7 * sinE2 - 3) * sinE * sinA * cosE;
-            m_gain_next[20] = m_coeffs[20] * sinE4 - 3.75 * sinE2 + 0.375;
-            m_gain_next[21] = m_coeffs[21] * (7 * sinE2 - 3) * sinE * cosE * cosA;
-            m_gain_next[22] = m_coeffs[22] * (7 * sinE2 - 1) * cosE2 * cos2A;
-            m_gain_next[23] = m_coeffs[23] * (1 - 4 * sinA2) * sinE * cosE3 * cosA;
-            m_gain_next[24] = m_coeffs[24] * (sinA4 - sinA2 + 0.125) * cosE4;
-        }
+    t_CKINT getOverruns()
+    {
+        return m_monitor.overruns;
+    }
 
-        // 5th order - 36 channels
-        if (m_order >= 5) {
-            m_gain_next[25] = m_coeffs[25] * (16 * sinA4 - 20 * sinA2 + 5) * sinA * cosE3;
-            m_gain_next[26] = m_coeffs[26] * cos2E_12 * 2 * sinE * sin4A;
-            m_gain_next[27] = m_coeffs[27] * (9 * sinE2 - 1) * (4 * sinA2 - 3) * sinA * cosE3;
-            m_gain_next[28] = m_coeffs[28] * (3 * sinE2 - 1) * sinE * sinA * cosE2 * cosA;
-            m_gain_next[29] = m_coeffs[29] * (21 * sinE4 - 14 * sinE2 + 1) * sinA * cosE;
-            m_gain_next[30] = m_coeffs[30] * (63 * sinE4 - 70 * sinE2 + 15) * sinE;
-            m_gain_next[31] = m_coeffs[31] * (21 * sinE4 - 14 * sinE2 + 1) * cosE * cosA;
-            m_gain_next[32] = m_coeffs[32] * (3 * sinE2 - 1) * sinE * cosE2 * cos2A;
-            m_gain_next[33] = m_coeffs[33] * (9 * sinE2 - 1) * (4 * sinA2 - 1) * cosE3 * cosA;
-            m_gain_next[34] = m_coeffs[34] * (8 * sinA4 - 8 * sinA2 + 1) * sinE * cosE4;
-            m_gain_next[35] = m_coeffs[35] * cos2E_12 * 2 * cosE * cos5A;
-        }
+    t_CKFLOAT getWorstTick()
+    {
+        return ambi_clock_to_ns(m_monitor.worst);
+    }
 
-        // 6th order - 49 channels
-        if (m_order >= 6) {
-            m_gain_next[36] = m_coeffs[36] * (16 * sinA4 - 16 * sinA2 + 3) * sinA * cosE6 * cosA;
-            m_gain_next[37] = m_coeffs[37] * (16 * sinA4 - 20 * sinA2 + 5) * sinE * sinA * cosE3;
-            m_gain_next[38] = m_coeffs[38] * cos2E_12 * sin4A * (18 - 22 * cos2E);
-            m_gain_next[39] = m_coeffs[39] * (11 * sinE2 - 3) * (4 * sinA2 - 3) * sinE * sinA * cosE3;
-            m_gain_next[40] = m_coeffs[40] * (33 * sinE4 - 18 * sinE2 + 1) * sinA * cosE2 * cosA;
-            m_gain_next[41] = m_coeffs[41] * (33 * sinE4 - 30 * sinE2 + 5) * sinE * sinA * cosE;
-            m_gain_next[42] = m_coeffs[42] * sinE6 - 19.6875 * sinE4 + 6.5625 * sinE2 - 0.3125;
-            m_gain_next[43] = m_coeffs[43] * 4.58257569496 * (33 * sinE4 - 30 * sinE2 + 5) * sinE * cosE * cosA;
-            m_gain_next[44] = m_coeffs[44] * (33 * sinE4 - 18 * sinE2 + 1) * cosE2 * cos2A;
-            m_gain_next[45] = m_coeffs[45] * (11 * sinE2 - 3) * (4 * sinA2 - 1) * sinE * cosE3 * cosA;
-            m_gain_next[46] = m_coeffs[46] * (11 * sinE2 - 1) * (8 * sinA4 - 8 * sinA2 + 1) * cosE4;
-            m_gain_next[47] = m_coeffs[47] * 2 * sin2E * cos5A * cos2E_12;
-            m_gain_next[48] = m_coeffs[48] * cos2E_13 * cos6A;
-        }
+    t_CKINT getInstanceId()
+    {
+        return m_monitor.id;
+    }
 
-        // 7th order - 64 channels
-        if (m_order >= 7) {
-            m_gain_next[49] = m_coeffs[49] * (-57 * sinA6 + 91 * sinA4 - 35 * sinA2 + 7 * cosA6) * sinA * cosE7;
-            m_gain_next[50] = m_coeffs[50] * cos2E_13 * (2 * sinE * sin6A);
-            m_gain_next[51] = m_coeffs[51] * (13 * sinE2 - 1) * (16 * sinA4 - 20 * sinA2 + 5) * sinA * cosE3;
-            m_gain_next[52] = m_coeffs[52] * cos2E_12 * sin4A * (54 * sinE - 26 * sin3E);
-            m_gain_next[53] = m_coeffs[53] * (4 * sinA2 - 3) * (143 * sinE4 - 66 * sinE2 + 3) * sinA * cosE3;
-            m_gain_next[54] = m_coeffs[54] * (143 * sinE4 - 110 * sinE2 + 15) * sinE * sinA * cosE2 * cosA;
-            m_gain_next[55] = m_coeffs[55] * (429 * sinE6 - 495 * sinE4 + 135 * sinE2 - 5) * sinA * cosE;
-            m_gain_next[56] = m_coeffs[56] * (429 * sinE6 - 693 * sinE4 + 315 * sinE2 - 35) * sinE;
-            m_gain_next[57] = m_coeffs[57] * (429 * sinE6 - 495 * sinE4 + 135 * sinE2 - 5) * cosE * cosA;
-            m_gain_next[58] = m_coeffs[58] * (143 * sinE4 - 110 * sinE2 + 15) * sinE * cosE2 * cos2A;
-            m_gain_next[59] = m_coeffs[59] * (4 * sinA2 - 1) * (143 * sinE4 - 66 * sinE2 + 3) * cosE3 * cosA;
-            m_gain_next[60] = m_coeffs[60] * (13 * sinE2 - 3) * (8 * sinA4 - 8 * sinA2 + 1) * sinE * cosE4;
-            m_gain_next[61] = m_coeffs[61] * (13 * sinE2 - 1) * (16 * sinA4 - 12 * sinA2 + 1) * cosE3 * cosA;
-            m_gain_next[62] = m_coeffs[62] * (2 * sinE * cos6A) * cos2E_13;
-            m_gain_next[63] = m_coeffs[63] * (-63 * sinA6 + 77 * sinA4 - 21 * sinA2 + cosA6) * cosE7 * cosA;
-        }
+    t_CKINT getAdaptive()
+    {
+        return m_adaptive;
     }
 
-    // Helper functions
-    float scalef(float x, float in_min, float in_max, float out_min, float out_max)
+    t_CKFLOAT getMaxError()
     {
-    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+        return m_max_error;
     }
 
-    // instance data
-    t_CKINT m_order;
-    t_CKINT m_out_channels;
-    t_CKDUR m_update_period;
-    t_CKINT m_samples_left;
+    t_CKINT getInterp()
+    {
+        return m_interp;
+    }
 
-    t_CKINT m_pan_change;
-    t_CKINT m_velo_change;
-    t_CKINT m_path_change;
+    t_CKINT getPathMode()
+    {
+        return m_path_mode;
+    }
 
-    t_CKDUR m_path_samples_left;
-    t_CKINT m_bounds_type;
+private:
 
-    t_CKFLOAT m_azimuth;
-    t_CKFLOAT m_elevation;
-    t_CKFLOAT m_azi_velocity;
-    t_CKFLOAT m_ele_velocity;
-    t_CKFLOAT srate;
+    // A keyframe run in motion keeps the velocities of its segment, so it stops in place
+    void stop_keyframes()
+    {
+        if (m_key_index < 0) return;
+        m_key_index = -1;
+        m_azi_velocity = 0;
+        m_ele_velocity = 0;
+    }
 
-    t_CKFLOAT m_coeffs[MAX_CHANNELS];
-    t_CKFLOAT m_gain_next[MAX_CHANNELS];
-    t_CKFLOAT m_gain_cur[MAX_CHANNELS];
-    t_CKFLOAT m_gain_step[MAX_CHANNELS];
-};
+    // A path cut short by another control call ends without a done event; a
+    // great-circle path leaves its position as azimuth and elevation
+    void stop_path()
+    {
+        m_path_running = false;
+        m_done_landing = false;
+        stop_trajectory();
+        stop_choreography();
+        if (!m_gc_active) return;
+        sync_angles();
+        m_gc_active = false;
+        m_ahead_valid = false;
+    }
 
-//-----------------------------------------------------------------------------
-// info function: ChucK calls this when loading/probing the chugin
-// NOTE: please customize these info fields below; they will be used for
-// chugins loading, probing, and package management and documentation
-//-----------------------------------------------------------------------------
-CK_DLL_INFO( AmbiPan )
-{
-    // the version string of this chugin, e.g., "v1.2.1"
-    QUERY->setinfo( QUERY, CHUGIN_INFO_CHUGIN_VERSION, "v0.1.0" );
-    // the author(s) of this chugin, e.g., "Alice Baker & Carl Donut"
-    QUERY->setinfo( QUERY, CHUGIN_INFO_AUTHORS, "Zac Dulkin & Gregg Oliva" );
-    // text description of this chugin; what is it? what does it do? who is it for?
-    QUERY->setinfo( QUERY, CHUGIN_INFO_DESCRIPTION, "Ambisonics Panner up to 7th Order" );
-    // (optional) URL of the homepage for this chugin
-    QUERY->setinfo( QUERY, CHUGIN_INFO_URL, "https://github.com/gloliva/AmbiPan/tree/master" );
-    // (optional) contact email
-    QUERY->setinfo( QUERY, CHUGIN_INFO_EMAIL, "" );
-}
+    // Set up a great-circle path from (init_a, init_e) to (final_a, final_e): the
+    // rotation axis is normal to both unit vectors, and each update turns the
+    // position by the same precomputed rotation, so the loop needs no trig
+    void start_great_circle( t_CKFLOAT init_a, t_CKFLOAT init_e, t_CKFLOAT final_a, t_CKFLOAT final_e, t_CKDUR path_time )
+    {
+        t_CKFLOAT p0[3] = { cos(init_e) * cos(init_a), cos(init_e) * sin(init_a), sin(init_e) };
+        t_CKFLOAT p1[3] = { cos(final_e) * cos(final_a), cos(final_e) * sin(final_a), sin(final_e) };
+
+        t_CKFLOAT * k = m_gc_axis;
+        k[0] = p0[1] * p1[2] - p0[2] * p1[1];
+        k[1] = p0[2] * p1[0] - p0[0] * p1[2];
+        k[2] = p0[0] * p1[1] - p0[1] * p1[0];
+        t_CKFLOAT sin_t = sqrt(k[0] * k[0] + k[1] * k[1] + k[2] * k[2]);
+        t_CKFLOAT cos_t = p0[0] * p1[0] + p0[1] * p1[1] + p0[2] * p1[2];
+
+        if (sin_t > 1e-12) {
+            for (int i = 0; i < 3; i++) k[i] /= sin_t;
+        } else if (cos_t > 0) {
+            // Same point: stand still
+            k[0] = 0; k[1] = 0; k[2] = 1;
+        } else {
+            // Opposite points: every great circle joins them, so leave towards
+            // increasing azimuth, along t = (-sin a, cos a, 0), with k = p0 x t
+            k[0] = -sin(init_e) * cos(init_a);
+            k[1] = -sin(init_e) * sin(init_a);
+            k[2] = cos(init_e);
+        }
+        set_rotation(atan2(sin_t, cos_t) * m_update_period / path_time);
 
+        // Start one step back, so that the first update lands on p0
+        for (int i = 0; i < 3; i++)
+            m_gc_pos[i] = m_gc_rot[i] * p0[0] + m_gc_rot[3 + i] * p0[1] + m_gc_rot[6 + i] * p0[2];
 
-//-----------------------------------------------------------------------------
-// query function: ChucK calls this when loading the chugin
-// modify this function to define this chugin's API and language extensions
+        m_gc_final_azimuth = final_a;
+        m_gc_final_elevation = final_e;
+        m_gc_active = true;
+        m_ahead_valid = false;
+        m_azi_velocity = 0;
+        m_ele_velocity = 0;
+    }
+
+    // Rotation by angle about m_gc_axis (Rodrigues), row-major
+    void set_rotation( t_CKFLOAT angle )
+    {
+        const t_CKFLOAT * k = m_gc_axis;
+        t_CKFLOAT c = cos(angle), s = sin(angle), t = 1 - c;
+
+        m_gc_angle = angle;
+        m_gc_rot[0] = c + t * k[0] * k[0];
+        m_gc_rot[1] = t * k[0] * k[1] - s * k[2];
+        m_gc_rot[2] = t * k[0] * k[2] + s * k[1];
+        m_gc_rot[3] = t * k[1] * k[0] + s * k[2];
+        m_gc_rot[4] = c + t * k[1] * k[1];
+        m_gc_rot[5] = t * k[1] * k[2] - s * k[0];
+        m_gc_rot[6] = t * k[2] * k[0] - s * k[1];
+        m_gc_rot[7] = t * k[2] * k[1] + s * k[0];
+        m_gc_rot[8] = c + t * k[2] * k[2];
+    }
+
+    // out = R v, one step along the great circle; out may be v
+    void rotate( const t_CKFLOAT * v, t_CKFLOAT * out )
+    {
+        t_CKFLOAT x = v[0], y = v[1], z = v[2];
+        for (int i = 0; i < 3; i++)
+            out[i] = m_gc_rot[3 * i] * x + m_gc_rot[3 * i + 1] * y + m_gc_rot[3 * i + 2] * z;
+    }
+
+    // Azimuth and elevation of the great-circle position
+    void sync_angles()
+    {
+        const t_CKFLOAT * p = m_gc_pos;
+        m_azimuth = atan2(p[1], p[0]);
+        m_elevation = atan2(p[2], sqrt(p[0] * p[0] + p[1] * p[1]));
+    }
+
+    // A running trajectory stops in place, like a keyframe run
+    void stop_trajectory()
+    {
+        if (!m_traj_active) return;
+        m_traj_active = false;
+        m_azi_velocity = 0;
+        m_ele_velocity = 0;
+    }
+
+    // One update period along the trajectory. The velocities per update period
+    // follow the step, for the adaptive period and the Hermite look-ahead; the
+    // angles are left unwrapped, as pan() and the other movers leave them
+    void step_trajectory()
+    {
+        t_CKFLOAT a, e;
+        ambi_trajectory_step(&m_traj, &a, &e);
+        m_azi_velocity = wrap_angle(a - m_azimuth);
+        m_ele_velocity = wrap_angle(e - m_elevation);
+        m_azimuth += m_azi_velocity;
+        m_elevation += m_ele_velocity;
+    }
+
+    // Choreographies and baked gains start from the next update, once the start
+    // of the file is resident
+    void start_choreography( AmbiChoreo * c, t_CKINT source )
+    {
+        stop_keyframes();
+        stop_path();
+        m_choreo = c;
+        ambi_choreo_follow(c, &m_choreo_cursor);
+        m_choreo_source = source;
+        m_choreo_time = 0;
+        m_choreo_started = false;
+        m_samples_left = 0;
+    }
+
+    // Choreography playback stops in place, and lets go of the file
+    void stop_choreography()
+    {
+        if (!m_choreo) return;
+        ambi_choreo_release(m_choreo, &m_choreo_cursor);
+        m_choreo = NULL;
+        m_azi_velocity = 0;
+        m_ele_velocity = 0;
+    }
+
+    // One update period along the choreography, interpolated between its frames.
+    // Until the prefetch thread has the start of the file resident the source
+    // waits where it is, and the clock of the choreography starts after that;
+    // the last frame holds, and counts as done once the gains reach it. The
+    // source starts on the first frame as stored and turns the shortest way
+    // between frames, with its angles left unwrapped
+    void step_choreography()
+    {
+        if (!m_choreo_started) {
+            if (!ambi_choreo_ready(&m_choreo_cursor)) return;
+            m_choreo_started = true;
+            m_pan_change = true;
+            ambi_choreo_at(m_choreo, 0, m_choreo_source, &m_azimuth, &m_elevation);
+            if (m_choreo->nframes == 1) m_done_landing = true;
+            return;
+        }
+
+        m_choreo_time += m_update_period / srate * m_choreo->rate;
+        if (m_choreo_time >= m_choreo->nframes - 1) {
+            m_choreo_time = m_choreo->nframes - 1;
+            m_done_landing = true;
+        }
+        ambi_choreo_report(&m_choreo_cursor, (t_CKINT)m_choreo_time);
+
+        t_CKFLOAT a, e;
+        ambi_choreo_at(m_choreo, m_choreo_time, m_choreo_source, &a, &e);
+        m_azi_velocity = wrap_angle(a - m_azimuth);
+        m_ele_velocity = wrap_angle(e - m_elevation);
+        m_azimuth += m_azi_velocity;
+        m_elevation += m_ele_velocity;
+
+        // Held on the last frame, the source stands still
+        if (m_done_landing) {
+            m_azi_velocity = 0;
+            m_ele_velocity = 0;
+        }
+    }
+
+    // Head for keyframe i, time samples from the keyframe (or position) a, e. The
+    // velocities per update period drive the adaptive period and the Hermite look-ahead
+    void start_segment( t_CKINT i, t_CKDUR time, t_CKFLOAT a, t_CKFLOAT e )
+    {
+        m_key_index = i;
+        m_key_left = time;
+        m_azi_velocity = (m_keys[i].azimuth - a) / time * m_update_period;
+        m_ele_velocity = (m_keys[i].elevation - e) / time * m_update_period;
+    }
+
+    // Head for the keyframe after the one just reached; the run ends after the last
+    // keyframe unless it loops or turns around
+    void next_segment()
+    {
+        const Keyframe & from = m_keys[m_key_index];
+        t_CKINT n = m_keys.size();
+        t_CKINT i = m_key_index + m_key_dir;
+
+        if (i < 0 || i >= n) {
+            if (m_key_mode == amb_keys_loop) {
+                i = 0;
+            } else if (m_key_mode == amb_keys_pingpong && n > 1) {
+                m_key_dir = -m_key_dir;
+                i = m_key_index + m_key_dir;
+            } else {
+                stop_keyframes();
+                return;
+            }
+        }
+
+        // Going back, a segment takes as long as it did going forward
+        t_CKDUR time = m_key_dir > 0 ? m_keys[i].dur : m_keys[i + 1].dur;
+        start_segment(i, time, from.azimuth, from.elevation);
+    }
+
+    // Move to the next update point of a keyframe run: one update period along the
+    // current segment, or exactly onto its keyframe if that comes sooner. Returns the
+    // samples to that point
+    t_CKDUR step_keyframes()
+    {
+        if (m_adaptive) adapt_period();
+
+        t_CKDUR ramp = floor(m_update_period);
+        if (m_key_left < ramp) ramp = m_key_left;
+        m_key_left -= ramp;
+
+        if (m_key_left > 0) {
+            t_CKFLOAT f = ramp / m_update_period;
+            m_azimuth += m_azi_velocity * f;
+            m_elevation += m_ele_velocity * f;
+        } else {
+            m_azimuth = m_keys[m_key_index].azimuth;
+            m_elevation = m_keys[m_key_index].elevation;
+            m_done_landing = true;
+            next_segment();
+        }
+        return ramp;
+    }
+
+    // The update period for the current angular velocity; static sources keep
+    // the current one
+    t_CKDUR next_period()
+    {
+        t_CKFLOAT omega = (m_gc_active ? fabs(m_gc_angle) : fabs(m_azi_velocity) + fabs(m_ele_velocity)) / m_update_period;
+        if (omega <= 0) return m_update_period;
+        return adaptive_period(omega, m_order, m_max_error, m_interp == amb_interp_hermite);
+    }
+
+    // Pick the update period from the current angular velocity, keeping the
+    // velocities per second the same
+    void adapt_period()
+    {
+        t_CKDUR p = next_period();
+        if (p == m_update_period) return;
+        if (m_gc_active) set_rotation(m_gc_angle * p / m_update_period);
+        if (m_traj_active) ambi_trajectory_period(&m_traj, p / srate);
+        m_azi_velocity *= p / m_update_period;
+        m_ele_velocity *= p / m_update_period;
+        m_update_period = p;
+    }
+
+    // Set up a cubic Hermite segment from the current gains to the gains at the
+    // new position. The end slope comes from the gains one update further along
+    // the current velocity (Catmull-Rom); the start slope carries over from the
+    // previous segment so that gains stay smooth across updates. Those look-ahead
+    // gains become the next target, so steady motion costs one evaluation per update.
+    void start_hermite( t_CKFLOAT P )
+    {
+        if (playing_baked()) {
+            // The next stored vector is as good as a look-ahead, and costs nothing
+            position_gains(m_gain_next);
+            baked_gains(m_choreo_time + m_update_period / srate * m_choreo->rate, m_gain_ahead);
+            m_ahead_valid = false;
+            hermite_segment(P);
+            return;
+        }
+
+        bool ahead = m_gc_active
+            ? m_gc_pos[0] == m_ahead_pos[0] && m_gc_pos[1] == m_ahead_pos[1] && m_gc_pos[2] == m_ahead_pos[2]
+            : wrap_angle(m_azimuth) == m_ahead_azimuth && wrap_angle(m_elevation) == m_ahead_elevation;
+        if (m_ahead_valid && ahead) {
+            for (int c = 0; c < m_out_channels; c++) m_gain_next[c] = m_gain_ahead[c];
+        } else {
+            position_gains(m_gain_next);
+        }
+
+        if (m_gc_active) {
+            rotate(m_gc_pos, m_ahead_pos);
+            compute_gains_xyz(m_ahead_pos, m_gain_ahead);
+        } else {
+            m_ahead_azimuth = wrap_angle(m_azimuth + m_azi_velocity);
+            m_ahead_elevation = wrap_angle(m_elevation + m_ele_velocity);
+            compute_gains(m_ahead_azimuth, m_ahead_elevation, m_gain_ahead);
+        }
+        m_ahead_valid = true;
+        hermite_segment(P);
+    }
+
+    // Coefficients of the Hermite segment from m_gain_cur to m_gain_next, with the
+    // end slope taken from m_gain_ahead
+    void hermite_segment( t_CKFLOAT P )
+    {
+        // A jump starts from rest rather than from the old motion
+        bool carry = m_slope_valid && !m_pan_change;
+
+        for (int c = 0; c < m_out_channels; c++) {
+            t_CKFLOAT m1 = carry ? m_gain_slope[c] : 0;
+            t_CKFLOAT m2 = (m_gain_ahead[c] - m_gain_cur[c]) / (2 * P);
+            t_CKFLOAT d = m_gain_next[c] - m_gain_cur[c];
+
+            // g(k) = g1 + m1 k + b k^2 + a k^3 for k = 0..P, as forward differences
+            t_CKFLOAT b = (3 * d / P - 2 * m1 - m2) / P;
+            t_CKFLOAT a = (m1 + m2 - 2 * d / P) / (P * P);
+            m_gain_step[c] = m1 + b + a;
+            m_gain_accel[c] = 2 * b + 6 * a;
+            m_gain_jerk[c] = 6 * a;
+            m_gain_slope[c] = m2;
+        }
+        m_slope_valid = false;
+    }
+
+    // Hysteresis: only report silence after SILENCE_HOLD consecutive silent frames
+    bool detect_silence( const SAMPLE * in, int nframes )
+    {
+        return m_silence_detect && hold_silence(in, nframes, nframes, &m_silent_frames);
+    }
+
+    void compute_gains( t_CKFLOAT azimuth, t_CKFLOAT elevation, T * gains )
+    {
+        AMBI_TRACE_SCOPE("gains", "order", m_order);
+        ambi_stats_count(m_stats, AMBIPAN_STATS_CLASS, AMBI_STAT_GAIN_UPDATES, 1);
+        m_monitor.reasons |= AMBI_REASON_GAINS;
+        sh_gains(wrap_angle(azimuth), wrap_angle(elevation), m_order, m_coeffs, gains, 1);
+    }
+
+    void compute_gains_xyz( const t_CKFLOAT * p, T * gains )
+    {
+        AMBI_TRACE_SCOPE("gains", "order", m_order);
+        ambi_stats_count(m_stats, AMBIPAN_STATS_CLASS, AMBI_STAT_GAIN_UPDATES, 1);
+        m_monitor.reasons |= AMBI_REASON_GAINS;
+        sh_gains_xyz(p[0], p[1], p[2], m_order, m_coeffs, gains, 1);
+    }
+
+    // Baked gains at time t frames of the file, with no SH evaluation
+    void baked_gains( t_CKFLOAT t, T * gains )
+    {
+        AMBI_TRACE_SCOPE("baked", "order", m_order);
+        ambi_stats_count(m_stats, AMBIPAN_STATS_CLASS, AMBI_STAT_GAIN_UPDATES, 1);
+        m_monitor.reasons |= AMBI_REASON_GAINS;
+        ambi_bake_gains(m_choreo, t, m_out_channels, gains);
+    }
+
+    // Whether the gains come from a baked file that has started playing
+    bool playing_baked()
+    {
+        return m_choreo && m_choreo->order >= 0 && m_choreo_started;
+    }
+
+    // Gains at the current position, on a great-circle path, from a baked file or
+    // not; a look-ahead that landed on the position is used as it is
+    void position_gains( T * gains )
+    {
+        if (m_gc_active) compute_gains_xyz(m_gc_pos, gains);
+        else if (playing_baked()) baked_gains(m_choreo_time, gains);
+        else if (m_ahead_valid && wrap_angle(m_azimuth) == m_ahead_azimuth && wrap_angle(m_elevation) == m_ahead_elevation) {
+            for (int c = 0; c < m_out_channels; c++) gains[c] = m_gain_ahead[c];
+        }
+        else compute_gains(m_azimuth, m_elevation, gains);
+    }
+
+    // instance data
+    AmbiStatsBlock * m_stats;
+    AmbiTickMonitor m_monitor;
+    t_CKINT m_order;
+    t_CKINT m_out_channels;
+    t_CKDUR m_update_period;
+    t_CKINT m_samples_left;
+
+    t_CKINT m_pan_change;
+    t_CKINT m_velo_change;
+    t_CKINT m_path_change;
+
+    t_CKDUR m_path_samples_left;
+    t_CKINT m_path_running;     // a path() is under way and has not been cut short
+
+    // Great-circle paths
+    t_CKINT m_path_mode;
+    t_CKINT m_gc_active;
+    t_CKFLOAT m_gc_pos[3];      // unit vector of the position at the last update
+    t_CKFLOAT m_gc_axis[3];     // unit rotation axis
+    t_CKFLOAT m_gc_rot[9];      // rotation by m_gc_angle about it, one update period
+    t_CKFLOAT m_gc_angle;
+    t_CKFLOAT m_gc_final_azimuth;
+    t_CKFLOAT m_gc_final_elevation;
+
+    // Keyframe runs
+    struct Keyframe { t_CKFLOAT azimuth, elevation; t_CKDUR dur; };
+    std::vector<Keyframe> m_keys;
+    t_CKINT m_key_mode;
+    t_CKINT m_key_index;        // keyframe the source is heading for, -1 when no run plays
+    t_CKINT m_key_dir;          // 1, or -1 on the way back in ping-pong mode
+    t_CKDUR m_key_left;         // samples until that keyframe
+
+    // Trajectories
+    AmbiTrajectory m_traj;
+    t_CKINT m_traj_active;
+
+    // Choreography playback
+    AmbiChoreo * m_choreo;
+    AmbiChoreoCursor m_choreo_cursor;
+    t_CKINT m_choreo_source;
+    t_CKFLOAT m_choreo_time;    // in frames of the file
+    t_CKINT m_choreo_started;
+
+    // Done events
+    Chuck_Object * m_done_event;
+    Chuck_VM * m_done_vm;
+    CBufferSimple * m_done_buffer;
+    t_CKINT m_done_pending;     // finished since the last takeDone()
+    t_CKINT m_done_count;       // finished and announced by takeDone() in all
+    t_CKINT m_done_landing;     // the current ramp ends on a path end or keyframe
+    t_CKINT m_bounds_type;
+
+    t_CKINT m_block_size;
+    t_CKINT m_block_pos;
+    SAMPLE * m_block_in;
+    SAMPLE * m_block_out;
+
+    t_CKINT m_silence_detect;
+    t_CKINT m_silent_frames;
+    t_CKINT m_gains_stale;
+
+    t_CKINT m_adaptive;
+    t_CKFLOAT m_max_error;
+
+    t_CKINT m_interp;
+    t_CKINT m_slope_valid;
+    t_CKINT m_ahead_valid;
+    t_CKFLOAT m_ahead_azimuth;
+    t_CKFLOAT m_ahead_elevation;
+    t_CKFLOAT m_ahead_pos[3];
+
+    t_CKFLOAT m_azimuth;
+    t_CKFLOAT m_elevation;
+    t_CKFLOAT m_azi_velocity;
+    t_CKFLOAT m_ele_velocity;
+    t_CKFLOAT srate;
+
+    const float * m_coeffs;
+    T m_gain_next[MAX_CHANNELS];
+    T m_gain_cur[MAX_CHANNELS];
+    T m_gain_step[MAX_CHANNELS];
+    T m_gain_accel[MAX_CHANNELS];
+    T m_gain_jerk[MAX_CHANNELS];
+    T m_gain_slope[MAX_CHANNELS];
+    T m_gain_ahead[MAX_CHANNELS];
+};
+
+typedef AmbiPanT<ambi_gain_t> AmbiPan;
+
+// A group bus: every member pans into it at its position relative to the group,
+// and the group turns the whole field by one SH rotation (see AmbiRotate.h).
+// Moving the group costs one rotation per update period whatever the number of
+// members; the rotation is interpolated over the update period like the gains
+template<typename T>
+class AmbiGroupT
+{
+public:
+    AmbiGroupT( t_CKINT order, t_CKINT update_period, t_CKINT bounds_type )
+    {
+        m_order = order < 1 ? 1 : (order > 7 ? 7 : order);
+        m_out_channels = (m_order + 1) * (m_order + 1);
+        m_update_period = update_period < 1 ? 1 : update_period;
+        m_bounds_type = bounds_type;
+        m_samples_left = 0;
+        m_change = false;
+        m_yaw = 0;
+        m_pitch = 0;
+        m_roll = 0;
+
+        for (int e = 0; e < AMBI_ROT_SIZE; e++) {
+            m_rot_cur[e] = 0;
+            m_rot_next[e] = 0;
+            m_rot_step[e] = 0;
+        }
+        ambi_rotation_identity(7, m_rot_cur);
+        ambi_rotation_identity(7, m_rot_next);
+    }
+
+    // setters
+    t_CKVEC3 rotate( t_CKFLOAT yaw, t_CKFLOAT pitch, t_CKFLOAT roll )
+    {
+        m_yaw = scale_angle(yaw);
+        m_pitch = scale_angle(pitch);
+        m_roll = scale_angle(roll);
+        m_change = true;
+
+        t_CKVEC3 v;
+        v.x = m_yaw;
+        v.y = m_pitch;
+        v.z = m_roll;
+        return v;
+    }
+
+    t_CKFLOAT setYaw( t_CKFLOAT a )
+    {
+        m_yaw = scale_angle(a);
+        m_change = true;
+        return m_yaw;
+    }
+
+    t_CKFLOAT setPitch( t_CKFLOAT a )
+    {
+        m_pitch = scale_angle(a);
+        m_change = true;
+        return m_pitch;
+    }
+
+    t_CKFLOAT setRoll( t_CKFLOAT a )
+    {
+        m_roll = scale_angle(a);
+        m_change = true;
+        return m_roll;
+    }
+
+    // A new order jumps straight to the current rotation, since the blocks of
+    // the new degrees have nothing to ramp from
+    t_CKINT setOrder( t_CKINT order )
+    {
+        m_order = order < 1 ? 1 : (order > 7 ? 7 : order);
+        m_out_channels = (m_order + 1) * (m_order + 1);
+        target_rotation(m_rot_cur);
+        for (int e = 0; e < AMBI_ROT_SIZE; e++) {
+            m_rot_next[e] = m_rot_cur[e];
+            m_rot_step[e] = 0;
+        }
+        m_samples_left = 0;
+        m_change = false;
+        return m_order;
+    }
+
+    t_CKINT setUpdatePeriod( t_CKINT p )
+    {
+        m_update_period = p < 1 ? 1 : p;
+        return m_update_period;
+    }
+
+    t_CKINT setBoundsType( t_CKINT b )
+    {
+        if (b != amb_bounds_normalized && b != amb_bounds_radians) return -1;
+        m_bounds_type = b;
+        return b;
+    }
+
+    // getters
+    t_CKFLOAT getYaw() { return m_yaw; }
+    t_CKFLOAT getPitch() { return m_pitch; }
+    t_CKFLOAT getRoll() { return m_roll; }
+    t_CKINT getOrder() { return m_order; }
+    t_CKINT getUpdatePeriod() { return m_update_period; }
+    t_CKINT getBoundsType() { return m_bounds_type; }
+
+    void tick( SAMPLE * in, SAMPLE * out, int nframes )
+    {
+        AMBI_TRACE_SCOPE("group", "frames", nframes);
+
+        int f = 0;
+        while (f < nframes) {
+            // A new rotation once the previous ramp is done
+            if (m_samples_left <= 0 && m_change) {
+                AMBI_TRACE_SCOPE("rotation", "order", m_order);
+                target_rotation(m_rot_next);
+                for (int e = 0; e < ambi_rot_offset(m_order + 1); e++)
+                    m_rot_step[e] = (m_rot_next[e] - m_rot_cur[e]) / m_update_period;
+                m_samples_left = m_update_period;
+                m_change = false;
+            }
+
+            int n = nframes - f;
+            if (m_samples_left > 0 && m_samples_left < n) n = m_samples_left;
+
+            switch (m_order) {
+                case 1:  rotate_segment<1>(in + f * MAX_CHANNELS, out + f * MAX_CHANNELS, n); break;
+                case 2:  rotate_segment<2>(in + f * MAX_CHANNELS, out + f * MAX_CHANNELS, n); break;
+                case 3:  rotate_segment<3>(in + f * MAX_CHANNELS, out + f * MAX_CHANNELS, n); break;
+                case 4:  rotate_segment<4>(in + f * MAX_CHANNELS, out + f * MAX_CHANNELS, n); break;
+                case 5:  rotate_segment<5>(in + f * MAX_CHANNELS, out + f * MAX_CHANNELS, n); break;
+                case 6:  rotate_segment<6>(in + f * MAX_CHANNELS, out + f * MAX_CHANNELS, n); break;
+                default: rotate_segment<7>(in + f * MAX_CHANNELS, out + f * MAX_CHANNELS, n); break;
+            }
+            encode_zero(out + f * MAX_CHANNELS, n, m_out_channels);
+
+            if (m_samples_left > 0) {
+                m_samples_left -= n;
+
+                // Stop exactly on the target rotation
+                if (m_samples_left == 0) {
+                    for (int e = 0; e < AMBI_ROT_SIZE; e++) {
+                        m_rot_cur[e] = m_rot_next[e];
+                        m_rot_step[e] = 0;
+                    }
+                }
+            }
+            f += n;
+        }
+    }
+
+private:
+    t_CKFLOAT scale_angle( t_CKFLOAT a )
+    {
+        return m_bounds_type == amb_bounds_normalized ? scalef(a, -1.0, 1., -1 * M_PI, M_PI) : a;
+    }
+
+    // Blocks for the current angles; no rotation at all is exact
+    void target_rotation( T * m )
+    {
+        if (m_yaw == 0 && m_pitch == 0 && m_roll == 0) ambi_rotation_identity(m_order, m);
+        else ambi_rotation(m_yaw, m_pitch, m_roll, m_order, m);
+    }
+
+    template<int ORDER>
+    void rotate_segment( const SAMPLE * in, SAMPLE * out, int n )
+    {
+        if (m_samples_left > 0)
+            AMBI_CALL_KERNEL(rotate_ramp, AMBI_ARGS(<ORDER, MAX_CHANNELS>), (in, out, n, m_rot_cur, m_rot_step));
+        else
+            AMBI_CALL_KERNEL(rotate_const, AMBI_ARGS(<ORDER, MAX_CHANNELS>), (in, out, n, m_rot_cur));
+    }
+
+    // instance data
+    t_CKINT m_order;
+    t_CKINT m_out_channels;
+    t_CKINT m_update_period;
+    t_CKINT m_samples_left;
+    t_CKINT m_bounds_type;
+    t_CKINT m_change;
+    t_CKFLOAT m_yaw;
+    t_CKFLOAT m_pitch;
+    t_CKFLOAT m_roll;
+
+    T m_rot_cur[AMBI_ROT_SIZE];
+    T m_rot_next[AMBI_ROT_SIZE];
+    T m_rot_step[AMBI_ROT_SIZE];
+};
+
+typedef AmbiGroupT<ambi_gain_t> AmbiGroup;
+
+// largest difference between the outputs of the float and the double pipeline for
+// a unit input, while the source steps through a grid of directions covering the
+// sphere and interpolates over one update period to each
+static t_CKFLOAT precision_error( t_CKINT order, t_CKDUR update_period, t_CKINT interp )
+{
+    AmbiPanT<float> pan_f(44100, order, update_period, amb_bounds_radians);
+    AmbiPanT<double> pan_d(44100, order, update_period, amb_bounds_radians);
+    pan_f.setInterp(interp);
+    pan_d.setInterp(interp);
+
+    SAMPLE * in = new SAMPLE[MAX_BLOCK_SIZE];
+    SAMPLE * out_f = new SAMPLE[MAX_BLOCK_SIZE * MAX_CHANNELS];
+    SAMPLE * out_d = new SAMPLE[MAX_BLOCK_SIZE * MAX_CHANNELS];
+    for (int i = 0; i < MAX_BLOCK_SIZE; i++) in[i] = 1;
+
+    t_CKFLOAT max_error = 0;
+    for (int i = 0; i <= 12; i++) {
+        for (int j = 0; j <= 24; j++) {
+            t_CKFLOAT el = (i - 6) * M_PI / 12;
+            t_CKFLOAT az = (j - 12) * M_PI / 12;
+            pan_f.pan(az, el);
+            pan_d.pan(az, el);
+
+            for (t_CKINT left = (t_CKINT)pan_d.getUpdatePeriod(); left > 0; left -= MAX_BLOCK_SIZE) {
+                int n = left < MAX_BLOCK_SIZE ? (int)left : MAX_BLOCK_SIZE;
+                pan_f.tick(in, out_f, n);
+                pan_d.tick(in, out_d, n);
+                for (int k = 0; k < n * MAX_CHANNELS; k++) {
+                    t_CKFLOAT e = fabs(out_f[k] - out_d[k]);
+                    if (e > max_error) max_error = e;
+                }
+            }
+        }
+    }
+
+    delete [] in;
+    delete [] out_f;
+    delete [] out_d;
+    return max_error;
+}
+
+// pan every panner in pans to the matching entries of azimuth and elevation, as
+// pan() would, with the gains of AMBI_BATCH_SOURCES panners at a time evaluated in
+// one batch at the highest order among them; null entries are skipped. Returns
+// the number of panners panned
+static t_CKINT pan_many( Chuck_ArrayInt * pans, Chuck_ArrayFloat * azimuth, Chuck_ArrayFloat * elevation, CK_DL_API API )
+{
+    if (!pans || !azimuth || !elevation) return 0;
+    t_CKINT n = API->object->array_int_size(pans);
+    n = std::min(n, std::min(API->object->array_float_size(azimuth), API->object->array_float_size(elevation)));
+
+    AmbiPan * obj[AMBI_BATCH_SOURCES];
+    t_CKFLOAT a[AMBI_BATCH_SOURCES], e[AMBI_BATCH_SOURCES];
+    ambi_gain_t * gains[AMBI_BATCH_SOURCES];
+    t_CKINT panned = 0;
+
+    for (t_CKINT i = 0; i < n; ) {
+        int k = 0;
+        t_CKINT order = 0;
+        for (; i < n && k < AMBI_BATCH_SOURCES; i++) {
+            Chuck_Object * o = (Chuck_Object *)API->object->array_int_get_idx(pans, i);
+            if (!o || !OBJ_MEMBER_INT(o, ambipan_data_offset)) continue;
+            obj[k] = (AmbiPan *)OBJ_MEMBER_INT(o, ambipan_data_offset);
+            obj[k]->pan(API->object->array_float_get_idx(azimuth, i), API->object->array_float_get_idx(elevation, i));
+            obj[k]->pan_target(&a[k], &e[k]);
+            gains[k] = obj[k]->pan_gains(a[k], e[k]);
+            order = std::max(order, obj[k]->getOrder());
+            k++;
+        }
+        if (!k) break;
+
+        sh_gains_batch(order, k, a, e, gains);
+        ambi_stats_count(ambi_stats_block(), AMBIPAN_STATS_CLASS, AMBI_STAT_GAIN_UPDATES, k);
+        panned += k;
+    }
+    return panned;
+}
+
+// write a choreography file of nsources sources from azimuth and elevation, in
+// radians, which hold one value per source frame after frame; a trailing
+// partial frame is dropped. Returns the number of frames written, or 0 if
+// there are none or the file can't be written
+static t_CKINT write_choreography( const char * path, t_CKINT nsources, t_CKFLOAT rate,
+                                   Chuck_ArrayFloat * azimuth, Chuck_ArrayFloat * elevation, CK_DL_API API )
+{
+    if (!azimuth || !elevation || nsources < 1 || !(rate > 0)) return 0;
+    t_CKINT nframes = std::min(API->object->array_float_size(azimuth), API->object->array_float_size(elevation)) / nsources;
+    if (nframes < 1) return 0;
+
+    std::vector<float> az(nframes * nsources), el(nframes * nsources);
+    for (t_CKINT i = 0; i < nframes * nsources; i++) {
+        az[i] = (float)API->object->array_float_get_idx(azimuth, i);
+        el[i] = (float)API->object->array_float_get_idx(elevation, i);
+    }
+    return ambi_choreo_write(path, nsources, nframes, rate, &az[0], &el[0]) ? nframes : 0;
+}
+
+//-----------------------------------------------------------------------------
+// info function: ChucK calls this when loading/probing the chugin
+// NOTE: please customize these info fields below; they will be used for
+// chugins loading, probing, and package management and documentation
+//-----------------------------------------------------------------------------
+CK_DLL_INFO( AmbiPan )
+{
+    // the version string of this chugin, e.g., "v1.2.1"
+    QUERY->setinfo( QUERY, CHUGIN_INFO_CHUGIN_VERSION, "v0.1.0" );
+    // the author(s) of this chugin, e.g., "Alice Baker & Carl Donut"
+    QUERY->setinfo( QUERY, CHUGIN_INFO_AUTHORS, "Zac Dulkin & Gregg Oliva" );
+    // text description of this chugin; what is it? what does it do? who is it for?
+    QUERY->setinfo( QUERY, CHUGIN_INFO_DESCRIPTION, "Ambisonics Panner up to 7th Order" );
+    // (optional) URL of the homepage for this chugin
+    QUERY->setinfo( QUERY, CHUGIN_INFO_URL, "https://github.com/gloliva/AmbiPan/tree/master" );
+    // (optional) contact email
+    QUERY->setinfo( QUERY, CHUGIN_INFO_EMAIL, "" );
+}
+
+
+//-----------------------------------------------------------------------------
+// query function: ChucK calls this when loading the chugin
+// modify this function to define this chugin's API and language extensions
 //-----------------------------------------------------------------------------
 CK_DLL_QUERY( AmbiPan )
 {
     // generally, don't change this...
     QUERY->setname( QUERY, "AmbiPan" );
 
+    ambi_stats_init();
+
     // ------------------------------------------------------------------------
     // begin class definition(s); will be compiled, verified,
     // and added to the chuck host type system for use
@@ -707,6 +1917,66 @@ CK_DLL_QUERY( AmbiPan )
     QUERY->add_arg( QUERY, "dur", "path_time" );
     QUERY->doc_func( QUERY, "Set velocity of horizontal / vertical angles of point source" );
 
+    QUERY->add_mfun( QUERY, ambipan_keyframe, "int", "keyframe" );
+    QUERY->add_arg( QUERY, "float", "a" );
+    QUERY->add_arg( QUERY, "float", "e" );
+    QUERY->add_arg( QUERY, "dur", "time" );
+    QUERY->doc_func( QUERY, "Queue a keyframe: the point source reaches azimuth a, elevation e, time after the previous keyframe (or after playKeyframes for the first); returns the number of keyframes" );
+
+    QUERY->add_mfun( QUERY, ambipan_clearKeyframes, "void", "clearKeyframes" );
+    QUERY->doc_func( QUERY, "Stop any keyframe run and empty the keyframe queue" );
+
+    QUERY->add_mfun( QUERY, ambipan_playKeyframes, "int", "playKeyframes" );
+    QUERY->add_arg( QUERY, "int", "mode" );
+    QUERY->doc_func( QUERY, "Move through the keyframes from the current position, sample accurately and without shred activity: AmbiPan.ONCE, AmbiPan.LOOP or AmbiPan.PINGPONG; returns the number of keyframes" );
+
+    QUERY->add_mfun( QUERY, ambipan_stopKeyframes, "void", "stopKeyframes" );
+    QUERY->doc_func( QUERY, "Stop the keyframe run, leaving the point source where it is; pan, path and the velocity setters stop it too" );
+
+    QUERY->add_mfun( QUERY, ambipan_getKeyframeIndex, "int", "keyframeIndex" );
+    QUERY->doc_func( QUERY, "Get the index of the keyframe the point source is heading for, or -1 when no keyframe run plays" );
+
+    QUERY->add_mfun( QUERY, ambipan_trajectory, "int", "trajectory" );
+    QUERY->add_arg( QUERY, "string", "shape" );
+    QUERY->add_arg( QUERY, "float", "rate" );
+    QUERY->add_arg( QUERY, "float", "size" );
+    QUERY->add_arg( QUERY, "float", "phase" );
+    QUERY->doc_func( QUERY, "Move the point source along a trajectory evaluated inside the panner once per update period: \"orbit\" (at elevation size), \"spiral\" (elevation up to +-size and back every 8 turns), \"lissajous\" (3:2, half-width size) or \"walk\" (an orbit wandering randomly by size per second); rate in turns per second, phase the starting azimuth. Returns 0 for an unknown shape" );
+
+    QUERY->add_mfun( QUERY, ambipan_trajectoryTerm, "int", "trajectoryTerm" );
+    QUERY->add_arg( QUERY, "int", "angle" );
+    QUERY->add_arg( QUERY, "float", "amp" );
+    QUERY->add_arg( QUERY, "float", "freq" );
+    QUERY->add_arg( QUERY, "float", "phase" );
+    QUERY->doc_func( QUERY, "Add amp * sin(2 pi freq t + phase) to AmbiPan.AZIMUTH or AmbiPan.ELEVATION of the running trajectory, up to 4 terms each; returns the number of terms of that angle, or -1 if no trajectory runs or it is full" );
+
+    QUERY->add_mfun( QUERY, ambipan_stopTrajectory, "void", "stopTrajectory" );
+    QUERY->doc_func( QUERY, "Stop the trajectory, leaving the point source where it is; pan, path, keyframes and the velocity setters stop it too" );
+
+    QUERY->add_mfun( QUERY, ambipan_playChoreography, "int", "playChoreography" );
+    QUERY->add_arg( QUERY, "string", "file" );
+    QUERY->add_arg( QUERY, "int", "source" );
+    QUERY->doc_func( QUERY, "Move the point source along one source of a binary choreography file, memory mapped and shared by every voice that plays it, interpolated between its frames at the update period; returns the number of frames, or 0 if the file can't be opened or has no such source. The calling shred waits while the file is opened and its header read; the frames are read in the background" );
+
+    QUERY->add_mfun( QUERY, ambipan_stopChoreography, "void", "stopChoreography" );
+    QUERY->doc_func( QUERY, "Stop choreography or baked gain playback, leaving the point source where it is; pan, path, keyframes, trajectories and the velocity setters stop it too" );
+
+    QUERY->add_mfun( QUERY, ambipan_bake, "int", "bake" );
+    QUERY->add_arg( QUERY, "string", "file" );
+    QUERY->add_arg( QUERY, "int", "source" );
+    QUERY->add_arg( QUERY, "string", "baked" );
+    QUERY->doc_func( QUERY, "Evaluate one source of a choreography file ahead of time into a file of float16 gain vectors, one per update period at the current order; returns the number of updates written, or 0 if a file can't be opened or there is no such source" );
+
+    QUERY->add_mfun( QUERY, ambipan_playBaked, "int", "playBaked" );
+    QUERY->add_arg( QUERY, "string", "baked" );
+    QUERY->doc_func( QUERY, "Play a file written by bake, interpolating between its gain vectors with no SH evaluation; memory mapped and shared like a choreography, and opened on the calling shred the same way. Returns the number of updates, or 0 if the file can't be opened or was baked at a lower order" );
+
+    QUERY->add_mfun( QUERY, ambipan_getDone, "Event", "done" );
+    QUERY->doc_func( QUERY, "Get the Event broadcast on the sample a path reaches its end or a keyframe run reaches a keyframe; pan.done() => now waits for it without polling. Segments that finish within one audio tick share one broadcast; doneCount() tells how many finished" );
+
+    QUERY->add_mfun( QUERY, ambipan_getDoneCount, "int", "doneCount" );
+    QUERY->doc_func( QUERY, "Get the number of paths and keyframe segments finished since the panner was created, counted when done() is broadcast" );
+
     // setters
     QUERY->add_mfun( QUERY, ambipan_setAzimuth, "float", "azimuth" );
     QUERY->add_arg( QUERY, "float", "a" );
@@ -749,6 +2019,30 @@ CK_DLL_QUERY( AmbiPan )
     QUERY->add_arg( QUERY, "int", "p" );
     QUERY->doc_func( QUERY, "Set the number of samples for gain interpolation. A value of 1 means the values will be recomputed every sample" );
 
+    QUERY->add_mfun( QUERY, ambipan_setBlockSize, "int", "blockSize" );
+    QUERY->add_arg( QUERY, "int", "b" );
+    QUERY->doc_func( QUERY, "Set the number of samples buffered and processed together (1 - 256). Values above 1 delay the output by that many samples; a value of 1 disables block processing" );
+
+    QUERY->add_mfun( QUERY, ambipan_setSilenceDetection, "int", "silenceDetection" );
+    QUERY->add_arg( QUERY, "int", "d" );
+    QUERY->doc_func( QUERY, "Enable (1) or disable (0) skipping work while the input is silent. Disabled by default" );
+
+    QUERY->add_mfun( QUERY, ambipan_setAdaptive, "int", "adaptive" );
+    QUERY->add_arg( QUERY, "int", "a" );
+    QUERY->doc_func( QUERY, "Enable (1) or disable (0) choosing the update period from the angular velocity and order, so that gains stay within maxError" );
+
+    QUERY->add_mfun( QUERY, ambipan_setMaxError, "float", "maxError" );
+    QUERY->add_arg( QUERY, "float", "e" );
+    QUERY->doc_func( QUERY, "Set the largest gain error allowed between updates in adaptive mode. Defaults to 0.001" );
+
+    QUERY->add_mfun( QUERY, ambipan_setInterp, "int", "interp" );
+    QUERY->add_arg( QUERY, "int", "i" );
+    QUERY->doc_func( QUERY, "Set how gains move between updates: AmbiPan.LINEAR (default) or AmbiPan.HERMITE, a smooth cubic that stays accurate over much longer update periods" );
+
+    QUERY->add_mfun( QUERY, ambipan_setPathMode, "int", "pathMode" );
+    QUERY->add_arg( QUERY, "int", "m" );
+    QUERY->doc_func( QUERY, "Set how path() moves: AmbiPan.ANGLES (default) steps azimuth and elevation separately, AmbiPan.GREAT_CIRCLE takes the shortest arc between the two points at constant speed" );
+
     // getters
     QUERY->add_mfun( QUERY, ambipan_getAzimuth, "float", "azimuth" );
     QUERY->doc_func( QUERY, "Get horizontal angle of point source" );
@@ -771,11 +2065,133 @@ CK_DLL_QUERY( AmbiPan )
     QUERY->add_mfun( QUERY, ambipan_getUpdatePeriod, "int", "updatePeriod" );
     QUERY->doc_func( QUERY, "Get the number of samples between recomputing gain values" );
 
-    // Static variables
-    QUERY->add_svar( QUERY, "int", "NORMALIZED", true, (void *)&amb_bounds_normalized);
-    QUERY->add_svar( QUERY, "int", "RADIANS", true, (void *)&amb_bounds_radians);
+    QUERY->add_mfun( QUERY, ambipan_getBlockSize, "int", "blockSize" );
+    QUERY->doc_func( QUERY, "Get the number of samples buffered and processed together" );
 
-    // this reserves a variable in the ChucK internal class to store
+    QUERY->add_mfun( QUERY, ambipan_getLatency, "dur", "latency" );
+    QUERY->doc_func( QUERY, "Get the delay introduced by block processing" );
+
+    QUERY->add_mfun( QUERY, ambipan_getSilenceDetection, "int", "silenceDetection" );
+    QUERY->doc_func( QUERY, "Get whether work is skipped while the input is silent" );
+
+    QUERY->add_mfun( QUERY, ambipan_getSilent, "int", "silent" );
+    QUERY->doc_func( QUERY, "Get whether the panner is currently bypassed because its input is silent" );
+
+    QUERY->add_mfun( QUERY, ambipan_getAdaptive, "int", "adaptive" );
+    QUERY->doc_func( QUERY, "Get whether the update period is chosen adaptively" );
+
+    QUERY->add_mfun( QUERY, ambipan_getMaxError, "float", "maxError" );
+    QUERY->doc_func( QUERY, "Get the largest gain error allowed between updates in adaptive mode" );
+
+    QUERY->add_mfun( QUERY, ambipan_getInterp, "int", "interp" );
+    QUERY->doc_func( QUERY, "Get the gain interpolation mode" );
+
+    QUERY->add_mfun( QUERY, ambipan_getPathMode, "int", "pathMode" );
+    QUERY->doc_func( QUERY, "Get the path mode" );
+
+    QUERY->add_mfun( QUERY, ambipan_getOverruns, "int", "overruns" );
+    QUERY->doc_func( QUERY, "Get how many ticks of this panner went over the deadline budget while the deadline monitor was on" );
+
+    QUERY->add_mfun( QUERY, ambipan_getWorstTick, "float", "worstTick" );
+    QUERY->doc_func( QUERY, "Get the longest tick of this panner in ns, while statsTiming or the deadline monitor was on" );
+
+    QUERY->add_mfun( QUERY, ambipan_getInstanceId, "int", "instanceId" );
+    QUERY->doc_func( QUERY, "Get the id of this panner in deadlineDump files" );
+
+    QUERY->add_sfun( QUERY, ambipan_isa, "string", "isa" );
+    QUERY->doc_func( QUERY, "Get the instruction set the kernels were picked for on this CPU: \"avx512\", \"avx2\" or \"sse2\"" );
+
+    QUERY->add_sfun( QUERY, ambipan_precisionError, "float", "precisionError" );
+    QUERY->add_arg( QUERY, "int", "order" );
+    QUERY->add_arg( QUERY, "dur", "updatePeriod" );
+    QUERY->add_arg( QUERY, "int", "interp" );
+    QUERY->doc_func( QUERY, "Test mode: run the float and the double gain pipeline side by side across the sphere and return the largest difference between their outputs" );
+
+    QUERY->add_sfun( QUERY, ambipan_instances, "int", "instances" );
+    QUERY->doc_func( QUERY, "Get the number of AmbiPan instances alive" );
+
+    QUERY->add_sfun( QUERY, ambipan_samplesProcessed, "int", "samplesProcessed" );
+    QUERY->doc_func( QUERY, "Get the number of frames ticked by all AmbiPan instances since the last resetStats()" );
+
+    QUERY->add_sfun( QUERY, ambipan_gainUpdates, "int", "gainUpdates" );
+    QUERY->doc_func( QUERY, "Get the number of gain vectors computed by all AmbiPan instances since the last resetStats()" );
+
+    QUERY->add_sfun( QUERY, ambipan_silentBlocks, "int", "silentBlocks" );
+    QUERY->doc_func( QUERY, "Get the number of blocks all AmbiPan instances bypassed as silent since the last resetStats()" );
+
+    QUERY->add_sfun( QUERY, ambipan_tickTime, "float", "tickTime" );
+    QUERY->doc_func( QUERY, "Get the time in ns all AmbiPan instances spent ticking since the last resetStats(); counted only while statsTiming or the deadline monitor is on" );
+
+    QUERY->add_sfun( QUERY, ambipan_resetStats, "void", "resetStats" );
+    QUERY->doc_func( QUERY, "Restart samplesProcessed, gainUpdates, silentBlocks, tickTime and the tick time histogram from zero" );
+
+    QUERY->add_sfun( QUERY, ambipan_statsTiming, "int", "statsTiming" );
+    QUERY->add_arg( QUERY, "int", "timing" );
+    QUERY->doc_func( QUERY, "Turn tick timing of AmbiPan on (1) or off (0); off by default, as it reads the clock twice per tick" );
+
+    QUERY->add_sfun( QUERY, ambipan_traceStart, "int", "traceStart" );
+    QUERY->add_arg( QUERY, "string", "file" );
+    QUERY->doc_func( QUERY, "Start writing a Chrome trace of every AmbiPan tick, gain update and path to file; returns 0 if the chugin was built without AMBI_TRACE, a trace is already running or the file can't be written" );
+
+    QUERY->add_sfun( QUERY, ambipan_traceStop, "int", "traceStop" );
+    QUERY->doc_func( QUERY, "Stop the trace started by traceStart; a background thread writes what is left and closes its file. Returns the number of events written so far" );
+
+    QUERY->add_sfun( QUERY, ambipan_deadlineMonitor, "int", "deadlineMonitor" );
+    QUERY->add_arg( QUERY, "int", "monitor" );
+    QUERY->doc_func( QUERY, "Turn the deadline monitor of AmbiPan on (1) or off (0): times every tick into a histogram and records the ticks over deadlineBudget; off by default" );
+
+    QUERY->add_sfun( QUERY, ambipan_deadlineBudget, "float", "deadlineBudget" );
+    QUERY->add_arg( QUERY, "float", "us" );
+    QUERY->doc_func( QUERY, "Set the longest tick in microseconds before the deadline monitor records an overrun; 0 (the default) records none" );
+
+    QUERY->add_sfun( QUERY, ambipan_tickP50, "float", "tickP50" );
+    QUERY->doc_func( QUERY, "Get the median AmbiPan tick time in ns while the deadline monitor was on, since the last resetStats()" );
+
+    QUERY->add_sfun( QUERY, ambipan_tickP99, "float", "tickP99" );
+    QUERY->doc_func( QUERY, "Get the 99th percentile of AmbiPan tick times in ns while the deadline monitor was on, since the last resetStats()" );
+
+    QUERY->add_sfun( QUERY, ambipan_tickMax, "float", "tickMax" );
+    QUERY->doc_func( QUERY, "Get the longest AmbiPan tick in ns while the deadline monitor was on, since the last resetStats()" );
+
+    QUERY->add_sfun( QUERY, ambipan_tickOverruns, "int", "tickOverruns" );
+    QUERY->doc_func( QUERY, "Get how many AmbiPan ticks went over the deadline budget since the last resetStats()" );
+
+    QUERY->add_sfun( QUERY, ambipan_choreographySources, "int", "choreographySources" );
+    QUERY->add_arg( QUERY, "string", "file" );
+    QUERY->doc_func( QUERY, "Get the number of sources in a choreography file, or 0 if it can't be opened; the calling shred waits while the header is read" );
+
+    QUERY->add_sfun( QUERY, ambipan_writeChoreography, "int", "writeChoreography" );
+    QUERY->add_arg( QUERY, "string", "file" );
+    QUERY->add_arg( QUERY, "int", "sources" );
+    QUERY->add_arg( QUERY, "float", "rate" );
+    QUERY->add_arg( QUERY, "float[]", "a" );
+    QUERY->add_arg( QUERY, "float[]", "e" );
+    QUERY->doc_func( QUERY, "Write a choreography file of sources sources at rate frames per second, from azimuths a and elevations e in radians that hold one value per source, frame after frame; returns the number of frames written, or 0 if the file can't be written" );
+
+    QUERY->add_sfun( QUERY, ambipan_panMany, "int", "panMany" );
+    QUERY->add_arg( QUERY, "AmbiPan[]", "pans" );
+    QUERY->add_arg( QUERY, "float[]", "a" );
+    QUERY->add_arg( QUERY, "float[]", "e" );
+    QUERY->doc_func( QUERY, "Pan every panner in pans to the matching azimuth and elevation, as pan() does, evaluating their gains in batches; returns the number of panners moved" );
+
+    QUERY->add_sfun( QUERY, ambipan_deadlineDump, "int", "deadlineDump" );
+    QUERY->add_arg( QUERY, "string", "file" );
+    QUERY->doc_func( QUERY, "Write the tick time percentiles and every overrun since the last dump (time, instanceId, duration, what the tick did) to a CSV file, from a background thread; returns 0 if file is empty, and a file that can't be opened is reported on stderr" );
+
+    // Static variables
+    QUERY->add_svar( QUERY, "int", "NORMALIZED", true, (void *)&amb_bounds_normalized);
+    QUERY->add_svar( QUERY, "int", "RADIANS", true, (void *)&amb_bounds_radians);
+    QUERY->add_svar( QUERY, "int", "LINEAR", true, (void *)&amb_interp_linear);
+    QUERY->add_svar( QUERY, "int", "HERMITE", true, (void *)&amb_interp_hermite);
+    QUERY->add_svar( QUERY, "int", "ONCE", true, (void *)&amb_keys_once);
+    QUERY->add_svar( QUERY, "int", "LOOP", true, (void *)&amb_keys_loop);
+    QUERY->add_svar( QUERY, "int", "PINGPONG", true, (void *)&amb_keys_pingpong);
+    QUERY->add_svar( QUERY, "int", "ANGLES", true, (void *)&amb_path_angles);
+    QUERY->add_svar( QUERY, "int", "GREAT_CIRCLE", true, (void *)&amb_path_great_circle);
+    QUERY->add_svar( QUERY, "int", "AZIMUTH", true, (void *)&amb_angle_azimuth);
+    QUERY->add_svar( QUERY, "int", "ELEVATION", true, (void *)&amb_angle_elevation);
+
+    // this reserves a variable in the ChucK internal class to store
     // referene to the c++ class we defined above
     ambipan_data_offset = QUERY->add_mvar( QUERY, "int", "@apacn_data", false );
 
@@ -785,12 +2201,110 @@ CK_DLL_QUERY( AmbiPan )
     // ------------------------------------------------------------------------
     QUERY->end_class( QUERY );
 
+    // ------------------------------------------------------------------------
+    // AmbiGroup: a bus that moves every source panned into it at once
+    // ------------------------------------------------------------------------
+    QUERY->begin_class( QUERY, "AmbiGroup", "UGen" );
+    QUERY->doc_class( QUERY, "Rotates a whole ambisonics field in the SH domain. Pan the members of a group into it at their positions relative to the group, then move the group with one rotation, whatever the number of members. Up to 7th order." );
+
+    QUERY->add_ctor( QUERY, ambigroup_ctor );
+    QUERY->doc_func( QUERY, "Default constructor. Defaults to 3rd order and a 64 sample update period" );
+
+    QUERY->add_ctor( QUERY, ambigroup_ctor_order );
+    QUERY->add_arg( QUERY, "int", "order" );
+    QUERY->doc_func( QUERY, "Constructor that takes in the ambisonics order" );
+
+    QUERY->add_ctor( QUERY, ambigroup_ctor_orderAndPeriod );
+    QUERY->add_arg( QUERY, "int", "order" );
+    QUERY->add_arg( QUERY, "int", "updatePeriod" );
+    QUERY->doc_func( QUERY, "Constructor that takes in the ambisonics order and updatePeriod" );
+
+    QUERY->add_ctor( QUERY, ambigroup_ctor_orderAndPeriodAndBounds );
+    QUERY->add_arg( QUERY, "int", "order" );
+    QUERY->add_arg( QUERY, "int", "updatePeriod" );
+    QUERY->add_arg( QUERY, "int", "boundsType" );
+    QUERY->doc_func( QUERY, "Constructor that takes in the ambisonics order, updatePeriod, and boundsType (AmbiPan.NORMALIZED or AmbiPan.RADIANS)" );
+
+    QUERY->add_dtor( QUERY, ambigroup_dtor );
+
+    QUERY->add_ugen_funcf( QUERY, ambigroup_tickf, NULL, MAX_CHANNELS, MAX_CHANNELS );
+
+    QUERY->add_mfun( QUERY, ambigroup_rotate, "vec3", "rotate" );
+    QUERY->add_arg( QUERY, "float", "yaw" );
+    QUERY->add_arg( QUERY, "float", "pitch" );
+    QUERY->add_arg( QUERY, "float", "roll" );
+    QUERY->doc_func( QUERY, "Set the rotation of the group: roll about the front axis, then pitch up towards the zenith, then yaw in azimuth; it is reached over one update period" );
+
+    QUERY->add_mfun( QUERY, ambigroup_setYaw, "float", "yaw" );
+    QUERY->add_arg( QUERY, "float", "a" );
+    QUERY->doc_func( QUERY, "Set the turn of the group in azimuth" );
+
+    QUERY->add_mfun( QUERY, ambigroup_setPitch, "float", "pitch" );
+    QUERY->add_arg( QUERY, "float", "a" );
+    QUERY->doc_func( QUERY, "Set the tilt of the group towards the zenith" );
+
+    QUERY->add_mfun( QUERY, ambigroup_setRoll, "float", "roll" );
+    QUERY->add_arg( QUERY, "float", "a" );
+    QUERY->doc_func( QUERY, "Set the turn of the group about the front axis" );
+
+    QUERY->add_mfun( QUERY, ambigroup_setOrder, "int", "order" );
+    QUERY->add_arg( QUERY, "int", "order" );
+    QUERY->doc_func( QUERY, "Set the ambisonics order, 1 to 7; channels above it are silent" );
+
+    QUERY->add_mfun( QUERY, ambigroup_setUpdatePeriod, "int", "updatePeriod" );
+    QUERY->add_arg( QUERY, "int", "p" );
+    QUERY->doc_func( QUERY, "Set the number of samples a new rotation is interpolated over" );
+
+    QUERY->add_mfun( QUERY, ambigroup_setBoundsType, "int", "boundsType" );
+    QUERY->add_arg( QUERY, "int", "b" );
+    QUERY->doc_func( QUERY, "Set the range of the angles, AmbiPan.NORMALIZED or AmbiPan.RADIANS; returns -1 for anything else" );
+
+    QUERY->add_mfun( QUERY, ambigroup_getYaw, "float", "yaw" );
+    QUERY->doc_func( QUERY, "Get the turn of the group in azimuth, in radians" );
+
+    QUERY->add_mfun( QUERY, ambigroup_getPitch, "float", "pitch" );
+    QUERY->doc_func( QUERY, "Get the tilt of the group towards the zenith, in radians" );
+
+    QUERY->add_mfun( QUERY, ambigroup_getRoll, "float", "roll" );
+    QUERY->doc_func( QUERY, "Get the turn of the group about the front axis, in radians" );
+
+    QUERY->add_mfun( QUERY, ambigroup_getOrder, "int", "order" );
+    QUERY->doc_func( QUERY, "Get the ambisonics order" );
+
+    QUERY->add_mfun( QUERY, ambigroup_getUpdatePeriod, "int", "updatePeriod" );
+    QUERY->doc_func( QUERY, "Get the update period" );
+
+    QUERY->add_mfun( QUERY, ambigroup_getBoundsType, "int", "boundsType" );
+    QUERY->doc_func( QUERY, "Get the range of the angles" );
+
+    ambigroup_data_offset = QUERY->add_mvar( QUERY, "int", "@agrp_data", false );
+
+    QUERY->end_class( QUERY );
+
     // wasn't that a breeze?
     return TRUE;
 }
 
 
 // implementation for the default constructor
+// Events queued from the audio thread go through one buffer per VM, since its
+// audio thread is the only producer; the VM owns the buffer and frees it. Each
+// AmbiPan keeps the VM and buffer it was created under, so instances of an
+// earlier VM never queue into a later one's buffer
+static Chuck_VM * ambipan_done_vm = NULL;
+static CBufferSimple * ambipan_done_buffer = NULL;
+
+// give a new AmbiPan the Event that done() returns
+static void ambipan_attach_done( AmbiPan * apacn_obj, Chuck_VM * VM, Chuck_VM_Shred * SHRED, CK_DL_API API )
+{
+    if( ambipan_done_vm != VM )
+    {
+        ambipan_done_buffer = API->vm->create_event_buffer( VM );
+        ambipan_done_vm = VM;
+    }
+    apacn_obj->setDoneEvent( API->object->create( SHRED, API->type->lookup( VM, "Event" ), TRUE ), VM, ambipan_done_buffer );
+}
+
 CK_DLL_CTOR( ambipan_ctor )
 {
     // get the offset where we'll store our internal c++ class pointer
@@ -801,6 +2315,7 @@ CK_DLL_CTOR( ambipan_ctor )
 
     // store the pointer in the ChucK object member
     OBJ_MEMBER_INT( SELF, ambipan_data_offset ) = (t_CKINT)apacn_obj;
+    ambipan_attach_done( apacn_obj, VM, SHRED, API );
 }
 
 
@@ -817,6 +2332,7 @@ CK_DLL_CTOR( ambipan_ctor_order )
 
     // store the pointer in the ChucK object member
     OBJ_MEMBER_INT( SELF, ambipan_data_offset ) = (t_CKINT)apacn_obj;
+    ambipan_attach_done( apacn_obj, VM, SHRED, API );
 }
 
 
@@ -834,6 +2350,7 @@ CK_DLL_CTOR( ambipan_ctor_orderAndPeriod )
 
     // store the pointer in the ChucK object member
     OBJ_MEMBER_INT( SELF, ambipan_data_offset ) = (t_CKINT)apacn_obj;
+    ambipan_attach_done( apacn_obj, VM, SHRED, API );
 }
 
 
@@ -852,6 +2369,7 @@ CK_DLL_CTOR( ambipan_ctor_orderAndPeriodAndBounds )
 
     // store the pointer in the ChucK object member
     OBJ_MEMBER_INT( SELF, ambipan_data_offset ) = (t_CKINT)apacn_obj;
+    ambipan_attach_done( apacn_obj, VM, SHRED, API );
 }
 
 
@@ -860,6 +2378,7 @@ CK_DLL_DTOR( ambipan_dtor )
 {
     // get our c++ class pointer
     AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+    if( apacn_obj && apacn_obj->getDoneEvent() ) API->object->release( apacn_obj->getDoneEvent() );
     // clean up (this macro tests for NULL, deletes, and zeros out the variable)
     CK_SAFE_DELETE( apacn_obj );
     // set the data field to 0
@@ -876,6 +2395,12 @@ CK_DLL_TICKF( ambipan_tickf )
     // invoke our custom tick function
     if( apacn_obj ) apacn_obj->tick( in, out, nframes );
 
+    // wake up the shreds waiting on done(), once however many segments finished:
+    // events queued in one tick are all broadcast before any shred runs again, so
+    // a broadcast per segment would wake no one more; doneCount() tells them apart
+    if( apacn_obj && apacn_obj->takeDone() && apacn_obj->getDoneEvent() )
+        API->vm->queue_event( apacn_obj->getDoneVM(), (Chuck_Event *)apacn_obj->getDoneEvent(), 1, apacn_obj->getDoneBuffer() );
+
     // yes
     return TRUE;
 }
@@ -899,6 +2424,158 @@ CK_DLL_MFUN( ambipan_path )
     apacn_obj->path( arg1, arg2, arg3, arg4, arg5 );
 }
 
+CK_DLL_MFUN( ambipan_keyframe )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    t_CKFLOAT arg1 = GET_NEXT_FLOAT( ARGS );
+    t_CKFLOAT arg2 = GET_NEXT_FLOAT( ARGS );
+    t_CKDUR arg3 = GET_NEXT_DUR( ARGS );
+
+    // call keyframe() and set the return value
+    RETURN->v_int = apacn_obj->keyframe( arg1, arg2, arg3 );
+}
+
+CK_DLL_MFUN( ambipan_clearKeyframes )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    apacn_obj->clearKeyframes();
+}
+
+CK_DLL_MFUN( ambipan_playKeyframes )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+
+    // call playKeyframes() and set the return value
+    RETURN->v_int = apacn_obj->playKeyframes( arg1 );
+}
+
+CK_DLL_MFUN( ambipan_stopKeyframes )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    apacn_obj->stopKeyframes();
+}
+
+CK_DLL_MFUN( ambipan_getKeyframeIndex )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getKeyframeIndex() and set the return value
+    RETURN->v_int = apacn_obj->getKeyframeIndex();
+}
+
+CK_DLL_MFUN( ambipan_trajectory )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    const char * shape = API->object->str( GET_NEXT_STRING(ARGS) );
+    t_CKFLOAT arg2 = GET_NEXT_FLOAT( ARGS );
+    t_CKFLOAT arg3 = GET_NEXT_FLOAT( ARGS );
+    t_CKFLOAT arg4 = GET_NEXT_FLOAT( ARGS );
+
+    // call trajectory() and set the return value
+    RETURN->v_int = apacn_obj->trajectory( shape, arg2, arg3, arg4 );
+}
+
+CK_DLL_MFUN( ambipan_trajectoryTerm )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+    t_CKFLOAT arg2 = GET_NEXT_FLOAT( ARGS );
+    t_CKFLOAT arg3 = GET_NEXT_FLOAT( ARGS );
+    t_CKFLOAT arg4 = GET_NEXT_FLOAT( ARGS );
+
+    // call trajectoryTerm() and set the return value
+    RETURN->v_int = apacn_obj->trajectoryTerm( arg1, arg2, arg3, arg4 );
+}
+
+CK_DLL_MFUN( ambipan_stopTrajectory )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    apacn_obj->stopTrajectory();
+}
+
+CK_DLL_MFUN( ambipan_playChoreography )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    const char * file = API->object->str( GET_NEXT_STRING(ARGS) );
+    t_CKINT arg2 = GET_NEXT_INT( ARGS );
+
+    // call playChoreography() and set the return value
+    RETURN->v_int = apacn_obj->playChoreography( file, arg2 );
+}
+
+CK_DLL_MFUN( ambipan_stopChoreography )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    apacn_obj->stopChoreography();
+}
+
+CK_DLL_MFUN( ambipan_bake )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next arguments
+    const char * file = API->object->str( GET_NEXT_STRING(ARGS) );
+    t_CKINT arg2 = GET_NEXT_INT( ARGS );
+    const char * baked = API->object->str( GET_NEXT_STRING(ARGS) );
+
+    // call bake() and set the return value
+    RETURN->v_int = apacn_obj->bake( file, arg2, baked );
+}
+
+CK_DLL_MFUN( ambipan_playBaked )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    const char * baked = API->object->str( GET_NEXT_STRING(ARGS) );
+
+    // call playBaked() and set the return value
+    RETURN->v_int = apacn_obj->playBaked( baked );
+}
+
+CK_DLL_MFUN( ambipan_getDone )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    RETURN->v_object = apacn_obj->getDoneEvent();
+}
+
+CK_DLL_MFUN( ambipan_getDoneCount )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    RETURN->v_int = apacn_obj->getDoneCount();
+}
+
 // setters
 CK_DLL_MFUN( ambipan_setAzimuth )
 {
@@ -1033,6 +2710,78 @@ CK_DLL_MFUN( ambipan_setOrder )
     RETURN->v_int = apacn_obj->setOrder( arg1 );
 }
 
+CK_DLL_MFUN( ambipan_setBlockSize )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+
+    // call setBlockSize() and set the return value
+    RETURN->v_int = apacn_obj->setBlockSize( arg1 );
+}
+
+CK_DLL_MFUN( ambipan_setSilenceDetection )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+
+    // call setSilenceDetection() and set the return value
+    RETURN->v_int = apacn_obj->setSilenceDetection( arg1 );
+}
+
+CK_DLL_MFUN( ambipan_setAdaptive )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+
+    // call setAdaptive() and set the return value
+    RETURN->v_int = apacn_obj->setAdaptive( arg1 );
+}
+
+CK_DLL_MFUN( ambipan_setMaxError )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    t_CKFLOAT arg1 = GET_NEXT_FLOAT( ARGS );
+
+    // call setMaxError() and set the return value
+    RETURN->v_float = apacn_obj->setMaxError( arg1 );
+}
+
+CK_DLL_MFUN( ambipan_setInterp )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+
+    // call setInterp() and set the return value
+    RETURN->v_int = apacn_obj->setInterp( arg1 );
+}
+
+CK_DLL_MFUN( ambipan_setPathMode )
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // get next argument
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+
+    // call setPathMode() and set the return value
+    RETURN->v_int = apacn_obj->setPathMode( arg1 );
+}
+
 // getters
 CK_DLL_MFUN(ambipan_getAzimuth)
 {
@@ -1097,3 +2846,393 @@ CK_DLL_MFUN(ambipan_getUpdatePeriod)
     // call getUpdatePeriod() and set the return value
     RETURN->v_int = apacn_obj->getUpdatePeriod();
 }
+
+
+CK_DLL_MFUN(ambipan_getBlockSize)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getBlockSize() and set the return value
+    RETURN->v_int = apacn_obj->getBlockSize();
+}
+
+
+CK_DLL_MFUN(ambipan_getLatency)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getLatency() and set the return value
+    RETURN->v_dur = apacn_obj->getLatency();
+}
+
+
+CK_DLL_MFUN(ambipan_getSilenceDetection)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getSilenceDetection() and set the return value
+    RETURN->v_int = apacn_obj->getSilenceDetection();
+}
+
+
+CK_DLL_MFUN(ambipan_getSilent)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getSilent() and set the return value
+    RETURN->v_int = apacn_obj->getSilent();
+}
+
+
+CK_DLL_MFUN(ambipan_getOverruns)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getOverruns() and set the return value
+    RETURN->v_int = apacn_obj->getOverruns();
+}
+
+
+CK_DLL_MFUN(ambipan_getWorstTick)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getWorstTick() and set the return value
+    RETURN->v_float = apacn_obj->getWorstTick();
+}
+
+
+CK_DLL_MFUN(ambipan_getInstanceId)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getInstanceId() and set the return value
+    RETURN->v_int = apacn_obj->getInstanceId();
+}
+
+
+CK_DLL_MFUN(ambipan_getAdaptive)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getAdaptive() and set the return value
+    RETURN->v_int = apacn_obj->getAdaptive();
+}
+
+
+CK_DLL_MFUN(ambipan_getMaxError)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getMaxError() and set the return value
+    RETURN->v_float = apacn_obj->getMaxError();
+}
+
+
+CK_DLL_MFUN(ambipan_getInterp)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getInterp() and set the return value
+    RETURN->v_int = apacn_obj->getInterp();
+}
+
+CK_DLL_MFUN(ambipan_getPathMode)
+{
+    // get our c++ class pointer
+    AmbiPan * apacn_obj = (AmbiPan *)OBJ_MEMBER_INT( SELF, ambipan_data_offset );
+
+    // call getPathMode() and set the return value
+    RETURN->v_int = apacn_obj->getPathMode();
+}
+
+
+CK_DLL_SFUN(ambipan_isa)
+{
+    // the same for every instance, so this is a static function
+    RETURN->v_string = (Chuck_String *)API->object->create_string( VM, ambi_isa_name(), FALSE );
+}
+
+
+CK_DLL_SFUN(ambipan_precisionError)
+{
+    // get the arguments
+    t_CKINT order = GET_NEXT_INT(ARGS);
+    t_CKDUR update_period = GET_NEXT_DUR(ARGS);
+    t_CKINT interp = GET_NEXT_INT(ARGS);
+
+    RETURN->v_float = precision_error(order, update_period, interp);
+}
+
+
+CK_DLL_SFUN(ambipan_instances)
+{
+    RETURN->v_int = ambi_stats_read( AMBIPAN_STATS_CLASS, AMBI_STAT_INSTANCES );
+}
+
+
+CK_DLL_SFUN(ambipan_samplesProcessed)
+{
+    RETURN->v_int = ambi_stats_read( AMBIPAN_STATS_CLASS, AMBI_STAT_SAMPLES );
+}
+
+
+CK_DLL_SFUN(ambipan_gainUpdates)
+{
+    RETURN->v_int = ambi_stats_read( AMBIPAN_STATS_CLASS, AMBI_STAT_GAIN_UPDATES );
+}
+
+
+CK_DLL_SFUN(ambipan_silentBlocks)
+{
+    RETURN->v_int = ambi_stats_read( AMBIPAN_STATS_CLASS, AMBI_STAT_SILENT_BLOCKS );
+}
+
+
+CK_DLL_SFUN(ambipan_tickTime)
+{
+    RETURN->v_float = ambi_stats_tick_ns( AMBIPAN_STATS_CLASS );
+}
+
+
+CK_DLL_SFUN(ambipan_resetStats)
+{
+    ambi_stats_reset( AMBIPAN_STATS_CLASS );
+}
+
+
+CK_DLL_SFUN(ambipan_statsTiming)
+{
+    ambi_stats_timing = GET_NEXT_INT(ARGS) != 0;
+    RETURN->v_int = ambi_stats_timing;
+}
+
+
+CK_DLL_SFUN(ambipan_traceStart)
+{
+    const char * file = API->object->str( GET_NEXT_STRING(ARGS) );
+    RETURN->v_int = ambi_trace_start( file, AMBIPAN_TRACE_PID, "AmbiPan" );
+}
+
+
+CK_DLL_SFUN(ambipan_traceStop)
+{
+    RETURN->v_int = ambi_trace_stop();
+}
+
+
+CK_DLL_SFUN(ambipan_deadlineMonitor)
+{
+    ambi_deadline_monitor( GET_NEXT_INT(ARGS) != 0 );
+    RETURN->v_int = ambi_deadline_on;
+}
+
+
+CK_DLL_SFUN(ambipan_deadlineBudget)
+{
+    ambi_deadline_budget( GET_NEXT_FLOAT(ARGS) );
+    RETURN->v_float = ambi_deadline_us;
+}
+
+
+CK_DLL_SFUN(ambipan_tickP50)
+{
+    RETURN->v_float = ambi_deadline_quantile_ns( AMBIPAN_STATS_CLASS, 0.5 );
+}
+
+
+CK_DLL_SFUN(ambipan_tickP99)
+{
+    RETURN->v_float = ambi_deadline_quantile_ns( AMBIPAN_STATS_CLASS, 0.99 );
+}
+
+
+CK_DLL_SFUN(ambipan_tickMax)
+{
+    RETURN->v_float = ambi_deadline_max_ns( AMBIPAN_STATS_CLASS );
+}
+
+
+CK_DLL_SFUN(ambipan_tickOverruns)
+{
+    RETURN->v_int = ambi_stats_read( AMBIPAN_STATS_CLASS, AMBI_STAT_OVERRUNS );
+}
+
+
+CK_DLL_SFUN(ambipan_deadlineDump)
+{
+    const char * file = API->object->str( GET_NEXT_STRING(ARGS) );
+    RETURN->v_int = ambi_deadline_dump( file, "AmbiPan" );
+}
+
+
+CK_DLL_SFUN(ambipan_choreographySources)
+{
+    const char * file = API->object->str( GET_NEXT_STRING(ARGS) );
+    AmbiChoreo * c = ambi_choreo_acquire( file );
+    RETURN->v_int = c && c->order < 0 ? c->nsources : 0;
+    ambi_choreo_release( c );
+}
+
+CK_DLL_SFUN(ambipan_writeChoreography)
+{
+    const char * file = API->object->str( GET_NEXT_STRING(ARGS) );
+    t_CKINT sources = GET_NEXT_INT(ARGS);
+    t_CKFLOAT rate = GET_NEXT_FLOAT(ARGS);
+    Chuck_ArrayFloat * a = (Chuck_ArrayFloat *)GET_NEXT_OBJECT(ARGS);
+    Chuck_ArrayFloat * e = (Chuck_ArrayFloat *)GET_NEXT_OBJECT(ARGS);
+
+    RETURN->v_int = write_choreography( file, sources, rate, a, e, API );
+}
+
+
+CK_DLL_SFUN(ambipan_panMany)
+{
+    // the arrays, read through the array API
+    Chuck_ArrayInt * pans = (Chuck_ArrayInt *)GET_NEXT_OBJECT(ARGS);
+    Chuck_ArrayFloat * a = (Chuck_ArrayFloat *)GET_NEXT_OBJECT(ARGS);
+    Chuck_ArrayFloat * e = (Chuck_ArrayFloat *)GET_NEXT_OBJECT(ARGS);
+
+    RETURN->v_int = pan_many( pans, a, e, API );
+}
+
+
+// AmbiGroup
+CK_DLL_CTOR( ambigroup_ctor )
+{
+    OBJ_MEMBER_INT( SELF, ambigroup_data_offset ) = 0;
+    AmbiGroup * grp_obj = new AmbiGroup( 3, 64, amb_bounds_normalized );
+    OBJ_MEMBER_INT( SELF, ambigroup_data_offset ) = (t_CKINT)grp_obj;
+}
+
+CK_DLL_CTOR( ambigroup_ctor_order )
+{
+    OBJ_MEMBER_INT( SELF, ambigroup_data_offset ) = 0;
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+    AmbiGroup * grp_obj = new AmbiGroup( arg1, 64, amb_bounds_normalized );
+    OBJ_MEMBER_INT( SELF, ambigroup_data_offset ) = (t_CKINT)grp_obj;
+}
+
+CK_DLL_CTOR( ambigroup_ctor_orderAndPeriod )
+{
+    OBJ_MEMBER_INT( SELF, ambigroup_data_offset ) = 0;
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+    t_CKINT arg2 = GET_NEXT_INT( ARGS );
+    AmbiGroup * grp_obj = new AmbiGroup( arg1, arg2, amb_bounds_normalized );
+    OBJ_MEMBER_INT( SELF, ambigroup_data_offset ) = (t_CKINT)grp_obj;
+}
+
+CK_DLL_CTOR( ambigroup_ctor_orderAndPeriodAndBounds )
+{
+    OBJ_MEMBER_INT( SELF, ambigroup_data_offset ) = 0;
+    t_CKINT arg1 = GET_NEXT_INT( ARGS );
+    t_CKINT arg2 = GET_NEXT_INT( ARGS );
+    t_CKINT arg3 = GET_NEXT_INT( ARGS );
+    AmbiGroup * grp_obj = new AmbiGroup( arg1, arg2, arg3 );
+    OBJ_MEMBER_INT( SELF, ambigroup_data_offset ) = (t_CKINT)grp_obj;
+}
+
+CK_DLL_DTOR( ambigroup_dtor )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    CK_SAFE_DELETE( grp_obj );
+    OBJ_MEMBER_INT( SELF, ambigroup_data_offset ) = 0;
+}
+
+CK_DLL_TICKF( ambigroup_tickf )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    if( grp_obj ) grp_obj->tick( in, out, nframes );
+    return TRUE;
+}
+
+CK_DLL_MFUN( ambigroup_rotate )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    t_CKFLOAT yaw = GET_NEXT_FLOAT( ARGS );
+    t_CKFLOAT pitch = GET_NEXT_FLOAT( ARGS );
+    t_CKFLOAT roll = GET_NEXT_FLOAT( ARGS );
+    RETURN->v_vec3 = grp_obj->rotate( yaw, pitch, roll );
+}
+
+CK_DLL_MFUN( ambigroup_setYaw )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_float = grp_obj->setYaw( GET_NEXT_FLOAT( ARGS ) );
+}
+
+CK_DLL_MFUN( ambigroup_setPitch )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_float = grp_obj->setPitch( GET_NEXT_FLOAT( ARGS ) );
+}
+
+CK_DLL_MFUN( ambigroup_setRoll )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_float = grp_obj->setRoll( GET_NEXT_FLOAT( ARGS ) );
+}
+
+CK_DLL_MFUN( ambigroup_setOrder )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_int = grp_obj->setOrder( GET_NEXT_INT( ARGS ) );
+}
+
+CK_DLL_MFUN( ambigroup_setUpdatePeriod )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_int = grp_obj->setUpdatePeriod( GET_NEXT_INT( ARGS ) );
+}
+
+CK_DLL_MFUN( ambigroup_setBoundsType )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_int = grp_obj->setBoundsType( GET_NEXT_INT( ARGS ) );
+}
+
+CK_DLL_MFUN( ambigroup_getYaw )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_float = grp_obj->getYaw();
+}
+
+CK_DLL_MFUN( ambigroup_getPitch )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_float = grp_obj->getPitch();
+}
+
+CK_DLL_MFUN( ambigroup_getRoll )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_float = grp_obj->getRoll();
+}
+
+CK_DLL_MFUN( ambigroup_getOrder )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_int = grp_obj->getOrder();
+}
+
+CK_DLL_MFUN( ambigroup_getUpdatePeriod )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_int = grp_obj->getUpdatePeriod();
+}
+
+CK_DLL_MFUN( ambigroup_getBoundsType )
+{
+    AmbiGroup * grp_obj = (AmbiGroup *)OBJ_MEMBER_INT( SELF, ambigroup_data_offset );
+    RETURN->v_int = grp_obj->getBoundsType();
+}
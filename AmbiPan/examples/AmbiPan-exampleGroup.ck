@@ -0,0 +1,36 @@
+//---------------------------------------------------------------------
+// name: AmbiPan-exampleGroup.ck
+// desc: demo for groups
+//
+// AmbiGroup grp(int order)
+// A bus that turns everything panned into it. Members are panned once,
+// relative to the group; grp.rotate(float yaw, float pitch, float roll)
+// or grp.yaw(), grp.pitch() and grp.roll() then move all of them with a
+// single SH rotation, whatever the number of members.
+//
+// date: 10/19/2026
+//---------------------------------------------------------------------
+
+5 => int order;
+24 => int grains;
+
+AmbiGroup grp(order, 64, AmbiPan.RADIANS) => dac;
+
+// a swarm of grains on a ring in front of the listener
+SinOsc osc[grains];
+AmbiPan pan[0];
+for (int i; i < grains; i++) {
+    pan << new AmbiPan(order, 64, AmbiPan.RADIANS);
+    Math.random2f(300, 1200) => osc[i].freq;
+    0.5 / grains => osc[i].gain;
+    osc[i] => pan[i] => grp;
+    pan[i].pan(Math.random2f(-0.5, 0.5), Math.random2f(-0.3, 0.3));
+}
+
+// spin the whole swarm round the listener while it slowly tips over
+0 => float t;
+while (t < 20) {
+    grp.rotate(t * 0.6, 0.4 * Math.sin(t * 0.3), 0.2 * t);
+    10::ms => now;
+    0.01 +=> t;
+}
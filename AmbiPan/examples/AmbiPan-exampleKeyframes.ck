@@ -0,0 +1,34 @@
+//---------------------------------------------------------------------
+// name: AmbiPan-exampleKeyframes.ck
+// desc: demo for keyframe runs
+//
+// amb.keyframe(float azi, float ele, dur time)
+// Queues a point the source reaches time after the previous one.
+// amb.playKeyframes(int mode) then moves the source through the queue
+// inside the panner, sample accurately and without any shred waking up:
+// AmbiPan.ONCE, AmbiPan.LOOP, or AmbiPan.PINGPONG to go back and forth.
+// pan, path or a velocity setter stops the run, as does stopKeyframes().
+// amb.done() is broadcast on the sample each keyframe is reached.
+//
+// date: 10/19/2026
+//---------------------------------------------------------------------
+
+5 => int order;
+1 => int normalized;
+
+Noise noise => Gain g(0.2) => AmbiPan amb(order, normalized) => dac;
+
+// a square around the listener, rising on the way, then once more overhead
+amb.keyframe( 0.25, 0.0, 1::second);
+amb.keyframe( 0.75, 0.1, 1::second);
+amb.keyframe(-0.75, 0.2, 1::second);
+amb.keyframe(-0.25, 0.3, 1::second);
+amb.keyframe( 0.25, 0.5, 2::second);
+
+amb.playKeyframes(AmbiPan.PINGPONG);
+
+// only to print each keyframe as it is reached; the run doesn't need any shred
+while (true) {
+    amb.done() => now;
+    <<< "at", amb.azimuth(), amb.elevation(), "heading for keyframe", amb.keyframeIndex() >>>;
+}
@@ -7,6 +7,7 @@
 // If you change anything about the panner attributes, i.e.
 // azimuth, elevation, azimuth velocity, elevation velocity,
 // the panner abandons the path function.
+// amb.done() is broadcast on the sample the path reaches its end.
 //
 // author: Zac Dulkin
 //         Gregg Oliva
@@ -54,10 +55,10 @@ fun void random_path() {
         <<<"\n", "new path:", azi_init, ele_init, azi_next, ele_next, path_time + " sec", "\n">>>;
 
         <<<amb.azimuth(), amb.elevation()>>>;
-        path_time::second => now;
 
+        // wait for the panner to reach the end point, rather than for path_time
+        amb.done() => now;
         <<<amb.azimuth(), amb.elevation()>>>;
-        samp => now;
     }
 } spork ~ random_path();
 
@@ -0,0 +1,34 @@
+//---------------------------------------------------------------------
+// name: AmbiPan-exampleTrajectory.ck
+// desc: demo for trajectories
+//
+// amb.trajectory(string shape, float rate, float size, float phase)
+// Moves the source along "orbit", "spiral", "lissajous" or "walk",
+// evaluated inside the panner once per update period, rate in turns
+// per second. amb.trajectoryTerm(int angle, float amp, float freq, float phase)
+// adds a sine term to AmbiPan.AZIMUTH or AmbiPan.ELEVATION on top.
+// pan, path, keyframes or a velocity setter stops it, as does stopTrajectory().
+//
+// date: 10/19/2026
+//---------------------------------------------------------------------
+
+5 => int order;
+1 => int normalized;
+
+Noise noise => Gain g(0.2) => AmbiPan amb(order, normalized) => dac;
+
+// an orbit slightly above the listener, bobbing up and down three times per turn
+amb.trajectory("orbit", 0.2, 0.05, 0.);
+amb.trajectoryTerm(AmbiPan.ELEVATION, 0.05, 0.6, 0.);
+5::second => now;
+
+// then every other shape for a while
+["spiral", "lissajous", "walk"] @=> string shapes[];
+for (string shape : shapes) {
+    amb.trajectory(shape, 0.25, 0.2, 0.);
+    <<< shape >>>;
+    5::second => now;
+}
+
+amb.stopTrajectory();
+1::second => now;
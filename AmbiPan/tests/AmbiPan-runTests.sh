@@ -0,0 +1,50 @@
+#!/bin/bash
+# AmbiPan-runTests.sh
+#
+# Runs the self-checking tests under chuck --silent and exits nonzero if any of
+# them fails, so a CI job can gate on it. chuck exits 0 whatever a script finds,
+# so each test prints PASSED or FAILED as its last line and this reads that
+# verdict; a test that crashes, times out or prints neither counts as failed.
+#
+# How to run (from AmbiPan directory, after building AmbiPan.chug):
+#     $ tests/AmbiPan-runTests.sh [test.ck ...]
+
+CHUCK=${CHUCK:-chuck}
+CHUGIN=${CHUGIN:-./AmbiPan.chug}
+DIR="$(dirname "$0")"
+TIMEOUT=300
+
+if [ $# -gt 0 ]; then
+    TESTS="$*"
+else
+    TESTS="$DIR/AmbiPan-testPrecision.ck $DIR/AmbiPan-testChoreography.ck $DIR/AmbiPan-testDone.ck $DIR/AmbiPan-testPanMany.ck"
+fi
+
+if [ ! -f "$CHUGIN" ]; then
+    echo "$CHUGIN not found; build it first (e.g. make linux)" >&2
+    exit 1
+fi
+if ! command -v "$CHUCK" > /dev/null; then
+    echo "$CHUCK not found; set CHUCK to the chuck binary" >&2
+    exit 1
+fi
+
+failed=0
+for test in $TESTS; do
+    output=$(timeout $TIMEOUT "$CHUCK" --chugin:"$CHUGIN" --silent "$test" 2>&1)
+    status=$?
+    verdict=$(printf "%s\n" "$output" | awk '/^(PASSED|FAILED)/ { v = $1 } END { print v }')
+
+    if [ $status -eq 0 ] && [ "$verdict" = "PASSED" ]; then
+        echo "PASSED  $test"
+    else
+        echo "FAILED  $test (exit $status)"
+        printf "%s\n" "$output" | tail -n 20 | sed 's/^/    /'
+        failed=$((failed + 1))
+    fi
+done
+
+if [ $failed -gt 0 ]; then
+    echo "$failed test(s) failed"
+    exit 1
+fi
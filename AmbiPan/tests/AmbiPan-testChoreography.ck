@@ -0,0 +1,84 @@
+/*
+    AmbiPan-testChoreography.ck
+
+    Write a two-source choreography file with AmbiPan.writeChoreography(), play
+    it back in two voices that start half a second apart, and check that each
+    voice follows its own source from the first frame to the last. Prints
+    PASSED or FAILED as the last line. Leaves the file it wrote next to this
+    script.
+
+    How to run (from AmbiPan directory):
+        ```
+        $ tests/AmbiPan-runTests.sh tests/AmbiPan-testChoreography.ck
+        ```
+    which exits nonzero on failure, or on its own:
+        ```
+        $ chuck --chugin:./AmbiPan.chug --silent tests/AmbiPan-testChoreography.ck
+        ```
+*/
+
+// largest difference tolerated between a position and the file, which stores floats
+1e-6 => float tolerance;
+
+me.dir() + "AmbiPan-testChoreography.amc" => string file;
+10.0 => float rate;
+11 => int frames;
+
+0 => int failures;
+
+fun void check(string what, int ok) {
+    if (!ok) {
+        cherr <= "  failed: " <= what <= IO.nl();
+        failures++;
+    }
+}
+
+// source 0 turns left at 1 radian a second at elevation 0.25, source 1 turns
+// right at -0.25; each frame holds both azimuths, then both elevations
+float a[frames * 2];
+float e[frames * 2];
+for (0 => int f; f < frames; f++) {
+    0.1 * f => a[f * 2];
+    -0.1 * f => a[f * 2 + 1];
+    0.25 => e[f * 2];
+    -0.25 => e[f * 2 + 1];
+}
+
+check("writeChoreography writes every frame", AmbiPan.writeChoreography(file, 2, rate, a, e) == frames);
+check("choreographySources reads the header back", AmbiPan.choreographySources(file) == 2);
+
+Step dc => AmbiPan v0(1, 64, AmbiPan.RADIANS) => blackhole;
+dc => AmbiPan v1(1, 64, AmbiPan.RADIANS) => blackhole;
+1.0 => dc.next;
+
+check("a missing source is refused", v1.playChoreography(file, 2) == 0);
+check("source 0 plays", v0.playChoreography(file, 0) == frames);
+
+// halfway through, source 0 is somewhere along its turn
+500::ms => now;
+v0.azimuth() => float a0;
+chout <= "voice 0 at " <= a0 <= ", " <= v0.elevation() <= " after 500 ms" <= IO.nl();
+check("voice 0 has moved partway", a0 > 0.2 && a0 < 0.8);
+check("voice 0 holds its elevation", Math.fabs(v0.elevation() - 0.25) < tolerance);
+
+// a second voice starts from the first frame with a cursor of its own, while
+// the first one carries on from where it is
+check("source 1 plays", v1.playChoreography(file, 1) == frames);
+50::ms => now;
+v1.azimuth() => float a1;
+chout <= "voice 1 at " <= a1 <= ", voice 0 at " <= v0.azimuth() <= " after 550 ms" <= IO.nl();
+check("voice 1 starts at the first frame", a1 <= 0 && a1 > -0.1);
+check("voice 0 carries on", v0.azimuth() > a0);
+
+// both end on the last frame of their own source
+v0.done() => now;
+chout <= "voice 0 done at " <= v0.azimuth() <= ", " <= v0.elevation() <= IO.nl();
+check("voice 0 ends on its last frame", Math.fabs(v0.azimuth() - 1.0) < tolerance && Math.fabs(v0.elevation() - 0.25) < tolerance);
+check("voice 1 is still playing", v1.azimuth() > -1.0 + tolerance);
+
+v1.done() => now;
+chout <= "voice 1 done at " <= v1.azimuth() <= ", " <= v1.elevation() <= IO.nl();
+check("voice 1 ends on its last frame", Math.fabs(v1.azimuth() + 1.0) < tolerance && Math.fabs(v1.elevation() + 0.25) < tolerance);
+
+if (failures == 0) chout <= "PASSED" <= IO.nl();
+else chout <= "FAILED, " <= failures <= " checks" <= IO.nl();
@@ -0,0 +1,103 @@
+/*
+    AmbiPan-testDone.ck
+
+    Check the done() event: a shred waiting on it after path() wakes once the
+    path time has passed, with the source on the end point; doneCount() goes up
+    by one for a path and by one for every keyframe of a run; and a path cut
+    short by pan() never fires. Every wait has a watchdog, so a missing event
+    fails the check instead of hanging the test. Prints PASSED or FAILED as the
+    last line.
+
+    How to run (from AmbiPan directory):
+        ```
+        $ tests/AmbiPan-runTests.sh tests/AmbiPan-testDone.ck
+        ```
+    which exits nonzero on failure, or on its own:
+        ```
+        $ chuck --chugin:./AmbiPan.chug --silent tests/AmbiPan-testDone.ck
+        ```
+*/
+
+// largest difference tolerated between the end point and where the source is
+1e-6 => float tolerance;
+
+64 => int period;
+// the event is queued on the tick the last gain ramp lands, which may be up to
+// one update period after the path time, and wakes the shred a sample later
+(2 * period)::samp => dur late;
+
+0 => int failures;
+0 => int waits;
+
+fun void check(string what, int ok) {
+    if (!ok) {
+        cherr <= "  failed: " <= what <= IO.nl();
+        failures++;
+    }
+}
+
+// broadcast done() in place of the panner if wait number id is still waiting
+// after limit, so a missing event shows up as a wait of exactly limit
+fun void watchdog(AmbiPan p, dur limit, int id) {
+    limit => now;
+    if (waits == id) p.done().broadcast();
+}
+
+// wait on done() for at most limit; returns how long the wait took
+fun dur waitDone(AmbiPan p, dur limit) {
+    waits++;
+    spork ~ watchdog(p, limit, waits);
+    now => time start;
+    p.done() => now;
+    waits++;
+    return now - start;
+}
+
+Step dc => AmbiPan pan(1, period, AmbiPan.RADIANS) => blackhole;
+1.0 => dc.next;
+(4 * period)::samp => now;
+
+// a path wakes the shred once its time has passed, on the end point
+(700 * period)::samp => dur pathTime;
+pan.doneCount() => int count;
+pan.path(0, 0, 1.0, 0.25, pathTime);
+waitDone(pan, pathTime + 1::second) => dur took;
+chout <= "path of " <= pathTime / samp <= " samples done after " <= took / samp <= IO.nl();
+check("done() wakes after the path time", took >= pathTime);
+check("done() wakes within " + (late / samp) + " samples of the path time", took <= pathTime + late);
+check("the source is on the end point", Math.fabs(pan.azimuth() - 1.0) < tolerance && Math.fabs(pan.elevation() - 0.25) < tolerance);
+check("doneCount() counts the path once", pan.doneCount() == count + 1);
+
+// every keyframe of a run counts once, each on its own wake
+100::ms => dur keyTime;
+pan.clearKeyframes();
+pan.keyframe(0.5, 0, keyTime);
+pan.keyframe(0.0, 0.5, keyTime);
+pan.keyframe(-0.5, 0, keyTime);
+pan.doneCount() => count;
+check("three keyframes play", pan.playKeyframes(AmbiPan.ONCE) == 3);
+for (0 => int k; k < 3; k++) {
+    waitDone(pan, keyTime + 1::second) => took;
+    chout <= "keyframe " <= k <= " done after " <= took / samp <= " samples" <= IO.nl();
+    check("keyframe " + k + " wakes within " + (late / samp) + " samples of its time", took <= keyTime + late);
+    check("doneCount() counts keyframe " + k, pan.doneCount() == count + k + 1);
+}
+check("the source is on the last keyframe", Math.fabs(pan.azimuth() + 0.5) < tolerance && Math.fabs(pan.elevation()) < tolerance);
+
+// nothing more comes once the run is over
+waitDone(pan, 500::ms) => took;
+check("no event after the last keyframe", took == 500::ms);
+check("doneCount() stays put after the run", pan.doneCount() == count + 3);
+
+// a path cut short by pan() ends without an event
+pan.doneCount() => count;
+pan.path(0, 0, 1.0, 0, pathTime);
+pathTime / 4 => now;
+pan.pan(-1.0, 0);
+waitDone(pan, pathTime) => took;
+chout <= "cut-short path: wait ended after " <= took / samp <= " samples" <= IO.nl();
+check("a path cut short by pan() never fires", took == pathTime);
+check("doneCount() leaves out the cut-short path", pan.doneCount() == count);
+
+if (failures == 0) chout <= "PASSED" <= IO.nl();
+else chout <= "FAILED, " <= failures <= " checks" <= IO.nl();
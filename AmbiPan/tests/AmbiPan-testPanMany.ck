@@ -0,0 +1,97 @@
+/*
+    AmbiPan-testPanMany.ck
+
+    Check AmbiPan.panMany() against pan(): one set of panners of 1st, 2nd and
+    3rd order is moved with panMany(), a twin set of the same orders with pan()
+    on each panner, and every output channel of each panner has to match its
+    twin once the gains have settled. The array handed to panMany() has null
+    entries, which are skipped, and its azimuths are one shorter than the
+    panners, so the last panner has to stay where it is. Prints the largest
+    difference of each run, then PASSED or FAILED as the last line.
+
+    How to run (from AmbiPan directory):
+        ```
+        $ tests/AmbiPan-runTests.sh tests/AmbiPan-testPanMany.ck
+        ```
+    which exits nonzero on failure, or on its own:
+        ```
+        $ chuck --chugin:./AmbiPan.chug --silent tests/AmbiPan-testPanMany.ck
+        ```
+*/
+
+// largest difference tolerated between a panner and its twin
+1e-5 => float tolerance;
+
+// order of every panner, with 0 where the array holds null
+[1, 0, 3, 2, 3, 0, 1, 2] @=> int orders[];
+orders.size() => int n;
+16 => int channels;
+64 => int period;
+
+// positions of every run, in radians
+[[0.0, 0], [1.2, 0.3], [-2.5, -0.4], [3.0, 0.9], [-0.7, -1.2]] @=> float moves[][];
+
+0 => int failures;
+
+fun void check(string what, int ok) {
+    if (!ok) {
+        cherr <= "  failed: " <= what <= IO.nl();
+        failures++;
+    }
+}
+
+SinOsc osc => blackhole;
+330 => osc.freq;
+
+AmbiPan @ many[n];
+AmbiPan @ twin[n];
+0 => int voices;
+for (0 => int k; k < n; k++) {
+    if (orders[k] == 0) continue;
+    new AmbiPan(orders[k], period, AmbiPan.RADIANS) @=> many[k];
+    new AmbiPan(orders[k], period, AmbiPan.RADIANS) @=> twin[k];
+    osc => many[k] => blackhole;
+    osc => twin[k] => blackhole;
+    voices++;
+}
+
+// every panner starts at the same place as its twin, away from the moves
+for (0 => int k; k < n; k++) {
+    if (many[k] == null) continue;
+    many[k].pan(0.4, -0.2);
+    twin[k].pan(0.4, -0.2);
+}
+
+for (0 => int m; m < moves.size(); m++) {
+    // a different position for every panner, with one azimuth too few
+    float a[n - 1];
+    float e[n];
+    for (0 => int k; k < n; k++) {
+        if (k < n - 1) moves[m][0] + 0.3 * k => a[k];
+        moves[m][1] - 0.05 * k => e[k];
+    }
+
+    AmbiPan.panMany(many, a, e) => int moved;
+    for (0 => int k; k < n - 1; k++)
+        if (twin[k] != null) twin[k].pan(a[k], e[k]);
+    check("panMany() moves every panner it has an azimuth for", moved == voices - 1);
+
+    // let both settle, then compare sample by sample
+    (4 * period)::samp => now;
+    0.0 => float worst;
+    for (0 => int s; s < 256; s++) {
+        1::samp => now;
+        for (0 => int k; k < n; k++) {
+            if (many[k] == null) continue;
+            for (0 => int c; c < channels; c++)
+                Math.max(worst, Math.fabs(many[k].chan(c).last() - twin[k].chan(c).last())) => worst;
+        }
+    }
+
+    chout <= "azimuth " <= moves[m][0] <= ", elevation " <= moves[m][1] <= ": " <= worst <= IO.nl();
+    check("panMany() matches pan() at azimuth " + moves[m][0], worst <= tolerance);
+    check("the panner past the shortest array stays put", Math.fabs(many[n - 1].azimuth() - 0.4) < tolerance);
+}
+
+if (failures == 0) chout <= "PASSED" <= IO.nl();
+else chout <= "FAILED, " <= failures <= " checks" <= IO.nl();
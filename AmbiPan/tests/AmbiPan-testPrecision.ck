@@ -0,0 +1,43 @@
+/*
+    AmbiPan-testPrecision.ck
+
+    Compare the single-precision gain pipeline against the double-precision
+    reference across the sphere, for every order, a range of update periods and
+    both interpolation modes. Prints the largest output difference of each run,
+    then PASSED or FAILED as the last line.
+
+    How to run (from AmbiPan directory):
+        ```
+        $ tests/AmbiPan-runTests.sh tests/AmbiPan-testPrecision.ck
+        ```
+    which exits nonzero on failure, or on its own:
+        ```
+        $ chuck --chugin:./AmbiPan.chug --silent tests/AmbiPan-testPrecision.ck
+        ```
+*/
+
+// largest difference tolerated between float and double outputs
+1e-5 => float tolerance;
+
+[64, 256, 1024, 4096] @=> int periods[];
+[AmbiPan.LINEAR, AmbiPan.HERMITE] @=> int modes[];
+["linear", "hermite"] @=> string modeNames[];
+
+0 => int failures;
+
+for (1 => int order; order <= 7; order++) {
+    for (0 => int i; i < periods.size(); i++) {
+        for (0 => int m; m < modes.size(); m++) {
+            AmbiPan.precisionError(order, periods[i]::samp, modes[m]) => float err;
+            chout <= "order " <= order <= ", period " <= periods[i] <= ", " <= modeNames[m] <= ": " <= err <= IO.nl();
+
+            if (err > tolerance) {
+                cherr <= "  over tolerance, " <= err <= " > " <= tolerance <= IO.nl();
+                failures++;
+            }
+        }
+    }
+}
+
+if (failures == 0) chout <= "PASSED" <= IO.nl();
+else chout <= "FAILED, " <= failures <= " runs over tolerance" <= IO.nl();
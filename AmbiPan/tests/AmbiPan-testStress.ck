@@ -0,0 +1,75 @@
+/*
+    AmbiPan-testStress.ck
+
+    Non-interactive load for the voice capacity benchmark: renders a number of
+    saw voices, each on its own AmbiPan, for a fixed length of audio time while
+    random LFOs move every voice in azimuth and elevation. Takes no input and needs
+    no audio device, so tests/AmbiPan-testStress.sh can time it under
+    chuck --silent and search for the voice count at which rendering falls
+    behind real time.
+
+    Arguments: order, update period in samples, number of voices and seconds of
+    audio to render. With 0 voices, only prints the kernel instruction set.
+
+    How to run one configuration (from AmbiPan directory):
+        ```
+        $ chuck --chugin:./AmbiPan.chug --silent --out:64 tests/AmbiPan-testStress.ck:<order>:<updatePeriod>:<voices>:<seconds>
+        ```
+*/
+
+if (me.args() < 4) {
+    cherr <= "usage: AmbiPan-testStress.ck:<order>:<updatePeriod>:<voices>:<seconds>" <= IO.nl();
+    me.exit();
+}
+
+Std.atoi(me.arg(0)) => int order;
+Std.atoi(me.arg(1)) => int updatePeriod;
+Std.atoi(me.arg(2)) => int numVoices;
+Std.atof(me.arg(3)) => float seconds;
+
+// Error checking
+if (order < 1 || order > 7 || updatePeriod < 1 || numVoices < 0 || seconds <= 0) {
+    cherr <= "Invalid arguments: order " <= order <= ", updatePeriod " <= updatePeriod
+          <= ", voices " <= numVoices <= ", seconds " <= seconds <= IO.nl();
+    me.exit();
+}
+
+if (numVoices == 0) {
+    chout <= "isa " <= AmbiPan.isa() <= IO.nl();
+    me.exit();
+}
+
+// same seed every run, so every configuration sees the same motion
+Math.srandom(1);
+
+AmbiPan @ pans[numVoices];
+SawOsc oscs[numVoices];
+SinOsc lfosA[numVoices];
+SinOsc lfosE[numVoices];
+
+for (int i; i < numVoices; i++) {
+    new AmbiPan(order, updatePeriod, AmbiPan.RADIANS) @=> pans[i];
+
+    Math.mtof(Math.random2(30, 91)) => oscs[i].freq;
+    0.5 / numVoices => oscs[i].gain;
+    oscs[i] => pans[i] => dac;
+
+    Math.random2f(0.05, 2.) => lfosA[i].freq;
+    Math.random2f(0.05, 2.) => lfosE[i].freq;
+    lfosA[i] => blackhole;
+    lfosE[i] => blackhole;
+}
+
+// control rate motion, as a Patch / Range automation would do
+fun void moveAround() {
+    while (true) {
+        for (int i; i < numVoices; i++) {
+            pans[i].pan(lfosA[i].last() * pi, lfosE[i].last() * pi / 2);
+        }
+        5::ms => now;
+    }
+}
+
+spork ~ moveAround();
+
+seconds::second => now;
@@ -0,0 +1,102 @@
+#!/bin/bash
+# AmbiPan-testStress.sh
+#
+# Voice capacity benchmark: for every order and update period, finds the largest
+# number of AmbiPan voices that chuck --silent still renders at least as fast as
+# real time, using tests/AmbiPan-testStress.ck as the load. The voice count is
+# doubled until a run falls behind, then narrowed down by bisection to within
+# about 3%. chuck startup time is measured once and taken off every run.
+#
+# How to run (from AmbiPan directory, after building AmbiPan.chug):
+#     $ tests/AmbiPan-testStress.sh [-o "1 3 5 7"] [-p "1 64 256"] [-s seconds] [-c results.csv]
+
+ORDERS="1 2 3 4 5 6 7"
+PERIODS="1 64 256"
+SECONDS_RENDERED=10
+CSV=""
+MAX_VOICES=4096
+CHUCK=${CHUCK:-chuck}
+CHUGIN=${CHUGIN:-./AmbiPan.chug}
+SCRIPT="$(dirname "$0")/AmbiPan-testStress.ck"
+
+while getopts "o:p:s:c:" opt; do
+    case $opt in
+        o) ORDERS=$OPTARG ;;
+        p) PERIODS=$OPTARG ;;
+        s) SECONDS_RENDERED=$OPTARG ;;
+        c) CSV=$OPTARG ;;
+        *) echo "usage: $0 [-o orders] [-p periods] [-s seconds] [-c results.csv]" >&2; exit 1 ;;
+    esac
+done
+
+if [ ! -f "$CHUGIN" ]; then
+    echo "$CHUGIN not found; build it first (e.g. make linux)" >&2
+    exit 1
+fi
+
+# wall-clock seconds for one configuration into RUN_TIME: run_time order period voices.
+# A run that times out is far behind real time; any other chuck failure stops the benchmark
+run_time() {
+    local start end status
+    start=$(date +%s.%N)
+    timeout $((SECONDS_RENDERED * 4 + 30)) \
+        "$CHUCK" --chugin:"$CHUGIN" --silent --out:64 "$SCRIPT:$1:$2:$3:$SECONDS_RENDERED" > /dev/null 2>&1
+    status=$?
+    end=$(date +%s.%N)
+    if [ $status -ne 0 ] && [ $status -ne 124 ]; then
+        echo "chuck failed (exit $status) at order $1, period $2, $3 voices" >&2
+        exit 1
+    fi
+    RUN_TIME=$(awk -v s="$start" -v e="$end" 'BEGIN { printf "%.3f", e - s }')
+}
+
+# true if rendering kept up with real time: keeps_up order period voices
+keeps_up() {
+    run_time "$1" "$2" "$3"
+    awk -v t="$RUN_TIME" -v b="$BASELINE" -v d="$SECONDS_RENDERED" 'BEGIN { exit !(t - b <= d) }'
+}
+
+if ! command -v "$CHUCK" > /dev/null; then
+    echo "$CHUCK not found; set CHUCK to the chuck binary" >&2
+    exit 1
+fi
+
+ISA=$("$CHUCK" --chugin:"$CHUGIN" --silent "$SCRIPT:1:64:0:1" 2>&1 | awk '/^isa/ { print $2 }')
+run_time 1 64 0
+BASELINE=$RUN_TIME
+
+echo "AmbiPan voice capacity: $(uname -m), $(nproc) cores, isa ${ISA:-unknown}, ${SECONDS_RENDERED}s per run"
+printf "%-6s %-7s %s\n" order period voices
+if [ -n "$CSV" ]; then
+    echo "machine,isa,order,period,voices" > "$CSV"
+fi
+
+for order in $ORDERS; do
+    for period in $PERIODS; do
+        # double until a run falls behind
+        lo=0
+        hi=8
+        while [ $hi -le $MAX_VOICES ] && keeps_up "$order" "$period" $hi; do
+            lo=$hi
+            hi=$((hi * 2))
+        done
+
+        # then bisect, to within about 3%; past MAX_VOICES only report the bound
+        if [ $lo -ge $MAX_VOICES ]; then
+            hi=$lo
+        fi
+        while [ $((hi - lo)) -gt $(( lo / 32 > 1 ? lo / 32 : 1 )) ]; do
+            mid=$(((lo + hi) / 2))
+            if keeps_up "$order" "$period" $mid; then
+                lo=$mid
+            else
+                hi=$mid
+            fi
+        done
+
+        printf "%-6s %-7s %s\n" "$order" "$period" "$lo"
+        if [ -n "$CSV" ]; then
+            echo "$(uname -m),${ISA:-unknown},$order,$period,$lo" >> "$CSV"
+        fi
+    done
+done